@@ -1,10 +1,81 @@
 #ifndef __3DL_H
 #define __3DL_H
 
+#include <stddef.h>
+
+#ifdef TD_COUNT_ALLOCATIONS
+// In allocation counting mode every heap allocation done by the engine and its
+// containers goes through td_counting_malloc/td_counting_realloc.
+void* td_counting_malloc(size_t size);
+void* td_counting_realloc(void* ptr, size_t size);
+size_t td_allocation_count(void);
+
+#define ARENA_MALLOC td_counting_malloc
+#define DA_REALLOC td_counting_realloc
+#define NOB_REALLOC td_counting_realloc
+#endif
+
+// Prefer the reserve-and-commit arena backend for the cells where it is available.
+// Its regions are aligned to the 2 MiB commit step, so they are also marked for
+// transparent huge pages, which saves TLB misses when a tick walks whole boards.
+#if !defined(ARENA_BACKEND) && defined(__linux__)
+#define ARENA_BACKEND ARENA_BACKEND_LINUX_MMAP
+#ifndef ARENA_MMAP_HUGEPAGES
+#define ARENA_MMAP_HUGEPAGES
+#endif
+#endif
+
 #include <arena.h>
 #include <dw_array.h>
 #include <error.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+// The boards of a history are stored in chunks of fixed size that never move,
+// so pointers to boards stay valid for the lifetime of the history.
+#define TD_HISTORY_CHUNK_BITS 10
+#define TD_HISTORY_CHUNK_SIZE (1 << TD_HISTORY_CHUNK_BITS)
+
+#define TD_HISTORY_INITIAL_CAPACITY TD_HISTORY_CHUNK_SIZE
+
+// td_truncate gives the cells it drops back to the operating system once more
+// than TD_TRIM_BYTES of them are left behind the arena, and keeps them for the
+// next boards otherwise
+#ifndef TD_TRIM_BYTES
+#define TD_TRIM_BYTES (16*1024*1024)
+#endif
+
+// Loops of at most TD_AFFINE_MAX_PERIOD ticks whose counters change by a fixed
+// amount every period are skipped ahead arithmetically
+#define TD_AFFINE_MAX_PERIOD 256
+#define TD_AFFINE_RECENT_LANDINGS 8
+
+// The quadtree engine advances programs in leaps of 2^TD_QUADTREE_LEAP_BITS ticks.
+// Its nodes are dropped and built again once there are more than TD_QUADTREE_MAX_NODES.
+#define TD_QUADTREE_LEAP_BITS 6
+#define TD_QUADTREE_LEAP (1 << TD_QUADTREE_LEAP_BITS)
+#define TD_QUADTREE_MAX_NODES (1 << 21)
+
+// Binary programs written by td_write_binary start with this magic and version
+#define TD_BINARY_MAGIC "3DLC"
+#define TD_BINARY_VERSION 1
+
+// Trace files written by td_trace_start start with this magic and version, and
+// are written by a background thread in buffers of TD_TRACE_BUFFER_SIZE bytes
+#define TD_TRACE_MAGIC "3DLT"
+#define TD_TRACE_VERSION 1
+#define TD_TRACE_BUFFER_SIZE (1 << 20)
+
+// Checkpoints written by td_save_checkpoint start with this magic and version
+#define TD_CHECKPOINT_MAGIC "3DLS"
+#define TD_CHECKPOINT_VERSION 1
+
+// Boards spilled by td_spill are kept in a file of which TD_SPILL_RESERVE bytes
+// are mapped up front. Only the parts of it that boards are written to take up
+// disk space.
+#ifndef TD_SPILL_RESERVE
+#define TD_SPILL_RESERVE ((size_t) 256*1024*1024*1024)
+#endif
 
 #define TD_FOREACH(board, cursor) \
     for (TD_BoardCursor cursor = td_cursor_first(board); cursor.valid; cursor = td_cursor_next(cursor))
@@ -42,8 +113,16 @@ typedef enum
     STATUS_RUNNING,
     STATUS_STOPPED,
     STATUS_STALLED,
+    STATUS_LOOPING,
 } TD_Status;
 
+typedef enum
+{
+    TD_ENGINE_DENSE,
+    TD_ENGINE_WORKLIST,
+    TD_ENGINE_COUNT,
+} TD_Engine;
+
 typedef struct
 {
     TD_CellKind kind;
@@ -54,13 +133,33 @@ typedef struct
 
 struct _TD_BoardHistory;
 
+// Run of `empty` empty cells followed by `count` other cells, which are stored
+// right after the run
+typedef struct
+{
+    size_t empty;
+    size_t count;
+} TD_CellRun;
+
 typedef struct
 {
     TD_Cell *cells;
+    Arena_Mark cells_mark;
+
+    // Run-length encoded cells of a board stored sparsely, or NULL. Its cells are
+    // NULL unless it is decoded into the view of the history by td_board_cells.
+    TD_CellRun *runs;
+
     struct _TD_BoardHistory *history;
     int result;
     TD_Status status;
     size_t time;
+
+    // Zobrist-style hash of the cell kinds and values, kept up to date by every write
+    uint64_t hash;
+
+    // Number of ticks after which a looping board repeats itself
+    size_t period;
 } TD_Board;
 
 typedef struct
@@ -72,52 +171,684 @@ typedef struct
     bool valid;
 } TD_BoardCursor;
 
+typedef struct
+{
+    TD_BoardCursor timewarp_cursor;
+    TD_BoardCursor cell_cursor;
+    int value;
+    int dt;
+} TD_Timewarp;
+
+typedef da_array(TD_Timewarp) TD_Timewarps;
+
+// Open addressing table from board hashes to history indices. Entries of an older
+// generation count as empty, so the table can be cleared in O(1).
+typedef struct
+{
+    uint64_t key;
+    size_t index;
+    size_t generation;
+} TD_Transposition;
+
+typedef struct
+{
+    TD_Transposition *items;
+    size_t capacity;
+    size_t count;
+    size_t generation;
+} TD_Transpositions;
+
+// Boards created by a time warp. Only the ones that are not followed by a warp to
+// the same or an earlier time are kept, so the times are increasing.
+typedef struct
+{
+    size_t index;
+    size_t time;
+} TD_WarpLanding;
+
+typedef struct
+{
+    TD_WarpLanding *items;
+    size_t capacity;
+    size_t count;
+} TD_WarpLandings;
+
+// Ticks that were run without adding their boards to the history, `ticks` of
+// them right before the board at `index`
+typedef struct
+{
+    size_t index;
+    size_t ticks;
+} TD_TickJump;
+
+typedef struct
+{
+    TD_TickJump *items;
+    size_t capacity;
+    size_t count;
+} TD_TickJumps;
+
+typedef struct
+{
+    size_t *items;
+    size_t capacity;
+    size_t count;
+} TD_CellIndices;
+
+// Hash-consed quadtree node covering 2^level x 2^level cells. Leaves are single
+// cells, where outside marks the padding around the board that can't be written.
+typedef struct
+{
+    uint32_t level;
+    uint32_t children[4];
+    TD_CellKind kind;
+    int value;
+    bool outside;
+    uint64_t hash;
+
+    // The center of the node advanced by 2^min(TD_QUADTREE_LEAP_BITS, level - 3)
+    // ticks, or 0 if not computed yet. The masks have a bit for every tick in
+    // which an operator fired and in which a stop cell was written or the
+    // program crashed.
+    uint32_t result;
+    uint64_t fired;
+    uint64_t stopped;
+} TD_QuadNode;
+
+typedef struct
+{
+    TD_QuadNode *items;
+    size_t capacity;
+    size_t count;
+} TD_QuadNodes;
+
+typedef struct
+{
+    TD_QuadNodes nodes;
+
+    // Open addressing table of node indices by node hash
+    uint32_t *table;
+    size_t table_capacity;
+
+    // The node made of padding only for every level
+    uint32_t outside[32];
+
+    // Node whose center holds the board at root_index, or 0
+    uint32_t root;
+    size_t root_index;
+
+    // Boards at the end of a leap by their hash
+    TD_Transpositions leaps;
+} TD_Quadtree;
+
+// Result of the dependency analysis of a board. Cells that can never hold an
+// operator which influences a stop cell are not evaluated once enabled. The
+// other fields are scratch buffers of the analysis.
+typedef struct
+{
+    bool enabled;
+    bool *relevant;
+    TD_CellIndices cells;
+
+    // Kinds a cell may ever hold as bits, whether it may be written, whether its
+    // content matters for a relevant operator, and the cells left to visit
+    uint16_t *kinds;
+    bool *written;
+    bool *needed;
+    bool *queued;
+    TD_CellIndices queue;
+} TD_Pruning;
+
+// Boards at the start of the history that only move the inputs around without
+// looking at their values. td_reset keeps them and writes the new inputs into
+// the cells holding copies of the old ones, instead of computing them again.
+typedef struct
+{
+    bool tracking;
+    size_t count;
+
+    // Cells of every board of the prefix holding an input, as index * 2 plus 1
+    // for B, with the entries of board k starting at offsets.items[k]
+    TD_CellIndices cells;
+    TD_CellIndices offsets;
+
+    // Input held by every cell of the last board of the prefix, the same for the
+    // next board while it is followed, and the cells whose input may change
+    uint8_t *inputs;
+    uint8_t *next_inputs;
+    TD_CellIndices area;
+    TD_CellIndices written;
+} TD_InputPrefix;
+
+typedef struct
+{
+    TD_Cell **items;
+    size_t capacity;
+    size_t count;
+} TD_CellBuffers;
+
+// Boards stored run-length encoded in the cells arena, see td_store_sparse. Only
+// the boards from `packed` on hold their cells in full, in buffers that are
+// reused once a board is encoded. The view holds the cells of one encoded board.
+typedef struct
+{
+    bool enabled;
+    size_t packed;
+    TD_CellBuffers buffers;
+    TD_Cell *view;
+    TD_Board *view_board;
+} TD_SparseStorage;
+
+// Boards kept in a file mapped into memory, see td_spill. The cells of every board
+// after the first one are allocated from the mapping, so they can be read like
+// any other. Only the boards from `spilled` on, the last `resident` ones and the
+// ones that warps landed on stay in memory. The pages of the file before
+// `released` are given back to the operating system otherwise, which writes them
+// to the file and reads them back once they are accessed again.
+typedef struct
+{
+    bool enabled;
+    char *data;
+    size_t used;
+    size_t resident;
+    size_t spilled;
+    size_t released;
+    size_t page_size;
+
+    // Pages of the spilled board the history navigated to last, which are given
+    // back once it navigates elsewhere
+    size_t paged_begin;
+    size_t paged_end;
+} TD_SpillStorage;
+
+// Cell of a board within a loop whose value is value + k * delta in the k-th
+// repetition of the loop
+typedef struct
+{
+    TD_CellKind kind;
+    bool active;
+    int64_t value;
+    int64_t delta;
+} TD_AffineCell;
+
+typedef struct
+{
+    // Scratch boards for one period of the loop
+    TD_AffineCell *cells;
+    size_t cells_capacity;
+    size_t *times;
+    bool *landed;
+    size_t boards_capacity;
+
+    TD_CellIndices warps;
+
+    // Number of repetitions for which the period was shown to behave the same,
+    // 0 once the period turned out not to repeat
+    int64_t limit;
+
+    // Last warp landings, and how many landings to wait after a failed attempt
+    TD_WarpLanding recent[TD_AFFINE_RECENT_LANDINGS];
+    size_t recent_count;
+    size_t skip;
+    size_t backoff;
+} TD_AffineLoops;
+
+// Operator of the first board with its neighbours looked up in advance, or a
+// chain of moves in the same direction that pass values along from one to the
+// next, like the arrows of a conveyor. The operators of a chain are `stride`
+// cells apart, and nothing else writes to the cells they read and write.
+typedef struct
+{
+    TD_CellKind kind;
+    size_t index;
+    size_t count;
+    size_t stride;
+
+    // Left, up, right and down neighbour of the first operator, or SIZE_MAX
+    size_t neighbours[4];
+} TD_Superinstruction;
+
+// Operators of the first board in the order they are evaluated in, built on the
+// first tick that uses them. Only used while every operator is still where it
+// is on the first board.
+typedef struct
+{
+    TD_Superinstruction *items;
+    size_t capacity;
+    size_t count;
+    bool built;
+
+    // Number of operators in all instructions, and the time warps of the first board
+    size_t operators;
+    TD_CellIndices timewarps;
+} TD_Superinstructions;
+
+// Plain ticks either evaluate every operator, or only the ones next to a cell
+// that was written by the tick before, which can't fire otherwise. The engine
+// is chosen by the number of writes per tick over a window of ticks.
+typedef struct
+{
+    TD_Engine engine;
+    size_t ticks[TD_ENGINE_COUNT];
+    size_t sampled_ticks;
+    size_t sampled_writes;
+
+    // Cells written by the plain tick that computed the board at recorded_index,
+    // or SIZE_MAX, and the ones written by the tick being computed
+    bool recording;
+    size_t recorded_index;
+    TD_CellIndices written;
+    TD_CellIndices next_written;
+
+    // Operators to evaluate, and the tick each cell was last added in
+    TD_CellIndices candidates;
+    size_t *stamps;
+    size_t stamp;
+} TD_Activity;
+
+// Program compiled to C by td_compile. `tick` evaluates the operators of a plain
+// tick like evaluating every cell would, and returns whether one of them fired.
+// It only knows the operators where they are on the first board, so it can't be
+// used anymore once an operator is moved somewhere else.
+typedef bool (*TD_CompiledTick)(TD_Board* current_board, TD_Board* next_board);
+
+typedef struct
+{
+    size_t cols;
+    size_t rows;
+
+    // Hash of the operators the program was compiled for
+    uint64_t layout;
+
+    TD_CompiledTick tick;
+    const size_t *timewarps;
+    size_t timewarps_count;
+} TD_CompiledProgram;
+
+// Header of a binary program. It is followed by the cells of the first board as
+// they are laid out in memory, with the inputs holding 0, then the inputs as
+// index * 2 plus 1 for B, and then the relevant cells found by td_prune if the
+// program was pruned. Everything is stored in the byte order of the machine that
+// wrote it, so cell_size and the magic catch most files from other builds.
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t cell_size;
+    uint32_t pruned;
+    uint64_t cols;
+    uint64_t rows;
+
+    // Hash of the first board with the inputs holding 0
+    uint64_t hash;
+
+    uint64_t inputs_count;
+    uint64_t relevant_count;
+    uint64_t reserved;
+} TD_BinaryHeader;
+
+// A trace is a TD_TraceHeader followed by records. Every board of the history
+// gets a tick record followed by the cells in which it differs from the board
+// before it in the history, or from an empty board for the first one. A warp
+// record follows if the board went back in time, and a status record if its
+// status differs from the one of the board before.
+typedef enum
+{
+    TD_TRACE_TICK,
+    TD_TRACE_WARP,
+    TD_TRACE_STATUS,
+} TD_TraceRecordKind;
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t cols;
+    uint64_t rows;
+} TD_TraceHeader;
+
+// The meaning of `value` depends on the kind: the number of changes that follow
+// a tick, the time of the board before a warp, and the period of a looping board
+// for a status. `status` and `result` are only used by status records.
+typedef struct
+{
+    uint32_t kind;
+    uint32_t status;
+    uint64_t index;
+    uint64_t time;
+    uint64_t value;
+    int64_t result;
+} TD_TraceRecord;
+
+typedef struct
+{
+    uint32_t col;
+    uint32_t row;
+    int32_t old_kind;
+    int32_t old_value;
+    int32_t new_kind;
+    int32_t new_value;
+} TD_TraceChange;
+
+struct _TD_TraceWriter;
+
+// Trace written while the history grows, see td_trace_start. Programs without
+// time warps never look at old boards again, so they can be forgotten once they
+// are traced. Their loops are then found by comparing with a board saved at
+// doubling distances, as in Brent's algorithm.
+typedef struct
+{
+    struct _TD_TraceWriter *writer;
+    bool forget;
+
+    // Index of the next board of the history to trace, and the number of boards
+    // traced so far, which differ once boards are forgotten
+    size_t traced;
+    size_t records;
+
+    TD_Cell *loop_cells;
+    uint64_t loop_hash;
+    size_t loop_time;
+    size_t loop_distance;
+
+    // Cells changed by the board being traced
+    TD_CellIndices changes;
+} TD_Trace;
+
+// Replays a trace record by record. `cells` holds the board of the last tick
+// record read, and `changes` the changes of a tick record.
+typedef struct
+{
+    char *data;
+    size_t size;
+    size_t offset;
+
+    size_t cols;
+    size_t rows;
+    TD_Cell *cells;
+
+    TD_TraceRecord record;
+    const TD_TraceChange *changes;
+} TD_TraceReader;
+
+// A checkpoint is a TD_CheckpointHeader followed by the boards after the first
+// one that the run continues from, each a TD_CheckpointBoard followed by its
+// cells as they are laid out in memory. The first board is the one of the
+// program the checkpoint is loaded into, which has to have the same hash and
+// inputs.
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t cell_size;
+    uint32_t pruned;
+    uint64_t program_hash;
+    uint64_t cols;
+    uint64_t rows;
+    int64_t input_a;
+    int64_t input_b;
+    uint64_t boards_count;
+    uint64_t forgotten;
+    uint64_t moved_index;
+    uint64_t engine;
+    uint64_t engine_ticks[TD_ENGINE_COUNT];
+} TD_CheckpointHeader;
+
+typedef struct
+{
+    uint64_t time;
+    uint64_t hash;
+    uint64_t period;
+    int64_t result;
+    uint64_t status;
+} TD_CheckpointBoard;
+
+struct _TD_CheckpointWriter;
+
 typedef struct _TD_BoardHistory
 {
     size_t cols;
     size_t rows;
     size_t cells_bytes;
 
-    TD_Board *items;
-    size_t capacity;
+    TD_Board **chunks;
+    size_t chunks_count;
+    size_t chunks_capacity;
     size_t count;
 
     size_t tick;
     int input_a;
     int input_b;
 
+    // Boards dropped from the history since the start of the run, by a trace or
+    // by resuming from a checkpoint, which don't count towards `count`
+    size_t forgotten;
+
+    // Ticks skipped by counting loops and within leaps, whose boards were never
+    // added to the history, and all of them together
+    TD_TickJumps jumps;
+    size_t jumped;
+
     bool loaded;
 
     Arena cells_arena;
+
+    // File that td_read mapped the cells of the first board from, or NULL. Pages
+    // of it are copied on write, so the first board can be changed like the others.
+    char *mapped_data;
+    size_t mapped_size;
+
+    // Scratch buffers reused by every tick
+    TD_Timewarps timewarps;
+
+    // Loop detection
+    TD_Transpositions transpositions;
+    TD_WarpLandings warp_landings;
+
+    // Boards whose successor was computed by a plain tick, by their hash. If the
+    // last board was copied from a known future, splice_source is the board it
+    // was copied from, so its successor can be copied without another lookup.
+    TD_Transpositions transitions;
+    bool spliced;
+    size_t splice_source;
+
+    // Differential re-execution after time warps. While diverged, the last board
+    // only differs from the board at diverged_source in the cells listed in diff,
+    // so only the area around those cells has to be evaluated for the next tick.
+    bool diverged;
+    size_t diverged_source;
+    TD_CellIndices diff;
+    TD_CellIndices diff_area;
+    uint8_t *diff_distances;
+
+    TD_AffineLoops affine;
+    TD_Quadtree quadtree;
+    TD_Pruning pruning;
+    TD_InputPrefix prefix;
+    TD_SparseStorage sparse;
+    TD_SpillStorage spill;
+    TD_Trace trace;
+    struct _TD_CheckpointWriter *checkpoint;
+
+    // Program attached with td_attach, and the first board on which an operator
+    // was written to a cell that holds another kind on the first board, or
+    // SIZE_MAX. The compiled program is only used before that board.
+    const TD_CompiledProgram *compiled;
+    size_t moved_index;
+
+    TD_Superinstructions superinstructions;
+    TD_Activity activity;
 } TD_BoardHistory;
 
 typedef struct
 {
-    TD_BoardCursor timewarp_cursor;
-    TD_BoardCursor cell_cursor;
-    int value;
-    int dt;
-} TD_Timewarp;
+    // Board cells in the cells arena
+    size_t cells_used_bytes;
+    size_t cells_committed_bytes;
+    size_t cells_reserved_bytes;
 
-typedef da_array(TD_Timewarp) TD_Timewarps;
+    // Board cells in the spill file, and the part of them given back to the
+    // operating system
+    size_t spill_used_bytes;
+    size_t spill_released_bytes;
+
+    // Board headers in the history chunks
+    size_t history_used_bytes;
+    size_t history_allocated_bytes;
+
+    // Scratch buffers reused by the ticks
+    size_t scratch_bytes;
+
+    // Tables used to detect loops and to reuse computed ticks
+    size_t cache_bytes;
+
+    // Memory held by the history and the part of it that is not in use
+    size_t total_bytes;
+    size_t unused_bytes;
+} TD_MemoryUsage;
+
+// Run of a program with the inputs A and B for td_evaluate, which fills in the
+// status, the result and the ticks the run took, and its spacetime volume if it
+// is asked to measure it. Ticks are counted like td_ticks does. A tick limit of 0
+// runs the program until it stops, otherwise the run is cut short at that tick
+// with the status STATUS_RUNNING.
+typedef struct
+{
+    int input_a;
+    int input_b;
+    size_t tick_limit;
+    bool measure_volume;
+
+    TD_Status status;
+    int result;
+    size_t ticks;
+    uint64_t volume;
+} TD_Evaluation;
+
+// A result cache is a log of TD_ResultRecords that processes only ever append
+// to, each in a single write, so they can share it without locking. Every record
+// carries the magic and a checksum, so a record that was cut short is skipped.
+#define TD_RESULT_MAGIC "3DLR"
+#define TD_RESULT_VERSION 2
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+
+    // Key: the program by td_program_hash, with its inputs and the tick limit of
+    // the run, 0 for none. Runs that ended before their limit are stored without
+    // one, and are found for any limit they end before.
+    uint64_t program_hash;
+    int32_t input_a;
+    int32_t input_b;
+    uint64_t tick_limit;
+    uint32_t pruned;
+
+    uint32_t status;
+    int64_t result;
+    uint64_t ticks;
+    uint64_t volume;
+
+    uint64_t checksum;
+} TD_ResultRecord;
+
+typedef struct
+{
+    TD_ResultRecord *items;
+    size_t count;
+    size_t capacity;
+} TD_ResultRecords;
+
+// Records read from the log so far, with an open addressing table of their
+// indices plus one by key
+typedef struct
+{
+    char *path;
+    size_t read_bytes;
+    TD_ResultRecords records;
+    size_t *table;
+    size_t table_capacity;
+} TD_ResultCache;
 
 // Enum operations
 const char* td_cell_kind_name(TD_CellKind kind);
 const char* td_status_name(TD_Status status);
+const char* td_engine_name(TD_Engine engine);
 
 // Loading / Freeing
-void td_load(TD_BoardHistory* history, const char* board_def, int input_a, int input_b);
-void td_read(TD_BoardHistory* history, const char* filename, int input_a, int input_b);
+bool td_load(TD_BoardHistory* history, const char* board_def, int input_a, int input_b);
+bool td_read(TD_BoardHistory* history, const char* filename, int input_a, int input_b);
 void td_free(TD_BoardHistory* history);
+void td_reserve(TD_BoardHistory* history, size_t ticks);
+TD_MemoryUsage td_memory_usage(TD_BoardHistory* history);
+
+// Binary format
+bool td_write(TD_BoardHistory* history, const char* path);
+bool td_write_binary(TD_BoardHistory* history, const char* path);
+
+// Sparse storage
+bool td_store_sparse(TD_BoardHistory* history);
+TD_Cell* td_board_cells(TD_Board* board);
+
+// Spill storage
+bool td_spill(TD_BoardHistory* history, const char* path, size_t resident_bytes);
+
+// Execution trace
+bool td_trace_start(TD_BoardHistory* history, const char* path);
+bool td_trace_stop(TD_BoardHistory* history);
+bool td_trace_open(TD_TraceReader* reader, const char* path);
+bool td_trace_next(TD_TraceReader* reader);
+void td_trace_close(TD_TraceReader* reader);
+
+// Checkpoints
+bool td_save_checkpoint(TD_BoardHistory* history, const char* path);
+bool td_finish_checkpoint(TD_BoardHistory* history);
+bool td_load_checkpoint(TD_BoardHistory* history, const char* path);
 
 // History navigation
+TD_Board* td_board_at(TD_BoardHistory* history, size_t index);
 TD_Board* td_current_board(TD_BoardHistory* history);
 void td_forward(TD_BoardHistory* history);
 void td_back(TD_BoardHistory* history);
 void td_fast_forward(TD_BoardHistory* history);
+void td_fast_forward_ticks(TD_BoardHistory* history, size_t ticks);
+void td_fast_forward_until(TD_BoardHistory* history, size_t end, size_t steps);
+size_t td_ticks(TD_BoardHistory* history, size_t index);
 void td_rewind(TD_BoardHistory* history);
+void td_truncate(TD_BoardHistory* history, size_t count);
 void td_reset(TD_BoardHistory* history, int input_a, int input_b);
 
+// Dependency pruning
+void td_prune(TD_BoardHistory* history);
+
+// Compilation to C
+void td_write_cell(TD_Board* board, size_t index, TD_Cell value);
+bool td_calculation_defined(TD_CellKind kind, int left, int right);
+bool td_compile(TD_BoardHistory* history, const char* path);
+bool td_attach(TD_BoardHistory* history, const TD_CompiledProgram* program);
+
+// Engine selection
+uint64_t td_program_hash(TD_BoardHistory* history);
+bool td_load_profile(TD_BoardHistory* history, const char* path);
+bool td_save_profile(TD_BoardHistory* history, const char* path);
+
+// Quadtree engine
+void td_leap_forward(TD_BoardHistory* history);
+
+// Batch evaluation
+void td_evaluate(TD_BoardHistory* histories, size_t histories_count, TD_Evaluation* items, size_t count);
+
+// Result cache
+uint64_t td_spacetime_volume(TD_BoardHistory* history);
+TD_ResultRecord td_result_key(TD_BoardHistory* history, size_t tick_limit);
+void td_result_set(TD_ResultRecord* record, TD_BoardHistory* history);
+bool td_result_cache_open(TD_ResultCache* cache, const char* path);
+bool td_result_cache_read(TD_ResultCache* cache);
+bool td_result_cache_find(TD_ResultCache* cache, TD_ResultRecord* record);
+bool td_result_cache_add(TD_ResultCache* cache, TD_ResultRecord* record);
+void td_result_cache_close(TD_ResultCache* cache);
+
 // Cursor operations
 TD_BoardCursor td_cursor_first(TD_Board* board);
 TD_BoardCursor td_cursor_next(TD_BoardCursor cursor);
@@ -45,28 +45,54 @@ struct Region {
     Region *next;
     size_t count;
     size_t capacity;
+    size_t committed;
     uintptr_t data[];
 };
 
+// Only collected when ARENA_STATS is defined
+typedef struct {
+    size_t new_regions;
+    size_t skipped_regions;
+    size_t oversize_allocations;
+} Arena_Stats;
+
 typedef struct {
     Region *begin, *end;
+    Arena_Stats stats;
 } Arena;
 
+typedef struct {
+    size_t regions;
+    size_t used_bytes;
+    size_t committed_bytes;
+    size_t reserved_bytes;
+} Arena_Usage;
+
+typedef struct {
+    Region *region;
+    size_t count;
+} Arena_Mark;
+
 #define REGION_DEFAULT_CAPACITY (8*1024)
 
 Region *new_region(size_t capacity);
 void free_region(Region *r);
 
-// TODO: snapshot/rewind capability for the arena
-// - Snapshot should be combination of a->end and a->end->count.
-// - Rewinding should be restoring a->end and a->end->count from the snapshot and
-// setting count-s of all the Region-s after the remembered a->end to 0.
 void *arena_alloc(Arena *a, size_t size_bytes);
+void arena_reserve(Arena *a, size_t size_bytes);
 void *arena_realloc(Arena *a, void *oldptr, size_t oldsz, size_t newsz);
 
+// A snapshot remembers a->end and a->end->count. Rewinding to it releases everything
+// that was allocated after the snapshot was taken for reuse.
+Arena_Mark arena_snapshot(Arena *a);
+void arena_rewind(Arena *a, Arena_Mark m);
+
 void arena_reset(Arena *a);
+void arena_trim(Arena *a);
 void arena_free(Arena *a);
 
+Arena_Usage arena_usage(Arena *a);
+
 #endif // ARENA_H_
 
 #ifdef ARENA_IMPLEMENTATION
@@ -74,26 +100,115 @@ void arena_free(Arena *a);
 #if ARENA_BACKEND == ARENA_BACKEND_LIBC_MALLOC
 #include <stdlib.h>
 
+#ifndef ARENA_MALLOC
+#define ARENA_MALLOC malloc
+#endif // ARENA_MALLOC
+
+#ifndef ARENA_FREE
+#define ARENA_FREE free
+#endif // ARENA_FREE
+
 // TODO: instead of accepting specific capacity new_region() should accept the size of the object we want to fit into the region
 // It should be up to new_region() to decide the actual capacity to allocate
 Region *new_region(size_t capacity)
 {
     size_t size_bytes = sizeof(Region) + sizeof(uintptr_t)*capacity;
     // TODO: it would be nice if we could guarantee that the regions are allocated by ARENA_BACKEND_LIBC_MALLOC are page aligned
-    Region *r = malloc(size_bytes);
+    Region *r = ARENA_MALLOC(size_bytes);
     ARENA_ASSERT(r);
     r->next = NULL;
     r->count = 0;
     r->capacity = capacity;
+    r->committed = capacity;
     return r;
 }
 
 void free_region(Region *r)
 {
-    free(r);
+    ARENA_FREE(r);
 }
 #elif ARENA_BACKEND == ARENA_BACKEND_LINUX_MMAP
-#  error "TODO: Linux mmap backend is not implemented yet"
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Every region reserves at least ARENA_MMAP_RESERVE bytes of address space up front
+// and commits it in steps of ARENA_MMAP_COMMIT bytes while it is filled. The commit
+// step is also the alignment of the regions, so with ARENA_MMAP_HUGEPAGES defined
+// the kernel is able to back them with transparent huge pages.
+#ifndef ARENA_MMAP_RESERVE
+#define ARENA_MMAP_RESERVE ((size_t) 4*1024*1024*1024)
+#endif // ARENA_MMAP_RESERVE
+
+#ifndef ARENA_MMAP_COMMIT
+#define ARENA_MMAP_COMMIT ((size_t) 2*1024*1024)
+#endif // ARENA_MMAP_COMMIT
+
+#define ARENA_MMAP_ALIGN(size) (((size) + ARENA_MMAP_COMMIT - 1)/ARENA_MMAP_COMMIT*ARENA_MMAP_COMMIT)
+
+Region *new_region(size_t capacity)
+{
+    size_t size_bytes = sizeof(Region) + sizeof(uintptr_t)*capacity;
+    if (size_bytes < ARENA_MMAP_RESERVE) size_bytes = ARENA_MMAP_RESERVE;
+    size_bytes = ARENA_MMAP_ALIGN(size_bytes);
+
+    // Reserve one commit step more than needed, so the region can be aligned to it
+    size_t mapped_bytes = size_bytes + ARENA_MMAP_COMMIT;
+    char *mapped = mmap(NULL, mapped_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    ARENA_ASSERT(mapped != MAP_FAILED && "mmap() failed.");
+
+    char *begin = (char*) ARENA_MMAP_ALIGN((uintptr_t) mapped);
+    char *end = begin + size_bytes;
+    if (begin > mapped) munmap(mapped, begin - mapped);
+    if (mapped + mapped_bytes > end) munmap(end, mapped + mapped_bytes - end);
+
+#ifdef ARENA_MMAP_HUGEPAGES
+    madvise(begin, size_bytes, MADV_HUGEPAGE);
+#endif
+
+    int result = mprotect(begin, ARENA_MMAP_COMMIT, PROT_READ | PROT_WRITE);
+    ARENA_ASSERT(result == 0 && "mprotect() failed.");
+
+    Region *r = (Region*) begin;
+    r->next = NULL;
+    r->count = 0;
+    r->capacity = (size_bytes - sizeof(Region))/sizeof(uintptr_t);
+    r->committed = (ARENA_MMAP_COMMIT - sizeof(Region))/sizeof(uintptr_t);
+    return r;
+}
+
+void free_region(Region *r)
+{
+    int result = munmap(r, sizeof(Region) + sizeof(uintptr_t)*r->capacity);
+    ARENA_ASSERT(result == 0 && "munmap() failed.");
+}
+
+// Makes the first count words of the region accessible
+void region_commit(Region *r, size_t count)
+{
+    if (count <= r->committed) return;
+
+    size_t begin = sizeof(Region) + sizeof(uintptr_t)*r->committed;
+    size_t end = ARENA_MMAP_ALIGN(sizeof(Region) + sizeof(uintptr_t)*count);
+    int result = mprotect((char*) r + begin, end - begin, PROT_READ | PROT_WRITE);
+    ARENA_ASSERT(result == 0 && "mprotect() failed.");
+
+    r->committed = (end - sizeof(Region))/sizeof(uintptr_t);
+}
+
+// Gives the pages behind the used part of the region back to the operating system
+void region_decommit(Region *r)
+{
+    size_t begin = ARENA_MMAP_ALIGN(sizeof(Region) + sizeof(uintptr_t)*r->count);
+    size_t end = sizeof(Region) + sizeof(uintptr_t)*r->committed;
+    if (begin >= end) return;
+
+    int result = madvise((char*) r + begin, end - begin, MADV_DONTNEED);
+    ARENA_ASSERT(result == 0 && "madvise() failed.");
+    result = mprotect((char*) r + begin, end - begin, PROT_NONE);
+    ARENA_ASSERT(result == 0 && "mprotect() failed.");
+
+    r->committed = (begin - sizeof(Region))/sizeof(uintptr_t);
+}
 #elif ARENA_BACKEND == ARENA_BACKEND_WIN32_VIRTUALALLOC
 
 #if !defined(_WIN32)
@@ -121,6 +236,7 @@ Region *new_region(size_t capacity)
     r->next = NULL;
     r->count = 0;
     r->capacity = capacity;
+    r->committed = capacity;
     return r;
 }
 
@@ -146,11 +262,22 @@ void free_region(Region *r)
 #  error "Unknown Arena backend"
 #endif
 
-// TODO: add debug statistic collection mode for arena
-// Should collect things like:
-// - How many times new_region was called
-// - How many times existing region was skipped
-// - How many times allocation exceeded REGION_DEFAULT_CAPACITY
+#ifdef ARENA_STATS
+#define ARENA_STAT(a, stat) ((a)->stats.stat++)
+#else
+#define ARENA_STAT(a, stat) ((void) (a))
+#endif // ARENA_STATS
+
+Region *arena_new_region(Arena *a, size_t size)
+{
+    size_t capacity = REGION_DEFAULT_CAPACITY;
+    if (capacity < size) {
+        capacity = size;
+        ARENA_STAT(a, oversize_allocations);
+    }
+    ARENA_STAT(a, new_regions);
+    return new_region(capacity);
+}
 
 void *arena_alloc(Arena *a, size_t size_bytes)
 {
@@ -158,29 +285,52 @@ void *arena_alloc(Arena *a, size_t size_bytes)
 
     if (a->end == NULL) {
         ARENA_ASSERT(a->begin == NULL);
-        size_t capacity = REGION_DEFAULT_CAPACITY;
-        if (capacity < size) capacity = size;
-        a->end = new_region(capacity);
+        a->end = arena_new_region(a, size);
         a->begin = a->end;
     }
 
     while (a->end->count + size > a->end->capacity && a->end->next != NULL) {
+        ARENA_STAT(a, skipped_regions);
         a->end = a->end->next;
     }
 
     if (a->end->count + size > a->end->capacity) {
         ARENA_ASSERT(a->end->next == NULL);
-        size_t capacity = REGION_DEFAULT_CAPACITY;
-        if (capacity < size) capacity = size;
-        a->end->next = new_region(capacity);
+        a->end->next = arena_new_region(a, size);
         a->end = a->end->next;
     }
 
+#if ARENA_BACKEND == ARENA_BACKEND_LINUX_MMAP
+    region_commit(a->end, a->end->count + size);
+#endif
+
     void *result = &a->end->data[a->end->count];
     a->end->count += size;
     return result;
 }
 
+// Makes sure that the next allocations of up to size_bytes in total fit into
+// a single region, so they do not have to call new_region() anymore.
+void arena_reserve(Arena *a, size_t size_bytes)
+{
+    size_t size = (size_bytes + sizeof(uintptr_t) - 1)/sizeof(uintptr_t);
+
+    if (a->end == NULL) {
+        ARENA_ASSERT(a->begin == NULL);
+        a->end = arena_new_region(a, size);
+        a->begin = a->end;
+        return;
+    }
+
+    Region *last = a->end;
+    for (Region *r = a->end; r != NULL; r = r->next) {
+        if (r->count + size <= r->capacity) return;
+        last = r;
+    }
+
+    last->next = arena_new_region(a, size);
+}
+
 void *arena_realloc(Arena *a, void *oldptr, size_t oldsz, size_t newsz)
 {
     if (newsz <= oldsz) return oldptr;
@@ -193,6 +343,34 @@ void *arena_realloc(Arena *a, void *oldptr, size_t oldsz, size_t newsz)
     return newptr;
 }
 
+Arena_Mark arena_snapshot(Arena *a)
+{
+    Arena_Mark m;
+    if (a->end == NULL) {
+        m.region = a->begin;
+        m.count = 0;
+    } else {
+        m.region = a->end;
+        m.count = a->end->count;
+    }
+    return m;
+}
+
+void arena_rewind(Arena *a, Arena_Mark m)
+{
+    if (m.region == NULL) {
+        arena_reset(a);
+        return;
+    }
+
+    m.region->count = m.count;
+    for (Region *r = m.region->next; r != NULL; r = r->next) {
+        r->count = 0;
+    }
+
+    a->end = m.region;
+}
+
 void arena_reset(Arena *a)
 {
     for (Region *r = a->begin; r != NULL; r = r->next) {
@@ -202,6 +380,25 @@ void arena_reset(Arena *a)
     a->end = a->begin;
 }
 
+// Releases the memory that is not used by the arena anymore, i.e. the regions
+// behind a->end and, if the backend supports it, the unused tail of the regions.
+void arena_trim(Arena *a)
+{
+    if (a->end == NULL) return;
+
+#if ARENA_BACKEND == ARENA_BACKEND_LINUX_MMAP
+    region_decommit(a->end);
+#endif
+
+    Region *r = a->end->next;
+    while (r) {
+        Region *r0 = r;
+        r = r->next;
+        free_region(r0);
+    }
+    a->end->next = NULL;
+}
+
 void arena_free(Arena *a)
 {
     Region *r = a->begin;
@@ -214,4 +411,16 @@ void arena_free(Arena *a)
     a->end = NULL;
 }
 
+Arena_Usage arena_usage(Arena *a)
+{
+    Arena_Usage usage = {0};
+    for (Region *r = a->begin; r != NULL; r = r->next) {
+        usage.regions += 1;
+        usage.used_bytes += sizeof(uintptr_t)*r->count;
+        usage.committed_bytes += sizeof(Region) + sizeof(uintptr_t)*r->committed;
+        usage.reserved_bytes += sizeof(Region) + sizeof(uintptr_t)*r->capacity;
+    }
+    return usage;
+}
+
 #endif // ARENA_IMPLEMENTATION
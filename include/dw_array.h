@@ -7,7 +7,7 @@
 #   define DA_INITIAL_CAPACITY 8
 #endif
 
-#ifndef DA_MALLOC
+#ifndef DA_REALLOC
 #  define DA_REALLOC realloc
 #endif
 
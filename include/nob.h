@@ -26,9 +26,17 @@
 #ifndef NOB_H_
 #define NOB_H_
 
+#ifndef NOB_ASSERT
 #define NOB_ASSERT assert
+#endif // NOB_ASSERT
+
+#ifndef NOB_REALLOC
 #define NOB_REALLOC realloc
+#endif // NOB_REALLOC
+
+#ifndef NOB_FREE
 #define NOB_FREE free
+#endif // NOB_FREE
 
 #include <assert.h>
 #include <stdbool.h>
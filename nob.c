@@ -13,6 +13,17 @@
 #define _3D_TARGET "3d"
 #define _3D_OUTPUT BUILD_OUTPUT(_3D_TARGET)
 
+#define _3DCLI_TARGET "3dcli"
+#define _3DCLI_OUTPUT BUILD_OUTPUT(_3DCLI_TARGET)
+
+#define TEST_TARGET "test"
+#define TEST_OUTPUT BUILD_OUTPUT("3dl_test")
+#define CLI_TEST_OUTPUT BUILD_OUTPUT("3dcli_test")
+
+#define AOT_TARGET "aot"
+#define AOT_OUTPUT BUILD_OUTPUT("3dcli_aot")
+#define AOT_SOURCE "." NOB_PATH_DELIM_STR BUILD_DIR NOB_PATH_DELIM_STR "3dcli_aot.c"
+
 #define RAYLIB_TARGET "raylib"
 
 
@@ -120,6 +131,119 @@ defer:
     return result;
 }
 
+bool target_3dcli(int *argc, char*** argv) {
+    Nob_Cmd cmd = {0};
+    bool result = true;
+
+    cmd.count = 0;
+    gcc(&cmd);
+    nob_cmd_append(&cmd, "-DTD_COUNT_ALLOCATIONS", "-DARENA_STATS");
+    nob_cmd_append(&cmd, "-o", _3DCLI_OUTPUT);
+    nob_cmd_append(&cmd, "./src/3dcli.c");
+    nob_cmd_append(&cmd, "./src/3dl.c");
+    nob_cmd_append(&cmd, "-lws2_32");
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    cmd.count = 0;
+    nob_cmd_append(&cmd, _3DCLI_OUTPUT);
+    while (*argc > 0) {
+        nob_cmd_append(&cmd, nob_shift_args(argc, argv));
+    }
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+defer:
+    nob_cmd_free(cmd);
+    return result;
+}
+
+bool target_test() {
+    Nob_Cmd cmd = {0};
+    bool result = true;
+
+    cmd.count = 0;
+    gcc(&cmd);
+    nob_cmd_append(&cmd, "-o", TEST_OUTPUT);
+    nob_cmd_append(&cmd, "./tests/3dl_test.c");
+    nob_cmd_append(&cmd, "./src/3dl.c");
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    cmd.count = 0;
+    nob_cmd_append(&cmd, TEST_OUTPUT);
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    cmd.count = 0;
+    gcc(&cmd);
+    nob_cmd_append(&cmd, "-o", CLI_TEST_OUTPUT);
+    nob_cmd_append(&cmd, "./tests/3dcli_test.c");
+    nob_cmd_append(&cmd, "./src/3dl.c");
+    nob_cmd_append(&cmd, "-lws2_32");
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    cmd.count = 0;
+    nob_cmd_append(&cmd, CLI_TEST_OUTPUT);
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+defer:
+    nob_cmd_free(cmd);
+    return result;
+}
+
+// Compiles the program given as the first argument to C with the command line
+// interface, builds a command line interface that runs it natively and runs
+// that with the remaining arguments, e.g. `aot program.3dl run 3 4`.
+bool target_aot(int *argc, char*** argv) {
+    if (*argc < 2) {
+        nob_log(NOB_ERROR, "Usage: aot <program.3dl> <command> [A] [B]");
+        return false;
+    }
+    const char* program = nob_shift_args(argc, argv);
+    const char* command = nob_shift_args(argc, argv);
+
+    Nob_Cmd cmd = {0};
+    bool result = true;
+
+    cmd.count = 0;
+    gcc(&cmd);
+    nob_cmd_append(&cmd, "-DTD_COUNT_ALLOCATIONS", "-DARENA_STATS");
+    nob_cmd_append(&cmd, "-o", _3DCLI_OUTPUT);
+    nob_cmd_append(&cmd, "./src/3dcli.c");
+    nob_cmd_append(&cmd, "./src/3dl.c");
+    nob_cmd_append(&cmd, "-lws2_32");
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    // The compiled program is only attached to a run pruned the same way
+    cmd.count = 0;
+    nob_cmd_append(&cmd, _3DCLI_OUTPUT, "compile", program, AOT_SOURCE);
+    for (int i = 0; i < *argc; ++i) {
+        if (strcmp((*argv)[i], "--prune") == 0) {
+            nob_cmd_append(&cmd, "--prune");
+            break;
+        }
+    }
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    cmd.count = 0;
+    gcc(&cmd);
+    nob_cmd_append(&cmd, "-O2", "-DTD_COMPILED", "-DTD_COUNT_ALLOCATIONS", "-DARENA_STATS");
+    nob_cmd_append(&cmd, "-o", AOT_OUTPUT);
+    nob_cmd_append(&cmd, "./src/3dcli.c");
+    nob_cmd_append(&cmd, "./src/3dl.c");
+    nob_cmd_append(&cmd, AOT_SOURCE);
+    nob_cmd_append(&cmd, "-lws2_32");
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+    cmd.count = 0;
+    nob_cmd_append(&cmd, AOT_OUTPUT, command, program);
+    while (*argc > 0) {
+        nob_cmd_append(&cmd, nob_shift_args(argc, argv));
+    }
+    if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+
+defer:
+    nob_cmd_free(cmd);
+    return result;
+}
+
 int main(int argc, char **argv)
 {
     NOB_GO_REBUILD_URSELF(argc, argv);
@@ -136,6 +260,12 @@ int main(int argc, char **argv)
     const char* target = nob_shift_args(&argc, &argv);
     if (strcmp(target, _3D_TARGET) == 0) {
         if (!target_3d(&argc, &argv)) exit(1);
+    } else if (strcmp(target, _3DCLI_TARGET) == 0) {
+        if (!target_3dcli(&argc, &argv)) exit(1);
+    } else if (strcmp(target, AOT_TARGET) == 0) {
+        if (!target_aot(&argc, &argv)) exit(1);
+    } else if (strcmp(target, TEST_TARGET) == 0) {
+        if (!target_test()) exit(1);
     } else if (strcmp(target, RAYLIB_TARGET) == 0) {
         if (!target_raylib()) exit(1);
     } else {
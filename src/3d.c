@@ -31,6 +31,11 @@
 #define ACTIVE_CELL_COLOR  CLITERAL(Color){ 255, 255, 220, 255 }
 #define STOP_CELL_COLOR    CLITERAL(Color){ 255, 220, 220, 255 }
 
+// Boards of long runs are spilled to this file when the IDE is started with
+// --spill, and the last 256 MiB of them stay in memory
+#define SPILL_PATH ".3dl_spill"
+#define SPILL_RESIDENT_BYTES (256*1024*1024)
+
 typedef enum {
     UI_NONE,
     UI_FILENAME,
@@ -44,15 +49,26 @@ typedef struct {
     int gui_input_a;
     int gui_input_b;
     char gui_filename[1024];
+    bool spill;
     bool close_requested;
     Vector2 grid_scroll;
     int grid_zoom;
 } UI_State;
 
+void read_program(UI_State* state)
+{
+    if (td_read(&state->history, state->gui_filename, state->gui_input_a, state->gui_input_b) && state->spill) {
+        td_spill(&state->history, SPILL_PATH, SPILL_RESIDENT_BYTES);
+    }
+}
+
 void load_file(UI_State* state, const char* filename)
 {
     strncpy(state->gui_filename, filename, 1024);
-    td_read(&state->history, filename, state->gui_input_a, state->gui_input_b);
+    if (state->history.loaded) {
+        td_free(&state->history);
+    }
+    read_program(state);
     SetWindowTitle(TextFormat("%s - %s", state->gui_filename, PROGRAM_TITLE));
 }
 
@@ -107,6 +123,7 @@ void run_screen(UI_State *state) {
     static const int zoom_level_default = 3;
 
     TD_Board* current_board = td_current_board(&state->history);
+    bool reload_requested = false;
 
     LayoutBeginScreen(10);
     {
@@ -123,7 +140,7 @@ void run_screen(UI_State *state) {
                 }
 
                 if (GuiButton(LayoutDefault(), "#75#") || GuiIsKeyPressed(KEY_F5)) {
-                    td_read(&state->history, state->gui_filename, state->gui_input_a, state->gui_input_b);
+                    reload_requested = true;
                 }
             }
             LayoutEnd();
@@ -133,7 +150,8 @@ void run_screen(UI_State *state) {
                 LayoutBeginStack(RL_ANCHOR_RIGHT(200), DIRECTION_VERTICAL, 30, 0);
                 {
                     GuiLabel(LayoutDefault(), td_status_name(current_board->status));
-                    GuiLabel(LayoutDefault(), TextFormat("Tick %zu/%zu", state->history.tick + 1, state->history.count));
+                    GuiLabel(LayoutDefault(), TextFormat("Tick %zu/%zu", td_ticks(&state->history, state->history.tick),
+                                                             td_ticks(&state->history, state->history.count - 1)));
                     GuiLabel(LayoutDefault(), TextFormat("Time %zd", current_board->time));
 
                     LayoutSpacing(8);
@@ -170,11 +188,16 @@ void run_screen(UI_State *state) {
                     LayoutSpacing(8);
                     if (GuiButton(LayoutDefault(), "Reset") || GuiIsKeyPressed(KEY_R)) {
                         td_reset(&state->history, state->gui_input_a, state->gui_input_b);
+                        // The reset gave the cells of the later boards back
+                        current_board = td_current_board(&state->history);
                     }
 
                     if (current_board->status == STATUS_STOPPED) {
                         LayoutSpacing(8);
                         GuiLabel(LayoutDefault(), TextFormat("Result: %d", current_board->result));
+                    } else if (current_board->status == STATUS_LOOPING) {
+                        LayoutSpacing(8);
+                        GuiLabel(LayoutDefault(), TextFormat("Period: %zu", current_board->period));
                     }
                 }
                 LayoutEnd();
@@ -313,6 +336,13 @@ void run_screen(UI_State *state) {
         LayoutEnd();
     }
     LayoutEnd();
+
+    // The rest of the frame still draws the old board, so the program is only
+    // reloaded once it is done
+    if (reload_requested) {
+        td_free(&state->history);
+        read_program(state);
+    }
 }
 
 int main(int argc, char** argv)
@@ -329,6 +359,10 @@ int main(int argc, char** argv)
     SetExitKey(0);
 
     /*const char* program =*/ nob_shift_args(&argc, &argv);
+    if (argc >= 1 && strcmp(argv[0], "--spill") == 0) {
+        nob_shift_args(&argc, &argv);
+        state.spill = true;
+    }
     if (argc >= 1) {
         const char* filename = nob_shift_args(&argc, &argv);
 
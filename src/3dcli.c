@@ -0,0 +1,1874 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include <sys/stat.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <error.h>
+#include <3dl.h>
+
+#define ARENA_IMPLEMENTATION
+#include <arena.h>
+
+#define NOB_IMPLEMENTATION
+#include <nob.h>
+
+#define DW_ARRAY_IMPLEMENTATION
+#include <dw_array.h>
+
+// Engines that suited programs before, by program hash
+#define PROFILE_PATH ".3dl_profile"
+
+// Boards spilled with --spill, of which the last 64 MiB stay in memory
+#define SPILL_PATH ".3dl_spill"
+#define SPILL_RESIDENT_BYTES (64*1024*1024)
+
+// Runs with --checkpoint save one every CHECKPOINT_INTERVAL seconds, and look at
+// the clock every CHECKPOINT_TICKS ticks
+#ifndef CHECKPOINT_INTERVAL
+#define CHECKPOINT_INTERVAL 60
+#endif
+#define CHECKPOINT_TICKS 1024
+
+// `stream` reads its input in chunks of this many bytes, and evaluates all lines
+// of a chunk at once
+#define STREAM_BUFFER_SIZE (1024*1024)
+
+#ifdef TD_COMPILED
+extern const TD_CompiledProgram td_compiled_program;
+#endif
+
+void usage(const char* program) {
+    printf("Usage: %s <command> <program.3dl> [A] [B] [--sparse] [--spill] [--prune] [--checkpoint <file>] [--cache <file>]\n", program);
+    printf("       %s compile <program.3dl> <output.c> [--prune]\n", program);
+    printf("       %s convert <program.3dl> <output.3dlc> [--prune]\n", program);
+    printf("       %s trace <program.3dl> <output.3dlt> [A] [B] [--sparse] [--spill] [--prune]\n", program);
+    printf("       %s replay <trace.3dlt>\n", program);
+    printf("       %s stream <program.3dl> [--jobs <count>] [--limit <ticks>] [--prune] [--cache <file>]\n", program);
+    printf("       %s serve <socket> [--jobs <count>] [--prune] [--cache <file>]\n", program);
+    printf("       %s sweep <program.3dl> <output> <A min> <A max> <B min> <B max> [--shard <i>/<n>] [--jobs <count>] [--limit <ticks>] [--prune] [--cache <file>]\n", program);
+    printf("       %s merge <output> <shard>...\n", program);
+    printf("Commands:\n");
+    printf("    run      Run the program until it stops and print the result.\n");
+    printf("    leap     Run the program with the quadtree engine and print the result.\n");
+    printf("    bench    Run the program twice and report the cost of the second run.\n");
+    printf("    compile  Compile the program to C, to be built into the command line interface.\n");
+    printf("    convert  Convert the program to the binary format, or back if the output does not end in .3dlc.\n");
+    printf("    trace    Run the program and write the changes of every tick to a trace.\n");
+    printf("    replay   Replay a trace and print what happened in it.\n");
+    printf("    stream   Run the program for every line `A B` of the standard input and print `result status ticks`.\n");
+    printf("    serve    Answer requests `run <id> <program> <A> <B> [<ticks> [<milliseconds>]]` on a Unix domain socket.\n");
+    printf("    sweep    Run the program for every A and B in the ranges, or for shard i of n of them, and write the results.\n");
+    printf("    merge    Check that the shards of a sweep are complete, merge them and print statistics of the runs.\n");
+    printf("Options:\n");
+    printf("    --sparse Store the boards of the history run-length encoded.\n");
+    printf("    --spill  Keep the boards of the history in a file and only the last ones in memory.\n");
+    printf("    --prune  Skip the cells that can never influence an S cell. Programs may stall earlier.\n");
+    printf("    --checkpoint <file>\n");
+    printf("             Save the state of `run` to the file every %d seconds, and resume from it if it exists.\n", CHECKPOINT_INTERVAL);
+    printf("    --shard <i>/<n>\n");
+    printf("             Only run the i-th of every n runs of `sweep`, counting from 0.\n");
+    printf("    --jobs <count>\n");
+    printf("             Run `stream`, `serve` or `sweep` on this many threads.\n");
+    printf("    --limit <ticks>\n");
+    printf("             Stop the runs of `stream` or `sweep` at this tick.\n");
+    printf("    --cache <file>\n");
+    printf("             Look up the outcome of `run`, `stream`, `serve` or `sweep` in a result cache before running, and add it after.\n");
+}
+
+// Loads the program and prunes it if asked to, starts it with the engine from the
+// profile, and attaches the compiled program of builds with one, which has to be
+// compiled from the same file with the same pruning
+bool load_program(TD_BoardHistory* history, const char* filename, int input_a, int input_b, bool sparse, bool spill,
+                  bool prune) {
+    if (!td_read(history, filename, input_a, input_b)) {
+        return false;
+    }
+    if (sparse && !td_store_sparse(history)) {
+        td_free(history);
+        return false;
+    }
+    if (spill && !td_spill(history, SPILL_PATH, SPILL_RESIDENT_BYTES)) {
+        td_free(history);
+        return false;
+    }
+    if (prune) {
+        td_prune(history);
+    }
+    td_load_profile(history, PROFILE_PATH);
+#ifdef TD_COMPILED
+    if (!td_attach(history, &td_compiled_program)) {
+        td_free(history);
+        return false;
+    }
+#endif
+    return true;
+}
+
+void print_board(TD_BoardHistory* history) {
+    TD_Board* board = td_current_board(history);
+    printf("Status: %s\n", td_status_name(board->status));
+    if (board->status == STATUS_STOPPED) {
+        printf("Result: %d\n", board->result);
+    } else if (board->status == STATUS_LOOPING) {
+        printf("Period: %zu\n", board->period);
+    }
+    printf("Ticks:  %zu\n", td_ticks(history, history->tick));
+    printf("Time:   %zu\n", board->time);
+    printf("Engine: %zu %s ticks, %zu %s ticks\n",
+           history->activity.ticks[TD_ENGINE_DENSE], td_engine_name(TD_ENGINE_DENSE),
+           history->activity.ticks[TD_ENGINE_WORKLIST], td_engine_name(TD_ENGINE_WORKLIST));
+}
+
+// Prints the outcome of a run found in the result cache
+void print_record(TD_ResultRecord* record) {
+    printf("Status: %s\n", td_status_name(record->status));
+    if (record->status == STATUS_STOPPED) {
+        printf("Result: %lld\n", (long long) record->result);
+    }
+    printf("Ticks:  %llu\n", (unsigned long long) record->ticks);
+    printf("Volume: %llu\n", (unsigned long long) record->volume);
+    printf("Cached: yes\n");
+}
+
+void print_memory_usage(TD_BoardHistory* history) {
+    TD_MemoryUsage usage = td_memory_usage(history);
+    printf("Memory: %zu bytes (%zu unused)\n", usage.total_bytes, usage.unused_bytes);
+    printf("    cells:   %zu used, %zu committed, %zu reserved\n",
+           usage.cells_used_bytes, usage.cells_committed_bytes, usage.cells_reserved_bytes);
+    printf("    spill:   %zu used, %zu released\n", usage.spill_used_bytes, usage.spill_released_bytes);
+    printf("    history: %zu used, %zu allocated\n", usage.history_used_bytes, usage.history_allocated_bytes);
+    printf("    scratch: %zu\n", usage.scratch_bytes);
+#ifdef ARENA_STATS
+    Arena_Stats stats = history->cells_arena.stats;
+    printf("    arena:   %zu new regions, %zu skipped regions, %zu oversize allocations\n",
+           stats.new_regions, stats.skipped_regions, stats.oversize_allocations);
+#endif
+}
+
+// Runs the program, saving a checkpoint to `path` every CHECKPOINT_INTERVAL
+// seconds. The checkpoint is removed once the program ends.
+void run_checkpointed(TD_BoardHistory* history, const char* path) {
+    time_t saved = time(NULL);
+    while (td_current_board(history)->status == STATUS_RUNNING) {
+        td_fast_forward_until(history, SIZE_MAX, CHECKPOINT_TICKS);
+        if (difftime(time(NULL), saved) >= CHECKPOINT_INTERVAL) {
+            td_save_checkpoint(history, path);
+            saved = time(NULL);
+        }
+    }
+    td_finish_checkpoint(history);
+    remove(path);
+}
+
+int run_command(const char* filename, int input_a, int input_b, bool leap, bool sparse, bool spill, bool prune,
+                const char* checkpoint, const char* cache_path) {
+    TD_BoardHistory history;
+    if (!load_program(&history, filename, input_a, input_b, sparse, spill, prune)) {
+        return 1;
+    }
+
+    TD_ResultCache cache;
+    TD_ResultRecord record = td_result_key(&history, 0);
+    if (cache_path != NULL) {
+        if (!td_result_cache_open(&cache, cache_path)) {
+            td_free(&history);
+            return 1;
+        }
+        if (td_result_cache_find(&cache, &record)) {
+            print_record(&record);
+            td_result_cache_close(&cache);
+            td_free(&history);
+            return 0;
+        }
+    }
+
+    if (checkpoint != NULL && nob_file_exists(checkpoint) == 1) {
+        if (!td_load_checkpoint(&history, checkpoint)) {
+            td_free(&history);
+            return 1;
+        }
+        nob_log(NOB_INFO, "Resuming from checkpoint `%s` after %zu ticks.", checkpoint, td_ticks(&history, history.tick) - 1);
+    }
+
+    if (leap) {
+        td_leap_forward(&history);
+    } else if (checkpoint != NULL) {
+        run_checkpointed(&history, checkpoint);
+        td_save_profile(&history, PROFILE_PATH);
+    } else {
+        td_fast_forward(&history);
+        td_save_profile(&history, PROFILE_PATH);
+    }
+    print_board(&history);
+
+    // Runs resumed from a checkpoint don't have the boards before it anymore, and
+    // leaps don't keep the boards within them, so their volume can't be measured
+    if (cache_path != NULL) {
+        if (!leap && history.forgotten == 0) {
+            td_result_set(&record, &history);
+            td_result_cache_add(&cache, &record);
+            printf("Volume: %llu\n", (unsigned long long) record.volume);
+        }
+        td_result_cache_close(&cache);
+    }
+    print_memory_usage(&history);
+    td_free(&history);
+    return 0;
+}
+
+int bench_command(const char* filename, int input_a, int input_b, bool sparse, bool spill, bool prune) {
+    TD_BoardHistory history;
+    if (!load_program(&history, filename, input_a, input_b, sparse, spill, prune)) {
+        return 1;
+    }
+
+    // The first run warms up all buffers of the history, so the second one
+    // shows the steady state of the engine.
+    td_fast_forward(&history);
+    size_t ticks = history.count - 1;
+
+    // Dropping all boards after the first one also drops the input prefix, so
+    // the second run computes every tick again
+    td_truncate(&history, 1);
+    td_reset(&history, input_a, input_b);
+    td_reserve(&history, ticks);
+
+#ifdef TD_COUNT_ALLOCATIONS
+    size_t allocations = td_allocation_count();
+#endif
+    clock_t start = clock();
+    td_fast_forward(&history);
+    clock_t end = clock();
+
+    print_board(&history);
+    print_memory_usage(&history);
+
+    double seconds = (double) (end - start) / CLOCKS_PER_SEC;
+    printf("Run:    %.3f ms (%.3f us/tick)\n", seconds * 1000.0, ticks > 0 ? seconds * 1000000.0 / ticks : 0.0);
+
+    int exit_code = 0;
+#ifdef TD_COUNT_ALLOCATIONS
+    allocations = td_allocation_count() - allocations;
+    printf("Allocs: %zu\n", allocations);
+    if (allocations > 0) {
+        nob_log(NOB_ERROR, "Steady state run performed %zu heap allocations.", allocations);
+        exit_code = 1;
+    }
+#endif
+
+    td_free(&history);
+    return exit_code;
+}
+
+int trace_command(const char* filename, const char* output, int input_a, int input_b, bool sparse, bool spill,
+                  bool prune) {
+    TD_BoardHistory history;
+    if (!load_program(&history, filename, input_a, input_b, sparse, spill, prune)) {
+        return 1;
+    }
+    if (!td_trace_start(&history, output)) {
+        td_free(&history);
+        return 1;
+    }
+    td_fast_forward(&history);
+    bool result = td_trace_stop(&history);
+    print_board(&history);
+    print_memory_usage(&history);
+    td_free(&history);
+    return result ? 0 : 1;
+}
+
+int replay_command(const char* filename) {
+    TD_TraceReader reader;
+    if (!td_trace_open(&reader, filename)) {
+        return 1;
+    }
+
+    size_t ticks = 0;
+    size_t changes = 0;
+    size_t warps = 0;
+    TD_TraceRecord last_status = {0};
+    uint64_t last_time = 0;
+    while (td_trace_next(&reader)) {
+        switch (reader.record.kind) {
+        case TD_TRACE_TICK:
+            ticks++;
+            changes += reader.record.value;
+            last_time = reader.record.time;
+            break;
+        case TD_TRACE_WARP:
+            warps++;
+            break;
+        case TD_TRACE_STATUS:
+            last_status = reader.record;
+            break;
+        }
+    }
+
+    size_t cells = 0;
+    for (size_t i = 0; i < reader.cols * reader.rows; ++i) {
+        cells += reader.cells[i].kind != CELL_EMPTY;
+    }
+
+    printf("Status: %s\n", td_status_name(last_status.status));
+    if (last_status.status == STATUS_STOPPED) {
+        printf("Result: %lld\n", (long long) last_status.result);
+    } else if (last_status.status == STATUS_LOOPING) {
+        printf("Period: %llu\n", (unsigned long long) last_status.value);
+    }
+    printf("Ticks:  %zu\n", ticks);
+    printf("Time:   %llu\n", (unsigned long long) last_time);
+    printf("Warps:  %zu\n", warps);
+    printf("Trace:  %zu changes, %zu cells on the last board\n", changes, cells);
+    td_trace_close(&reader);
+    return 0;
+}
+
+typedef struct {
+    TD_Evaluation* items;
+    size_t count;
+    size_t capacity;
+} Evaluations;
+
+// Parses an integer of an input line, skipping the blanks before it
+bool parse_input(const char** cursor, const char* end, int* value) {
+    const char* c = *cursor;
+    while (c < end && (*c == ' ' || *c == '\t')) {
+        c++;
+    }
+    bool negative = c < end && *c == '-';
+    if (c < end && (*c == '-' || *c == '+')) {
+        c++;
+    }
+    if (c == end || !isdigit((unsigned char) *c)) {
+        return false;
+    }
+
+    long long number = 0;
+    while (c < end && isdigit((unsigned char) *c)) {
+        number = number * 10 + (*c - '0');
+        if (number > (long long) INT_MAX + 1) {
+            return false;
+        }
+        c++;
+    }
+    number = negative ? -number : number;
+    if (number > INT_MAX) {
+        return false;
+    }
+    *value = (int) number;
+    *cursor = c;
+    return true;
+}
+
+// Parses the complete lines `A B` at the start of `data` into evaluations, up to
+// the first one that is not valid. Sets `parsed` to the number of bytes parsed
+// and returns false if it stopped at a line that is not valid.
+bool parse_inputs(const char* data, size_t size, size_t tick_limit, size_t* line, Evaluations* evaluations, size_t* parsed) {
+    const char* start = data;
+    const char* end = data + size;
+    while (true) {
+        const char* line_end = memchr(start, '\n', end - start);
+        *parsed = start - data;
+        if (line_end == NULL) {
+            return true;
+        }
+        (*line)++;
+
+        const char* c = start;
+        while (c < line_end && isspace((unsigned char) *c)) {
+            c++;
+        }
+        if (c < line_end) {
+            TD_Evaluation evaluation = {.tick_limit = tick_limit};
+            if (!parse_input(&c, line_end, &evaluation.input_a) || !parse_input(&c, line_end, &evaluation.input_b)) {
+                nob_log(NOB_ERROR, "Line %zu of the input is not `A B`.", *line);
+                return false;
+            }
+            while (c < line_end && isspace((unsigned char) *c)) {
+                c++;
+            }
+            if (c < line_end) {
+                nob_log(NOB_ERROR, "Line %zu of the input is not `A B`.", *line);
+                return false;
+            }
+            nob_da_append(evaluations, evaluation);
+        }
+        start = line_end + 1;
+    }
+}
+
+// Answers the evaluations that are in the result cache from it, and runs the
+// others, adding them to the cache
+void evaluate_cached(TD_BoardHistory* histories, size_t jobs, TD_ResultCache* cache, TD_ResultRecord key,
+                     Evaluations* evaluations, Evaluations* misses) {
+    td_result_cache_read(cache);
+    misses->count = 0;
+    for (size_t i = 0; i < evaluations->count; ++i) {
+        TD_Evaluation* evaluation = &evaluations->items[i];
+        TD_ResultRecord record = key;
+        record.input_a = evaluation->input_a;
+        record.input_b = evaluation->input_b;
+        if (td_result_cache_find(cache, &record)) {
+            evaluation->status = record.status;
+            evaluation->result = (int) record.result;
+            evaluation->ticks = record.ticks;
+            evaluation->volume = record.volume;
+        } else {
+            evaluation->measure_volume = true;
+            nob_da_append(misses, *evaluation);
+        }
+    }
+
+    td_evaluate(histories, jobs, misses->items, misses->count);
+
+    size_t next = 0;
+    for (size_t i = 0; i < evaluations->count; ++i) {
+        TD_Evaluation* evaluation = &evaluations->items[i];
+        if (!evaluation->measure_volume) {
+            continue;
+        }
+        *evaluation = misses->items[next++];
+        TD_ResultRecord record = key;
+        record.input_a = evaluation->input_a;
+        record.input_b = evaluation->input_b;
+        // Inputs that occur twice in the batch are only added once
+        if (td_result_cache_find(cache, &record)) {
+            continue;
+        }
+        record.status = evaluation->status;
+        record.result = evaluation->result;
+        record.ticks = evaluation->ticks;
+        record.volume = evaluation->volume;
+        td_result_cache_add(cache, &record);
+    }
+}
+
+// Evaluates the program for input lines read from the standard input, with a
+// history per thread that is reset for every line. Every chunk read is evaluated
+// as soon as it arrives, so pipelines that wait for their results get them, and
+// the results are printed in the order of the lines.
+int stream_command(const char* filename, size_t jobs, size_t tick_limit, bool prune, const char* cache_path) {
+    TD_BoardHistory* histories = NOB_REALLOC(NULL, jobs * sizeof(TD_BoardHistory));
+    NOB_ASSERT(histories != NULL && "Buy more RAM lol");
+    for (size_t i = 0; i < jobs; ++i) {
+        if (!load_program(&histories[i], filename, 0, 0, false, false, prune)) {
+            for (size_t j = 0; j < i; ++j) {
+                td_free(&histories[j]);
+            }
+            NOB_FREE(histories);
+            return 1;
+        }
+    }
+
+    TD_ResultCache cache;
+    if (cache_path != NULL && !td_result_cache_open(&cache, cache_path)) {
+        for (size_t i = 0; i < jobs; ++i) {
+            td_free(&histories[i]);
+        }
+        NOB_FREE(histories);
+        return 1;
+    }
+    TD_ResultRecord key = td_result_key(&histories[0], tick_limit);
+
+    // One more byte ends a last line without a line break
+    char* buffer = NOB_REALLOC(NULL, STREAM_BUFFER_SIZE + 1);
+    NOB_ASSERT(buffer != NULL && "Buy more RAM lol");
+    setvbuf(stdout, NULL, _IOFBF, STREAM_BUFFER_SIZE);
+
+    Evaluations evaluations = {0};
+    Evaluations misses = {0};
+    size_t line = 0;
+    size_t buffered = 0;
+    int exit_code = 0;
+    bool end_of_input = false;
+    while (!end_of_input) {
+        if (buffered == STREAM_BUFFER_SIZE) {
+            nob_log(NOB_ERROR, "Line %zu of the input is too long.", line + 1);
+            exit_code = 1;
+            break;
+        }
+#ifdef _WIN32
+        int bytes = _read(0, buffer + buffered, STREAM_BUFFER_SIZE - buffered);
+#else
+        ssize_t bytes = read(STDIN_FILENO, buffer + buffered, STREAM_BUFFER_SIZE - buffered);
+#endif
+        if (bytes <= 0) {
+            end_of_input = true;
+            if (buffered == 0) {
+                break;
+            }
+            buffer[buffered++] = '\n';
+        } else {
+            buffered += bytes;
+        }
+
+        evaluations.count = 0;
+        size_t parsed = 0;
+        bool valid = parse_inputs(buffer, buffered, tick_limit, &line, &evaluations, &parsed);
+        memmove(buffer, buffer + parsed, buffered - parsed);
+        buffered -= parsed;
+
+        if (cache_path != NULL) {
+            evaluate_cached(histories, jobs, &cache, key, &evaluations, &misses);
+        } else {
+            td_evaluate(histories, jobs, evaluations.items, evaluations.count);
+        }
+        for (size_t i = 0; i < evaluations.count; ++i) {
+            TD_Evaluation* evaluation = &evaluations.items[i];
+            printf("%d %s %zu\n", evaluation->result, td_status_name(evaluation->status), evaluation->ticks);
+        }
+        fflush(stdout);
+        if (!valid) {
+            exit_code = 1;
+            break;
+        }
+    }
+
+    nob_da_free(evaluations);
+    nob_da_free(misses);
+    NOB_FREE(buffer);
+    if (cache_path != NULL) {
+        td_result_cache_close(&cache);
+    }
+    for (size_t i = 0; i < jobs; ++i) {
+        td_free(&histories[i]);
+    }
+    NOB_FREE(histories);
+    return exit_code;
+}
+
+// Sweeps
+
+// A sweep file starts with a header that names the program, the inputs swept,
+// the tick limit and the shard, followed by a line `A B result status ticks`
+// for every run of the shard. Shard i of n holds the runs whose index in the
+// grid of inputs, A major, leaves the remainder i when divided by n.
+#define SWEEP_MAGIC "# 3dl sweep 1"
+
+typedef struct {
+    uint64_t program_hash;
+    bool pruned;
+    int a_min;
+    int a_max;
+    int b_min;
+    int b_max;
+    size_t tick_limit;
+    size_t shard;
+    size_t shards;
+} SweepHeader;
+
+// Sweeps of more runs are refused, as merging them keeps a bit per run in memory
+// and their number could overflow
+#define SWEEP_MAX_RUNS (UINT64_C(1) << 32)
+
+size_t sweep_runs(SweepHeader* header) {
+    return (size_t) ((int64_t) header->a_max - header->a_min + 1) * (size_t) ((int64_t) header->b_max - header->b_min + 1);
+}
+
+// Checks that the grid is not empty and has at most SWEEP_MAX_RUNS runs, and that
+// the shard is one of at most that many shards
+bool sweep_header_valid(SweepHeader* header) {
+    if (header->a_min > header->a_max || header->b_min > header->b_max
+            || header->shards == 0 || header->shard >= header->shards) {
+        return false;
+    }
+    uint64_t a_count = (uint64_t) ((int64_t) header->a_max - header->a_min) + 1;
+    uint64_t b_count = (uint64_t) ((int64_t) header->b_max - header->b_min) + 1;
+    if (a_count > SWEEP_MAX_RUNS / b_count || header->shards > a_count * b_count) {
+        nob_log(NOB_ERROR, "A sweep can have at most %llu runs, and at most one shard per run.", (unsigned long long) SWEEP_MAX_RUNS);
+        return false;
+    }
+    return true;
+}
+
+void write_sweep_header(FILE* file, SweepHeader* header) {
+    fprintf(file, "%s\n", SWEEP_MAGIC);
+    fprintf(file, "# program %016llx %s\n", (unsigned long long) header->program_hash, header->pruned ? "pruned" : "unpruned");
+    fprintf(file, "# inputs %d %d %d %d\n", header->a_min, header->a_max, header->b_min, header->b_max);
+    fprintf(file, "# limit %zu\n", header->tick_limit);
+    fprintf(file, "# shard %zu %zu\n", header->shard, header->shards);
+}
+
+// Reads the header from the lines at the start of `content`
+bool read_sweep_header(Nob_String_View* content, SweepHeader* header) {
+    char line[256];
+    char pruned[16];
+    unsigned long long hash = 0;
+    bool valid = true;
+    for (int i = 0; i < 5 && valid; ++i) {
+        Nob_String_View sv = nob_sv_chop_by_delim(content, '\n');
+        if (sv.count >= sizeof(line)) {
+            return false;
+        }
+        memcpy(line, sv.data, sv.count);
+        line[sv.count] = '\0';
+
+        switch (i) {
+        case 0:
+            valid = nob_sv_eq(nob_sv_trim(sv), nob_sv_from_cstr(SWEEP_MAGIC));
+            break;
+        case 1:
+            valid = sscanf(line, "# program %llx %15s", &hash, pruned) == 2;
+            header->program_hash = hash;
+            header->pruned = strcmp(pruned, "pruned") == 0;
+            break;
+        case 2:
+            valid = sscanf(line, "# inputs %d %d %d %d", &header->a_min, &header->a_max, &header->b_min, &header->b_max) == 4;
+            break;
+        case 3:
+            valid = sscanf(line, "# limit %zu", &header->tick_limit) == 1;
+            break;
+        case 4:
+            valid = sscanf(line, "# shard %zu %zu", &header->shard, &header->shards) == 2;
+            break;
+        }
+    }
+    return valid && sweep_header_valid(header);
+}
+
+// Runs shard `shard` of `shards` of the grid of inputs from A and B min to max
+// and writes it to `output`, pruning the program if `header.pruned` asks for it
+int sweep_command(const char* filename, const char* output, SweepHeader header, size_t jobs, const char* cache_path) {
+    TD_BoardHistory* histories = NOB_REALLOC(NULL, jobs * sizeof(TD_BoardHistory));
+    NOB_ASSERT(histories != NULL && "Buy more RAM lol");
+    for (size_t i = 0; i < jobs; ++i) {
+        if (!load_program(&histories[i], filename, 0, 0, false, false, header.pruned)) {
+            for (size_t j = 0; j < i; ++j) {
+                td_free(&histories[j]);
+            }
+            NOB_FREE(histories);
+            return 1;
+        }
+    }
+    TD_ResultRecord key = td_result_key(&histories[0], header.tick_limit);
+    header.program_hash = key.program_hash;
+    header.pruned = key.pruned;
+
+    TD_ResultCache cache;
+    FILE* file = NULL;
+    bool cached = cache_path == NULL || td_result_cache_open(&cache, cache_path);
+    if (cached) {
+        file = fopen(output, "wb");
+        if (file == NULL) {
+            nob_log(NOB_ERROR, "Could not open `%s` for writing.", output);
+        }
+    }
+    if (file == NULL) {
+        if (cached && cache_path != NULL) {
+            td_result_cache_close(&cache);
+        }
+        for (size_t i = 0; i < jobs; ++i) {
+            td_free(&histories[i]);
+        }
+        NOB_FREE(histories);
+        return 1;
+    }
+    write_sweep_header(file, &header);
+
+    Evaluations evaluations = {0};
+    Evaluations misses = {0};
+    size_t runs = sweep_runs(&header);
+    size_t b_count = (size_t) ((int64_t) header.b_max - header.b_min + 1);
+    size_t swept = 0;
+    for (size_t index = header.shard; index < runs;) {
+        evaluations.count = 0;
+        for (; index < runs && evaluations.count < STREAM_BUFFER_SIZE / 16; index += header.shards) {
+            TD_Evaluation evaluation = {
+                .input_a = (int) (header.a_min + (int64_t) (index / b_count)),
+                .input_b = (int) (header.b_min + (int64_t) (index % b_count)),
+                .tick_limit = header.tick_limit,
+            };
+            nob_da_append(&evaluations, evaluation);
+        }
+
+        if (cache_path != NULL) {
+            evaluate_cached(histories, jobs, &cache, key, &evaluations, &misses);
+        } else {
+            td_evaluate(histories, jobs, evaluations.items, evaluations.count);
+        }
+        for (size_t i = 0; i < evaluations.count; ++i) {
+            TD_Evaluation* evaluation = &evaluations.items[i];
+            fprintf(file, "%d %d %d %s %zu\n", evaluation->input_a, evaluation->input_b, evaluation->result,
+                    td_status_name(evaluation->status), evaluation->ticks);
+        }
+        swept += evaluations.count;
+    }
+
+    bool written = fclose(file) == 0;
+    if (!written) {
+        nob_log(NOB_ERROR, "Could not write `%s`.", output);
+    } else {
+        nob_log(NOB_INFO, "Swept %zu runs of shard %zu of %zu to `%s`.", swept, header.shard, header.shards, output);
+    }
+
+    nob_da_free(evaluations);
+    nob_da_free(misses);
+    if (cache_path != NULL) {
+        td_result_cache_close(&cache);
+    }
+    for (size_t i = 0; i < jobs; ++i) {
+        td_free(&histories[i]);
+    }
+    NOB_FREE(histories);
+    return written ? 0 : 1;
+}
+
+typedef struct {
+    int* items;
+    size_t count;
+    size_t capacity;
+} Results;
+
+typedef struct {
+    int result;
+    size_t count;
+} ResultCount;
+
+typedef struct {
+    ResultCount* items;
+    size_t count;
+    size_t capacity;
+} ResultCounts;
+
+// Statistics of a merged sweep
+typedef struct {
+    size_t statuses[STATUS_LOOPING + 1];
+    Results results;
+
+    // Runs by the number of bits of their ticks, so bucket k holds the runs of
+    // 2^(k-1) to 2^k - 1 ticks
+    size_t ticks[65];
+} SweepStatistics;
+
+int compare_results(const void* first, const void* second) {
+    int a = *(const int*) first;
+    int b = *(const int*) second;
+    return (a > b) - (a < b);
+}
+
+int compare_result_counts(const void* first, const void* second) {
+    const ResultCount* a = first;
+    const ResultCount* b = second;
+    if (a->count != b->count) {
+        return (a->count < b->count) ? 1 : -1;
+    }
+    return (a->result > b->result) - (a->result < b->result);
+}
+
+void print_sweep_statistics(SweepStatistics* statistics, size_t runs) {
+    printf("Runs:    %zu\n", runs);
+    for (TD_Status status = STATUS_CRASH; status <= STATUS_LOOPING; ++status) {
+        printf("%-9s%zu\n", nob_temp_sprintf("%s:", td_status_name(status)), statistics->statuses[status]);
+    }
+
+    Results* results = &statistics->results;
+    if (results->count > 0) {
+        qsort(results->items, results->count, sizeof(int), compare_results);
+    }
+    ResultCounts counts = {0};
+    for (size_t i = 0; i < results->count; ++i) {
+        if (counts.count > 0 && counts.items[counts.count - 1].result == results->items[i]) {
+            counts.items[counts.count - 1].count++;
+        } else {
+            nob_da_append(&counts, ((ResultCount) {results->items[i], 1}));
+        }
+    }
+    if (counts.count > 0) {
+        qsort(counts.items, counts.count, sizeof(ResultCount), compare_result_counts);
+    }
+    printf("Results: %zu distinct, most common:\n", counts.count);
+    for (size_t i = 0; i < counts.count && i < 10; ++i) {
+        printf("    %11d  %zu\n", counts.items[i].result, counts.items[i].count);
+    }
+    nob_da_free(counts);
+
+    printf("Ticks:\n");
+    for (size_t bits = 0; bits < NOB_ARRAY_LEN(statistics->ticks); ++bits) {
+        if (statistics->ticks[bits] == 0) {
+            continue;
+        }
+        size_t low = (bits == 0) ? 0 : (size_t) 1 << (bits - 1);
+        size_t high = (bits == 0) ? 0 : (bits == 64) ? SIZE_MAX : ((size_t) 1 << bits) - 1;
+        printf("    %10zu - %-10zu  %zu\n", low, high, statistics->ticks[bits]);
+    }
+}
+
+// Checks the runs of one shard, and appends them to the merged sweep
+bool merge_shard(const char* path, Nob_String_View content, SweepHeader* header, uint8_t* seen, FILE* output,
+                 SweepStatistics* statistics, size_t* merged) {
+    size_t b_count = (size_t) ((int64_t) header->b_max - header->b_min + 1);
+    size_t line = 5;
+    while (content.count > 0) {
+        Nob_String_View sv = nob_sv_chop_by_delim(&content, '\n');
+        line++;
+        if (nob_sv_trim(sv).count == 0) {
+            continue;
+        }
+
+        char text[128];
+        char status_name[16];
+        int input_a;
+        int input_b;
+        int result;
+        size_t ticks;
+        bool valid = sv.count < sizeof(text);
+        if (valid) {
+            memcpy(text, sv.data, sv.count);
+            text[sv.count] = '\0';
+            valid = sscanf(text, "%d %d %d %15s %zu", &input_a, &input_b, &result, status_name, &ticks) == 5
+                    && input_a >= header->a_min && input_a <= header->a_max
+                    && input_b >= header->b_min && input_b <= header->b_max;
+        }
+        TD_Status status = STATUS_CRASH;
+        while (valid && strcmp(td_status_name(status), status_name) != 0) {
+            valid = status++ < STATUS_LOOPING;
+        }
+        if (!valid) {
+            nob_log(NOB_ERROR, "%s:%zu: Not a run of the sweep.", path, line);
+            return false;
+        }
+
+        size_t index = (size_t) ((int64_t) input_a - header->a_min) * b_count + (size_t) ((int64_t) input_b - header->b_min);
+        if (index % header->shards != header->shard) {
+            nob_log(NOB_ERROR, "%s:%zu: The run of A=%d and B=%d belongs to shard %zu.", path, line, input_a, input_b,
+                    index % header->shards);
+            return false;
+        }
+        if (seen[index / 8] & (1 << (index % 8))) {
+            nob_log(NOB_ERROR, "%s:%zu: The run of A=%d and B=%d is there twice.", path, line, input_a, input_b);
+            return false;
+        }
+        seen[index / 8] |= 1 << (index % 8);
+
+        statistics->statuses[status]++;
+        if (status == STATUS_STOPPED) {
+            nob_da_append(&statistics->results, result);
+        }
+        size_t bits = 0;
+        while (bits < 64 && (ticks >> bits) != 0) {
+            bits++;
+        }
+        statistics->ticks[bits]++;
+        fprintf(output, "%s\n", text);
+        (*merged)++;
+    }
+    return true;
+}
+
+// Merges the shards of a sweep into a single sweep at `output`, after checking
+// that they belong to the same sweep and that every run is there exactly once,
+// and prints statistics of the runs
+int merge_command(const char* output, char** paths, size_t paths_count) {
+    SweepHeader sweep = {0};
+    uint8_t* seen = NULL;
+    uint8_t* shards_seen = NULL;
+    SweepStatistics statistics = {0};
+    Nob_String_Builder sb = {0};
+    size_t merged = 0;
+    int exit_code = 0;
+
+    FILE* file = fopen(output, "wb");
+    if (file == NULL) {
+        nob_log(NOB_ERROR, "Could not open `%s` for writing.", output);
+        return 1;
+    }
+
+    for (size_t i = 0; i < paths_count && exit_code == 0; ++i) {
+        sb.count = 0;
+        if (!nob_read_entire_file(paths[i], &sb)) {
+            exit_code = 1;
+            break;
+        }
+        Nob_String_View content = nob_sv_from_parts(sb.items, sb.count);
+        SweepHeader header = {0};
+        if (!read_sweep_header(&content, &header)) {
+            nob_log(NOB_ERROR, "`%s` is not a sweep.", paths[i]);
+            exit_code = 1;
+            break;
+        }
+
+        if (i == 0) {
+            sweep = header;
+            size_t runs = sweep_runs(&sweep);
+            seen = NOB_REALLOC(NULL, runs / 8 + 1);
+            shards_seen = NOB_REALLOC(NULL, sweep.shards);
+            if (seen == NULL || shards_seen == NULL) {
+                nob_log(NOB_ERROR, "Could not allocate memory for the %zu runs of the sweep.", runs);
+                exit_code = 1;
+                break;
+            }
+            memset(seen, 0, runs / 8 + 1);
+            memset(shards_seen, 0, sweep.shards);
+
+            SweepHeader merged_header = sweep;
+            merged_header.shard = 0;
+            merged_header.shards = 1;
+            write_sweep_header(file, &merged_header);
+        } else if (header.program_hash != sweep.program_hash || header.pruned != sweep.pruned
+                   || header.a_min != sweep.a_min || header.a_max != sweep.a_max
+                   || header.b_min != sweep.b_min || header.b_max != sweep.b_max
+                   || header.tick_limit != sweep.tick_limit || header.shards != sweep.shards) {
+            nob_log(NOB_ERROR, "`%s` is a shard of another sweep than `%s`.", paths[i], paths[0]);
+            exit_code = 1;
+            break;
+        }
+
+        if (shards_seen[header.shard]) {
+            nob_log(NOB_ERROR, "`%s` is shard %zu, which was merged already.", paths[i], header.shard);
+            exit_code = 1;
+            break;
+        }
+        shards_seen[header.shard] = 1;
+
+        if (!merge_shard(paths[i], content, &header, seen, file, &statistics, &merged)) {
+            exit_code = 1;
+        }
+    }
+
+    for (size_t shard = 0; exit_code == 0 && shard < sweep.shards; ++shard) {
+        if (!shards_seen[shard]) {
+            nob_log(NOB_ERROR, "Shard %zu of %zu is missing.", shard, sweep.shards);
+            exit_code = 1;
+        }
+    }
+    if (exit_code == 0 && merged != sweep_runs(&sweep)) {
+        nob_log(NOB_ERROR, "%zu of the %zu runs of the sweep are missing.", sweep_runs(&sweep) - merged, sweep_runs(&sweep));
+        exit_code = 1;
+    }
+
+    if (fclose(file) != 0 && exit_code == 0) {
+        nob_log(NOB_ERROR, "Could not write `%s`.", output);
+        exit_code = 1;
+    }
+    if (exit_code == 0) {
+        nob_log(NOB_INFO, "Merged %zu shards into `%s`.", sweep.shards, output);
+        print_sweep_statistics(&statistics, merged);
+    } else {
+        remove(output);
+    }
+
+    nob_sb_free(sb);
+    nob_da_free(statistics.results);
+    NOB_FREE(seen);
+    NOB_FREE(shards_seen);
+    return exit_code;
+}
+
+int compile_command(const char* filename, const char* output, bool prune) {
+    TD_BoardHistory history;
+    if (!td_read(&history, filename, 0, 0)) {
+        return 1;
+    }
+    if (prune) {
+        td_prune(&history);
+    }
+    bool result = td_compile(&history, output);
+    td_free(&history);
+    if (!result) {
+        return 1;
+    }
+    nob_log(NOB_INFO, "Compiled `%s` to `%s`.", filename, output);
+    return 0;
+}
+
+// Binary programs written pruned keep the result of the analysis, so loading them
+// skips it and runs them pruned
+int convert_command(const char* filename, const char* output, bool prune) {
+    TD_BoardHistory history;
+    if (!td_read(&history, filename, 0, 0)) {
+        return 1;
+    }
+
+    bool result;
+    size_t length = strlen(output);
+    if (length >= 5 && strcmp(output + length - 5, ".3dlc") == 0) {
+        if (prune) {
+            td_prune(&history);
+        }
+        result = td_write_binary(&history, output);
+    } else {
+        result = td_write(&history, output);
+    }
+    td_free(&history);
+    if (!result) {
+        return 1;
+    }
+    nob_log(NOB_INFO, "Converted `%s` to `%s`.", filename, output);
+    return 0;
+}
+
+// Daemon
+
+// `serve` reads the requests of a client in chunks of this many bytes, and looks
+// at the cancellation and deadline of a request every SERVE_SLICE_TICKS ticks
+#define SERVE_BUFFER_SIZE (64*1024)
+#define SERVE_SLICE_TICKS 64
+
+// Programs each worker keeps loaded, of which the least recently used one is
+// dropped for a new one
+#define SERVE_CACHED_PROGRAMS 16
+
+#define SERVE_ID_SIZE 64
+
+#ifdef _WIN32
+typedef SOCKET Socket;
+typedef CRITICAL_SECTION Lock;
+typedef CONDITION_VARIABLE Condition;
+#define lock_init(lock) InitializeCriticalSection(lock)
+#define lock_acquire(lock) EnterCriticalSection(lock)
+#define lock_release(lock) LeaveCriticalSection(lock)
+#define lock_destroy(lock) DeleteCriticalSection(lock)
+#define condition_init(condition) InitializeConditionVariable(condition)
+#define condition_wait(condition, lock) SleepConditionVariableCS(condition, lock, INFINITE)
+#define condition_wake(condition) WakeConditionVariable(condition)
+#define socket_close(socket) closesocket(socket)
+#else
+typedef int Socket;
+typedef pthread_mutex_t Lock;
+typedef pthread_cond_t Condition;
+#define lock_init(lock) pthread_mutex_init(lock, NULL)
+#define lock_acquire(lock) pthread_mutex_lock(lock)
+#define lock_release(lock) pthread_mutex_unlock(lock)
+#define lock_destroy(lock) pthread_mutex_destroy(lock)
+#define condition_init(condition) pthread_cond_init(condition, NULL)
+#define condition_wait(condition, lock) pthread_cond_wait(condition, lock)
+#define condition_wake(condition) pthread_cond_signal(condition)
+#define socket_close(socket) close(socket)
+#endif
+
+typedef struct {
+    Socket socket;
+    bool connected;
+
+    // Taken while a response is sent, so responses don't interleave
+    Lock lock;
+
+    // Requests of the client that are not answered yet, plus one while it is
+    // connected. Guarded by the lock of the server, and the last one to be
+    // released closes the socket.
+    size_t references;
+
+    struct _Server* server;
+} Client;
+
+typedef struct {
+    Client* client;
+    char id[SERVE_ID_SIZE];
+    int input_a;
+    int input_b;
+    size_t tick_limit;
+
+    // Microseconds of clock_microseconds
+    uint64_t received;
+    uint64_t deadline;
+
+    // Guarded by the lock of the server
+    bool cancelled;
+    char path[];
+} Request;
+
+typedef struct {
+    Request** items;
+    size_t count;
+    size_t capacity;
+} Requests;
+
+// When a file was last modified and its size, which tell whether it may have
+// changed without reading it
+typedef struct {
+    uint64_t modified;
+    uint64_t size;
+} FileVersion;
+
+typedef struct {
+    uint64_t hash;
+    uint64_t used;
+    TD_BoardHistory history;
+
+    // Path the program was last requested with and the version of that file
+    char* path;
+    FileVersion version;
+
+    // Key of the program in the result cache
+    TD_ResultRecord key;
+} CachedProgram;
+
+typedef struct {
+    CachedProgram* items;
+    size_t count;
+    size_t capacity;
+} CachedPrograms;
+
+typedef struct {
+    struct _Server* server;
+    size_t index;
+    CachedPrograms programs;
+    uint64_t uses;
+    Nob_String_Builder content;
+} Worker;
+
+typedef struct _Server {
+    Lock lock;
+    Condition queued;
+
+    // Programs are loaded one at a time, as loading uses the temporary buffer of
+    // nob, which is shared by all threads
+    Lock loading;
+
+    // Whether the programs are pruned when they are loaded
+    bool prune;
+
+    // Outcomes of runs shared by all workers, or NULL
+    TD_ResultCache* results;
+    Lock caching;
+
+    // Requests waiting for a worker from `head` on, and the request each worker
+    // is running, or NULL
+    Requests queue;
+    size_t head;
+    Request** running;
+
+    Worker* workers;
+    size_t workers_count;
+} Server;
+
+uint64_t clock_microseconds(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (counter.QuadPart / frequency.QuadPart) * 1000000
+           + (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+// FNV-1a hash of the contents of a program file
+uint64_t content_hash(Nob_String_Builder* content) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < content->count; ++i) {
+        hash = (hash ^ (uint8_t) content->items[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool file_version(const char* path, FileVersion* version) {
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_stat64(path, &status) != 0) {
+        return false;
+    }
+    version->modified = (uint64_t) status.st_mtime;
+#else
+    struct stat status;
+    if (stat(path, &status) != 0) {
+        return false;
+    }
+    version->modified = (uint64_t) status.st_mtim.tv_sec * 1000000000 + (uint64_t) status.st_mtim.tv_nsec;
+#endif
+    version->size = (uint64_t) status.st_size;
+    return true;
+}
+
+// Makes `program` the one known for the file at `path` with the given version
+void remember_path(CachedProgram* program, const char* path, FileVersion version) {
+    if (program->path == NULL || strcmp(program->path, path) != 0) {
+        NOB_FREE(program->path);
+        program->path = NOB_REALLOC(NULL, strlen(path) + 1);
+        NOB_ASSERT(program->path != NULL && "Buy more RAM lol");
+        strcpy(program->path, path);
+    }
+    program->version = version;
+}
+
+// Returns the worker's copy of the program at `path`, loading it if its contents
+// are not among the programs the worker has loaded before. A file that was not
+// modified since the last request for it is not read again.
+CachedProgram* cached_program(Worker* worker, const char* path) {
+    CachedPrograms* programs = &worker->programs;
+    FileVersion version = {0};
+    bool versioned = file_version(path, &version);
+    for (size_t i = 0; versioned && i < programs->count; ++i) {
+        CachedProgram* program = &programs->items[i];
+        if (program->path != NULL && strcmp(program->path, path) == 0
+                && program->version.modified == version.modified && program->version.size == version.size) {
+            program->used = ++worker->uses;
+            return program;
+        }
+    }
+
+    worker->content.count = 0;
+    if (!nob_read_entire_file(path, &worker->content)) {
+        return NULL;
+    }
+    uint64_t hash = content_hash(&worker->content);
+
+    size_t slot = 0;
+    for (size_t i = 0; i < programs->count; ++i) {
+        if (programs->items[i].hash == hash) {
+            programs->items[i].used = ++worker->uses;
+            remember_path(&programs->items[i], path, version);
+            return &programs->items[i];
+        }
+        if (programs->items[i].used < programs->items[slot].used) {
+            slot = i;
+        }
+    }
+
+    if (programs->count < SERVE_CACHED_PROGRAMS) {
+        slot = programs->count;
+        nob_da_append(programs, (CachedProgram) {0});
+    } else {
+        td_free(&programs->items[slot].history);
+        NOB_FREE(programs->items[slot].path);
+        programs->items[slot] = (CachedProgram) {0};
+    }
+    CachedProgram* program = &programs->items[slot];
+    lock_acquire(&worker->server->loading);
+    bool loaded = load_program(&program->history, path, 0, 0, false, false, worker->server->prune);
+    lock_release(&worker->server->loading);
+    if (!loaded) {
+        programs->items[slot] = programs->items[--programs->count];
+        return NULL;
+    }
+    program->hash = hash;
+    program->used = ++worker->uses;
+    remember_path(program, path, version);
+    program->key = td_result_key(&program->history, 0);
+    return program;
+}
+
+void release_client(Client* client) {
+    lock_acquire(&client->server->lock);
+    bool last = --client->references == 0;
+    lock_release(&client->server->lock);
+    if (last) {
+        socket_close(client->socket);
+        lock_destroy(&client->lock);
+        NOB_FREE(client);
+    }
+}
+
+void send_response(Client* client, const char* response, size_t length) {
+    lock_acquire(&client->lock);
+    while (client->connected && length > 0) {
+        int sent = send(client->socket, response, (int) length, 0);
+        if (sent <= 0) {
+            break;
+        }
+        response += sent;
+        length -= sent;
+    }
+    lock_release(&client->lock);
+}
+
+bool request_cancelled(Server* server, Request* request) {
+    lock_acquire(&server->lock);
+    bool cancelled = request->cancelled;
+    lock_release(&server->lock);
+    return cancelled;
+}
+
+// Looks the request up in the result cache of the server. Outcomes added by
+// other processes are read when it is not found.
+bool find_result(Server* server, TD_ResultRecord* record) {
+    lock_acquire(&server->caching);
+    bool found = td_result_cache_find(server->results, record);
+    if (!found && td_result_cache_read(server->results)) {
+        found = td_result_cache_find(server->results, record);
+    }
+    lock_release(&server->caching);
+    return found;
+}
+
+// Runs the request in slices of SERVE_SLICE_TICKS ticks, and answers it with
+// `id result status ticks microseconds`. Requests that are in the result cache
+// are answered from it, and the ones that run to their end are added to it.
+void run_request(Worker* worker, Request* request) {
+    Server* server = worker->server;
+    const char* status = NULL;
+    int result = 0;
+    size_t ticks = 0;
+    if (request_cancelled(server, request)) {
+        status = "Cancelled";
+    } else if (clock_microseconds() >= request->deadline) {
+        status = "Timeout";
+    }
+
+    CachedProgram* program = NULL;
+    if (status == NULL) {
+        program = cached_program(worker, request->path);
+        if (program == NULL) {
+            status = "Error";
+        }
+    }
+
+    TD_ResultRecord record = {0};
+    if (status == NULL && server->results != NULL) {
+        record = program->key;
+        record.input_a = request->input_a;
+        record.input_b = request->input_b;
+        record.tick_limit = request->tick_limit;
+        if (find_result(server, &record)) {
+            status = td_status_name(record.status);
+            result = (int) record.result;
+            ticks = record.ticks;
+        }
+    }
+
+    if (status == NULL) {
+        TD_BoardHistory* history = &program->history;
+        td_reset(history, request->input_a, request->input_b);
+        size_t limit = (request->tick_limit == 0) ? SIZE_MAX : request->tick_limit;
+        while (td_current_board(history)->status == STATUS_RUNNING && td_ticks(history, history->tick) < limit) {
+            if (request_cancelled(server, request)) {
+                status = "Cancelled";
+                break;
+            }
+            if (clock_microseconds() >= request->deadline) {
+                status = "Timeout";
+                break;
+            }
+            td_fast_forward_until(history, limit, SERVE_SLICE_TICKS);
+        }
+
+        TD_Board* board = td_current_board(history);
+        result = board->result;
+        ticks = td_ticks(history, history->tick);
+        if (status == NULL) {
+            status = td_status_name(board->status);
+            if (server->results != NULL) {
+                td_result_set(&record, history);
+                lock_acquire(&server->caching);
+                td_result_cache_add(server->results, &record);
+                lock_release(&server->caching);
+            }
+        }
+    }
+
+    char response[SERVE_ID_SIZE + 128];
+    int length = snprintf(response, sizeof(response), "%s %d %s %zu %llu\n", request->id, result, status, ticks,
+                          (unsigned long long) (clock_microseconds() - request->received));
+    send_response(request->client, response, length);
+}
+
+void serve_requests(Worker* worker) {
+    Server* server = worker->server;
+    while (true) {
+        lock_acquire(&server->lock);
+        while (server->head == server->queue.count) {
+            condition_wait(&server->queued, &server->lock);
+        }
+        Request* request = server->queue.items[server->head++];
+        if (server->head == server->queue.count) {
+            server->head = 0;
+            server->queue.count = 0;
+        } else if (server->head * 2 >= server->queue.count) {
+            server->queue.count -= server->head;
+            memmove(server->queue.items, server->queue.items + server->head, server->queue.count * sizeof(Request*));
+            server->head = 0;
+        }
+        server->running[worker->index] = request;
+        lock_release(&server->lock);
+
+        run_request(worker, request);
+
+        lock_acquire(&server->lock);
+        server->running[worker->index] = NULL;
+        lock_release(&server->lock);
+        release_client(request->client);
+        NOB_FREE(request);
+    }
+}
+
+// Cancels the requests of the client with the given id, or all of them for NULL
+void cancel_requests(Server* server, Client* client, const char* id) {
+    lock_acquire(&server->lock);
+    for (size_t i = server->head; i < server->queue.count; ++i) {
+        Request* request = server->queue.items[i];
+        if (request->client == client && (id == NULL || strcmp(request->id, id) == 0)) {
+            request->cancelled = true;
+        }
+    }
+    for (size_t i = 0; i < server->workers_count; ++i) {
+        Request* request = server->running[i];
+        if (request != NULL && request->client == client && (id == NULL || strcmp(request->id, id) == 0)) {
+            request->cancelled = true;
+        }
+    }
+    lock_release(&server->lock);
+}
+
+// Handles a line `run <id> <program> <A> <B> [<ticks> [<milliseconds>]]` or
+// `cancel <id>`. Returns false if it is neither.
+bool handle_request(Client* client, const char* line) {
+    Server* server = client->server;
+    char id[SERVE_ID_SIZE];
+    char path[4096];
+    int input_a = 0;
+    int input_b = 0;
+    unsigned long long tick_limit = 0;
+    unsigned long long milliseconds = 0;
+
+    if (sscanf(line, " cancel %63s", id) == 1) {
+        cancel_requests(server, client, id);
+        return true;
+    }
+    if (sscanf(line, " run %63s %4095s %d %d %llu %llu", id, path, &input_a, &input_b, &tick_limit, &milliseconds) < 4) {
+        return false;
+    }
+
+    size_t path_size = strlen(path) + 1;
+    Request* request = NOB_REALLOC(NULL, sizeof(Request) + path_size);
+    NOB_ASSERT(request != NULL && "Buy more RAM lol");
+    *request = (Request) {
+        .client = client,
+        .input_a = input_a,
+        .input_b = input_b,
+        .tick_limit = tick_limit,
+        .received = clock_microseconds(),
+    };
+    request->deadline = (milliseconds == 0) ? UINT64_MAX : request->received + milliseconds * 1000;
+    memcpy(request->id, id, sizeof(id));
+    memcpy(request->path, path, path_size);
+
+    lock_acquire(&server->lock);
+    client->references++;
+    nob_da_append(&server->queue, request);
+    condition_wake(&server->queued);
+    lock_release(&server->lock);
+    return true;
+}
+
+// Reads the requests of the client until it disconnects, and cancels the ones
+// that are not answered yet then
+void serve_client(Client* client) {
+    char* buffer = NOB_REALLOC(NULL, SERVE_BUFFER_SIZE + 1);
+    NOB_ASSERT(buffer != NULL && "Buy more RAM lol");
+    size_t buffered = 0;
+    while (buffered < SERVE_BUFFER_SIZE) {
+        int bytes = recv(client->socket, buffer + buffered, (int) (SERVE_BUFFER_SIZE - buffered), 0);
+        if (bytes <= 0) {
+            break;
+        }
+        buffered += bytes;
+
+        char* start = buffer;
+        char* end;
+        while ((end = memchr(start, '\n', buffer + buffered - start)) != NULL) {
+            *end = '\0';
+            if (!handle_request(client, start)) {
+                const char* response = "error Invalid request, expected `run <id> <program> <A> <B> [<ticks> [<milliseconds>]]` or `cancel <id>`.\n";
+                send_response(client, response, strlen(response));
+            }
+            start = end + 1;
+        }
+        buffered -= start - buffer;
+        memmove(buffer, start, buffered);
+    }
+    NOB_FREE(buffer);
+
+    lock_acquire(&client->lock);
+    client->connected = false;
+    lock_release(&client->lock);
+    cancel_requests(client->server, client, NULL);
+    release_client(client);
+}
+
+#ifdef _WIN32
+DWORD WINAPI serve_requests_thread(LPVOID worker) {
+    serve_requests(worker);
+    return 0;
+}
+
+DWORD WINAPI serve_client_thread(LPVOID client) {
+    serve_client(client);
+    return 0;
+}
+#else
+void* serve_requests_thread(void* worker) {
+    serve_requests(worker);
+    return NULL;
+}
+
+void* serve_client_thread(void* client) {
+    serve_client(client);
+    return NULL;
+}
+#endif
+
+#ifdef _WIN32
+void start_thread(LPTHREAD_START_ROUTINE function, void* argument) {
+    HANDLE thread = CreateThread(NULL, 0, function, argument, 0, NULL);
+    NOB_ASSERT(thread != NULL && "Could not start a thread");
+    CloseHandle(thread);
+}
+#else
+void start_thread(void* (*function)(void*), void* argument) {
+    pthread_t thread;
+    int error = pthread_create(&thread, NULL, function, argument);
+    NOB_ASSERT(error == 0 && "Could not start a thread");
+    pthread_detach(thread);
+}
+#endif
+
+// Answers requests of clients connecting to the Unix domain socket at `path` on
+// `jobs` workers. Each worker keeps the programs it ran loaded by the hash of
+// their contents, and resets them for every request. Runs until it is killed.
+int serve_command(const char* path, size_t jobs, bool prune, const char* cache_path) {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        nob_log(NOB_ERROR, "Could not start Winsock.");
+        return 1;
+    }
+#else
+    // Responses to clients that disconnected fail instead of stopping the daemon
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        nob_log(NOB_ERROR, "The socket path `%s` is too long.", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    Socket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+#ifdef _WIN32
+    if (listener == INVALID_SOCKET) {
+#else
+    if (listener < 0) {
+#endif
+        nob_log(NOB_ERROR, "Could not create a socket.");
+        return 1;
+    }
+    // A socket left behind by a daemon before would fail the bind
+    remove(path);
+    if (bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0) {
+        nob_log(NOB_ERROR, "Could not listen on the socket `%s`.", path);
+        socket_close(listener);
+        return 1;
+    }
+
+    Server server = {.prune = prune};
+    TD_ResultCache results;
+    if (cache_path != NULL) {
+        if (!td_result_cache_open(&results, cache_path)) {
+            socket_close(listener);
+            return 1;
+        }
+        server.results = &results;
+    }
+    lock_init(&server.lock);
+    lock_init(&server.loading);
+    lock_init(&server.caching);
+    condition_init(&server.queued);
+    server.workers_count = jobs;
+    server.running = NOB_REALLOC(NULL, jobs * sizeof(Request*));
+    server.workers = NOB_REALLOC(NULL, jobs * sizeof(Worker));
+    NOB_ASSERT(server.running != NULL && server.workers != NULL && "Buy more RAM lol");
+    for (size_t i = 0; i < jobs; ++i) {
+        server.running[i] = NULL;
+        server.workers[i] = (Worker) {
+            .server = &server,
+            .index = i,
+        };
+        start_thread(serve_requests_thread, &server.workers[i]);
+    }
+    nob_log(NOB_INFO, "Serving on `%s` with %zu workers.", path, jobs);
+
+    while (true) {
+        Socket connection = accept(listener, NULL, NULL);
+#ifdef _WIN32
+        if (connection == INVALID_SOCKET) {
+#else
+        if (connection < 0) {
+#endif
+            continue;
+        }
+        Client* client = NOB_REALLOC(NULL, sizeof(Client));
+        NOB_ASSERT(client != NULL && "Buy more RAM lol");
+        *client = (Client) {
+            .socket = connection,
+            .connected = true,
+            .references = 1,
+            .server = &server,
+        };
+        lock_init(&client->lock);
+        start_thread(serve_client_thread, client);
+    }
+}
+
+// Parses a whole argument as an int, unlike atoi, which takes anything
+bool parse_int(const char* arg, int* value) {
+    char* end;
+    errno = 0;
+    long long parsed = strtoll(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno != 0 || parsed < INT_MIN || parsed > INT_MAX) {
+        nob_log(NOB_ERROR, "Invalid number `%s`.", arg);
+        return false;
+    }
+    *value = (int) parsed;
+    return true;
+}
+
+bool parse_size(const char* arg, size_t* value) {
+    char* end;
+    errno = 0;
+    unsigned long long parsed = strtoull(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno != 0 || arg[0] == '-' || parsed > SIZE_MAX) {
+        nob_log(NOB_ERROR, "Invalid number `%s`.", arg);
+        return false;
+    }
+    *value = (size_t) parsed;
+    return true;
+}
+
+// Takes the value of the option `arg` from the arguments, or returns NULL if it
+// is missing
+const char* option_value(const char* arg, int* argc, char*** argv) {
+    if (*argc == 0) {
+        nob_log(NOB_ERROR, "The option `%s` needs a value.", arg);
+        return NULL;
+    }
+    return nob_shift_args(argc, argv);
+}
+
+bool unknown_option(const char* arg) {
+    nob_log(NOB_ERROR, "Unknown option `%s`.", arg);
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    const char* program = nob_shift_args(&argc, &argv);
+    if (argc < 2) {
+        usage(program);
+        return 1;
+    }
+
+    const char* command = nob_shift_args(&argc, &argv);
+    const char* filename = nob_shift_args(&argc, &argv);
+
+    if (strcmp(command, "compile") == 0) {
+        if (argc < 1) {
+            usage(program);
+            return 1;
+        }
+        const char* output = nob_shift_args(&argc, &argv);
+        bool prune = argc > 0 && strcmp(argv[0], "--prune") == 0;
+        if (argc > (prune ? 1 : 0)) {
+            usage(program);
+            return 1;
+        }
+        return compile_command(filename, output, prune);
+    }
+    if (strcmp(command, "replay") == 0) {
+        return replay_command(filename);
+    }
+    if (strcmp(command, "merge") == 0) {
+        if (argc < 1) {
+            usage(program);
+            return 1;
+        }
+        return merge_command(filename, argv, argc);
+    }
+    if (strcmp(command, "sweep") == 0) {
+        if (argc < 5) {
+            usage(program);
+            return 1;
+        }
+        const char* output = nob_shift_args(&argc, &argv);
+        SweepHeader header = {.shards = 1};
+        bool valid = parse_int(nob_shift_args(&argc, &argv), &header.a_min)
+                     && parse_int(nob_shift_args(&argc, &argv), &header.a_max)
+                     && parse_int(nob_shift_args(&argc, &argv), &header.b_min)
+                     && parse_int(nob_shift_args(&argc, &argv), &header.b_max);
+        size_t jobs = 1;
+        const char* cache = NULL;
+        while (argc > 0 && valid) {
+            const char* arg = nob_shift_args(&argc, &argv);
+            if (strcmp(arg, "--prune") == 0) {
+                header.pruned = true;
+                continue;
+            }
+            const char* value = option_value(arg, &argc, &argv);
+            if (value == NULL) {
+                valid = false;
+            } else if (strcmp(arg, "--shard") == 0) {
+                char end;
+                valid = sscanf(value, "%zu/%zu%c", &header.shard, &header.shards, &end) == 2;
+                if (!valid) {
+                    nob_log(NOB_ERROR, "Invalid shard `%s`.", value);
+                }
+            } else if (strcmp(arg, "--jobs") == 0) {
+                valid = parse_size(value, &jobs);
+            } else if (strcmp(arg, "--limit") == 0) {
+                valid = parse_size(value, &header.tick_limit);
+            } else if (strcmp(arg, "--cache") == 0) {
+                cache = value;
+            } else {
+                valid = unknown_option(arg);
+            }
+        }
+        if (!valid || jobs == 0 || !sweep_header_valid(&header)) {
+            usage(program);
+            return 1;
+        }
+        return sweep_command(filename, output, header, jobs, cache);
+    }
+
+    if (strcmp(command, "stream") == 0) {
+        size_t jobs = 1;
+        size_t tick_limit = 0;
+        bool prune = false;
+        const char* cache = NULL;
+        bool valid = true;
+        while (argc > 0 && valid) {
+            const char* arg = nob_shift_args(&argc, &argv);
+            if (strcmp(arg, "--prune") == 0) {
+                prune = true;
+                continue;
+            }
+            const char* value = option_value(arg, &argc, &argv);
+            if (value == NULL) {
+                valid = false;
+            } else if (strcmp(arg, "--jobs") == 0) {
+                valid = parse_size(value, &jobs);
+            } else if (strcmp(arg, "--limit") == 0) {
+                valid = parse_size(value, &tick_limit);
+            } else if (strcmp(arg, "--cache") == 0) {
+                cache = value;
+            } else {
+                valid = unknown_option(arg);
+            }
+        }
+        if (!valid || jobs == 0) {
+            usage(program);
+            return 1;
+        }
+        return stream_command(filename, jobs, tick_limit, prune, cache);
+    }
+
+    if (strcmp(command, "serve") == 0) {
+        size_t jobs = 1;
+        bool prune = false;
+        const char* cache = NULL;
+        bool valid = true;
+        while (argc > 0 && valid) {
+            const char* arg = nob_shift_args(&argc, &argv);
+            if (strcmp(arg, "--prune") == 0) {
+                prune = true;
+                continue;
+            }
+            const char* value = option_value(arg, &argc, &argv);
+            if (value == NULL) {
+                valid = false;
+            } else if (strcmp(arg, "--jobs") == 0) {
+                valid = parse_size(value, &jobs);
+            } else if (strcmp(arg, "--cache") == 0) {
+                cache = value;
+            } else {
+                valid = unknown_option(arg);
+            }
+        }
+        if (!valid || jobs == 0) {
+            usage(program);
+            return 1;
+        }
+        return serve_command(filename, jobs, prune, cache);
+    }
+
+    const char* output = NULL;
+    if (strcmp(command, "trace") == 0) {
+        if (argc < 1) {
+            usage(program);
+            return 1;
+        }
+        output = nob_shift_args(&argc, &argv);
+    }
+
+    if (strcmp(command, "convert") == 0) {
+        if (argc < 1) {
+            usage(program);
+            return 1;
+        }
+        const char* output = nob_shift_args(&argc, &argv);
+        bool prune = argc > 0 && strcmp(argv[0], "--prune") == 0;
+        if (argc > (prune ? 1 : 0)) {
+            usage(program);
+            return 1;
+        }
+        return convert_command(filename, output, prune);
+    }
+
+    int inputs[2] = {0};
+    size_t inputs_count = 0;
+    bool sparse = false;
+    bool spill = false;
+    bool prune = false;
+    const char* checkpoint = NULL;
+    const char* cache = NULL;
+    bool valid = true;
+    while (argc > 0 && valid) {
+        const char* arg = nob_shift_args(&argc, &argv);
+        if (strcmp(arg, "--sparse") == 0) {
+            sparse = true;
+        } else if (strcmp(arg, "--spill") == 0) {
+            spill = true;
+        } else if (strcmp(arg, "--prune") == 0) {
+            prune = true;
+        } else if (strcmp(arg, "--checkpoint") == 0) {
+            checkpoint = option_value(arg, &argc, &argv);
+            valid = checkpoint != NULL;
+        } else if (strcmp(arg, "--cache") == 0) {
+            cache = option_value(arg, &argc, &argv);
+            valid = cache != NULL;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            valid = unknown_option(arg);
+        } else if (inputs_count < NOB_ARRAY_LEN(inputs)) {
+            valid = parse_int(arg, &inputs[inputs_count++]);
+        } else {
+            nob_log(NOB_ERROR, "Unexpected argument `%s`.", arg);
+            valid = false;
+        }
+    }
+    if (!valid) {
+        usage(program);
+        return 1;
+    }
+    int input_a = inputs[0];
+    int input_b = inputs[1];
+
+    if (strcmp(command, "run") == 0) {
+        return run_command(filename, input_a, input_b, false, sparse, spill, prune, checkpoint, cache);
+    } else if (strcmp(command, "leap") == 0) {
+        return run_command(filename, input_a, input_b, true, sparse, spill, prune, NULL, NULL);
+    } else if (strcmp(command, "bench") == 0) {
+        return bench_command(filename, input_a, input_b, sparse, spill, prune);
+    } else if (strcmp(command, "trace") == 0) {
+        return trace_command(filename, output, input_a, input_b, sparse, spill, prune);
+    }
+
+    nob_log(NOB_ERROR, "Invalid command `%s`.", command);
+    usage(program);
+    return 1;
+}
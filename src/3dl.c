@@ -1,5 +1,17 @@
+#include <limits.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <3dl.h>
 #include <nob.h>
+#ifdef _WIN32
+#include <winioctl.h>
+#endif
 
 #include <dw_array.h>
 
@@ -54,479 +66,4425 @@ const char* td_status_name(TD_Status status) {
         return "Stopped";
     case STATUS_STALLED:
         return "Stalled";
+    case STATUS_LOOPING:
+        return "Looping";
     default:
         DW_UNIMPLEMENTED_MSG("Cannot retrieve status name for `%d`.", status);
     }
 }
 
-// Loading / Freeing
+const char* td_engine_name(TD_Engine engine) {
+    switch (engine) {
+    case TD_ENGINE_DENSE:
+        return "dense";
+    case TD_ENGINE_WORKLIST:
+        return "worklist";
+    default:
+        DW_UNIMPLEMENTED_MSG("Cannot retrieve engine name for `%d`.", engine);
+    }
+}
 
-void td_load(TD_BoardHistory* history, const char* board_def, int input_a, int input_b)
-{
-    history->input_a = input_a;
-    history->input_b = input_b;
+// Board hashing
 
-    Nob_String_View orig_board_description = nob_sv_from_cstr(board_def);
-    Nob_String_View board_description = orig_board_description;
+uint64_t _td_mix_hash(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
 
-    TD_Board first_board = {0};
-    first_board.history = history;
-    first_board.status = STATUS_RUNNING;
-    first_board.result = 0;
-    first_board.time = 1;
+// Empty cells do not contribute to the hash of a board, so all other cells can be
+// added and removed from it by xor-ing their hash in and out.
+uint64_t _td_cell_hash(size_t index, TD_Cell cell) {
+    if (cell.kind == CELL_EMPTY) {
+        return 0;
+    }
+    return _td_mix_hash(index * 0x9e3779b97f4a7c15ULL + (((uint64_t) cell.kind << 32) | (uint32_t) cell.value));
+}
 
-    da_array(TD_Cell) all_cells = 0;
-    while (board_description.count > 0) {
-        Nob_String_View line = nob_sv_trim_left(nob_sv_chop_by_delim(&board_description, '\n'));
-        if (line.count == 0) {
-            continue;
-        }
+uint64_t _td_board_hash(TD_Board* board) {
+    size_t count = board->history->cols * board->history->rows;
+    uint64_t hash = 0;
+    for (size_t i = 0; i < count; ++i) {
+        hash ^= _td_cell_hash(i, board->cells[i]);
+    }
+    return hash;
+}
 
-        history->rows++;
+// At most one of the boards may be stored sparsely, since there is only one view
+bool _td_same_cells(TD_Board* first, TD_Board* second) {
+    NOB_ASSERT((first->runs == NULL || second->runs == NULL) && "Only one board can be viewed at a time");
+    size_t count = first->history->cols * first->history->rows;
+    TD_Cell* first_cells = td_board_cells(first);
+    TD_Cell* second_cells = td_board_cells(second);
+    for (size_t i = 0; i < count; ++i) {
+        if (first_cells[i].kind != second_cells[i].kind || first_cells[i].value != second_cells[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        size_t cols = 0;
-        while (line.count > 0) {
-            TD_Cell cell = {0};
+// Loop detection
 
-            if (isdigit(line.data[0]) || (line.data[0] == '-' && line.count > 1 && isdigit(line.data[1]))) {
-                bool negative = line.data[0] == '-';
-                if (negative) {
-                    nob_sv_advance(line);
-                }
+void _td_transpositions_grow(TD_Transpositions* transpositions) {
+    TD_Transpositions old = *transpositions;
 
-                int n = 0;
-                while (line.count > 0 && isdigit(line.data[0])) {
-                    n = (n * 10) + (line.data[0] - 48);
-                    nob_sv_advance(line);
-                }
+    transpositions->capacity = (old.capacity == 0) ? 1024 : old.capacity * 2;
+    transpositions->items = NOB_REALLOC(NULL, transpositions->capacity * sizeof(TD_Transposition));
+    NOB_ASSERT(transpositions->items != NULL && "Buy more RAM lol");
+    memset(transpositions->items, 0, transpositions->capacity * sizeof(TD_Transposition));
+    transpositions->count = 0;
+    transpositions->generation = 1;
 
-                cell.kind = CELL_NUMBER;
-                cell.value = (negative) ? -n : n;
-            } else {
-                switch (line.data[0]) {
-                case '.':
-                    cell.kind = CELL_EMPTY;
-                    break;
-                case '<':
-                    cell.kind = CELL_MOVE_LEFT;
-                    break;
-                case '>':
-                    cell.kind = CELL_MOVE_RIGHT;
-                    break;
-                case '^':
-                    cell.kind = CELL_MOVE_UP;
-                    break;
-                case 'v':
-                    cell.kind = CELL_MOVE_DOWN;
-                    break;
-                case '+':
-                    cell.kind = CELL_CALC_ADD;
-                    break;
-                case '-':
-                    cell.kind = CELL_CALC_SUBTRACT;
-                    break;
-                case '*':
-                    cell.kind = CELL_CALC_MULTIPLY;
-                    break;
-                case '/':
-                    cell.kind = CELL_CALC_DIVIDE;
-                    break;
-                case '%':
-                    cell.kind = CELL_CALC_REMAINDER;
-                    break;
-                case '@':
-                    cell.kind = CELL_TIMEWARP;
-                    break;
-                case '=':
-                    cell.kind = CELL_CMP_EQUAL;
-                    break;
-                case '#':
-                    cell.kind = CELL_CMP_NOTEQUAL;
-                    break;
-                case 'S':
-                    cell.kind = CELL_STOP;
-                    break;
-                case 'A':
-                    cell.kind = CELL_NUMBER;
-                    cell.input_kind = CELL_INPUT_A;
-                    cell.value = input_a;
-                    break;
-                case 'B':
-                    cell.kind = CELL_NUMBER;
-                    cell.input_kind = CELL_INPUT_B;
-                    cell.value = input_b;
-                    break;
-                default:
-                    DW_UNIMPLEMENTED_MSG("Unknwon cell symbol `%c`.", line.data[0]);
-                }
-                nob_sv_advance(line);
+    for (size_t i = 0; i < old.capacity; ++i) {
+        if (old.items[i].generation == old.generation) {
+            size_t slot = old.items[i].key & (transpositions->capacity - 1);
+            while (transpositions->items[slot].generation == transpositions->generation) {
+                slot = (slot + 1) & (transpositions->capacity - 1);
             }
-
-            da_add(all_cells, cell);
-
-            cols++;
-            line = nob_sv_trim_left(line);
+            transpositions->items[slot] = old.items[i];
+            transpositions->items[slot].generation = transpositions->generation;
+            transpositions->count++;
         }
-
-        history->cols = max(history->cols, cols);
     }
 
-    history->cells_bytes = history->cols * history->rows * sizeof(TD_Cell);
-    first_board.cells = arena_alloc(&history->cells_arena, history->cells_bytes);
-    memcpy(first_board.cells, all_cells, history->cells_bytes);
+    NOB_FREE(old.items);
+}
 
-    nob_da_append(history, first_board);
-    da_free(all_cells);
+// Returns the entry for `key`, which is not filled yet if its generation is outdated
+TD_Transposition* _td_transpositions_slot(TD_Transpositions* transpositions, uint64_t key) {
+    if ((transpositions->count + 1) * 2 > transpositions->capacity) {
+        _td_transpositions_grow(transpositions);
+    }
 
-    history->loaded = true;
+    size_t slot = key & (transpositions->capacity - 1);
+    while (transpositions->items[slot].generation == transpositions->generation
+            && transpositions->items[slot].key != key) {
+        slot = (slot + 1) & (transpositions->capacity - 1);
+    }
+    return &transpositions->items[slot];
 }
 
-void td_read(TD_BoardHistory* history, const char* filename, int input_a, int input_b) {
-    *history = (TD_BoardHistory) {
-        0
-    };
+void _td_transpositions_put(TD_Transpositions* transpositions, uint64_t key, size_t index) {
+    TD_Transposition* entry = _td_transpositions_slot(transpositions, key);
+    if (entry->generation != transpositions->generation) {
+        entry->key = key;
+        entry->generation = transpositions->generation;
+        transpositions->count++;
+    }
+    entry->index = index;
+}
 
-    nob_log(NOB_INFO, "Loading program `%s`.", filename);
+void _td_transpositions_clear(TD_Transpositions* transpositions) {
+    transpositions->generation++;
+    transpositions->count = 0;
+}
 
-    Nob_String_Builder file = {0};
-    nob_read_entire_file(filename, &file);
-    nob_sb_append_null(&file);
+void _td_add_warp_landing(TD_BoardHistory* history, size_t index, size_t time) {
+    TD_WarpLandings* landings = &history->warp_landings;
+    while (landings->count > 0 && landings->items[landings->count - 1].time >= time) {
+        landings->count--;
+    }
 
-    td_load(history, file.items, input_a, input_b);
-    nob_sb_free(file);
+    TD_WarpLanding landing = {
+        .index = index,
+        .time = time,
+    };
+    nob_da_append(landings, landing);
 }
 
-void td_free(TD_BoardHistory* history) {
-    nob_da_free(*history);
-    arena_free(&history->cells_arena);
+// Returns the earliest time a warp landed at after the board at `index`, or
+// SIZE_MAX if there was no warp since then.
+size_t _td_warp_landing_time_after(TD_BoardHistory* history, size_t index) {
+    TD_WarpLandings* landings = &history->warp_landings;
+    size_t low = 0;
+    size_t high = landings->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (landings->items[middle].index <= index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return (low < landings->count) ? landings->items[low].time : SIZE_MAX;
 }
 
-// Cell operations
+// The future of a board only depends on its cells and on the boards a warp can
+// reach. So the board at `index` repeats an earlier board for good if both have
+// the same cells and either
+// - no warp happened in between, or
+// - both have the same time and no warp went back further than that in between.
+// Each board is recorded under its hash for the first case and under its hash
+// combined with its time for the second one.
+void _td_detect_loop(TD_BoardHistory* history, size_t index) {
+    TD_Board* board = td_board_at(history, index);
+    if (board->status != STATUS_RUNNING) {
+        return;
+    }
 
-TD_Cell _td_make_empty_cell() {
-    return (TD_Cell) {
-        0
+    uint64_t keys[] = {
+        board->hash,
+        board->hash ^ _td_mix_hash(board->time + 1),
     };
+
+    for (size_t i = 0; i < NOB_ARRAY_LEN(keys); ++i) {
+        TD_Transposition* entry = _td_transpositions_slot(&history->transpositions, keys[i]);
+        if (entry->generation == history->transpositions.generation) {
+            TD_Board* other = td_board_at(history, entry->index);
+            size_t warp_time = _td_warp_landing_time_after(history, entry->index);
+            bool repeats = (i == 0)
+                           ? warp_time == SIZE_MAX
+                           : other->time == board->time && warp_time >= board->time;
+            if (repeats && _td_same_cells(board, other)) {
+                board->status = STATUS_LOOPING;
+                board->period = index - entry->index;
+                return;
+            }
+        }
+        _td_transpositions_put(&history->transpositions, keys[i], index);
+    }
 }
 
-TD_Cell _td_make_number_cell(int value) {
-    return (TD_Cell) {
-        .kind = CELL_NUMBER,
-        .value = value,
-    };
+// Reusing computed ticks
+
+bool _td_has_plain_successor(TD_BoardHistory* history, size_t index) {
+    if (index + 1 >= history->count) {
+        return false;
+    }
+
+    TD_Board* board = td_board_at(history, index);
+    TD_Board* next_board = td_board_at(history, index + 1);
+    return next_board->time == board->time + 1 && next_board->status != STATUS_CRASH;
 }
 
-void _td_set_cell(TD_BoardCursor cursor, TD_Cell value) {
-    TD_CellInputKind old_input_kind = cursor.cell->input_kind;
-    bool stopped = cursor.cell->kind == CELL_STOP;
+// A plain tick only depends on the cells of the board. So if an earlier board with
+// the same cells was followed by a plain tick, its successor is the successor of
+// the board at `index` as well. Returns the index of such a board or SIZE_MAX.
+size_t _td_find_transition(TD_BoardHistory* history, size_t index) {
+    if (history->spliced) {
+        return _td_has_plain_successor(history, history->splice_source) ? history->splice_source : SIZE_MAX;
+    }
 
-    *cursor.cell = value;
-    cursor.cell->input_kind = old_input_kind;
-    if (stopped) {
-        cursor.board->status = STATUS_STOPPED;
-        cursor.board->result = value.value;
+    TD_Board* board = td_board_at(history, index);
+    TD_Transposition* entry = _td_transpositions_slot(&history->transitions, board->hash);
+    if (entry->generation != history->transitions.generation) {
+        return SIZE_MAX;
     }
+
+    if (entry->index < index
+            && _td_has_plain_successor(history, entry->index)
+            && _td_same_cells(board, td_board_at(history, entry->index))) {
+        return entry->index;
+    }
+    return SIZE_MAX;
 }
 
-void _td_activate_cell(TD_BoardCursor cursor) {
-    cursor.cell->active = true;
+void _td_clear_caches(TD_BoardHistory* history) {
+    _td_transpositions_clear(&history->transpositions);
+    _td_transpositions_clear(&history->transitions);
+    history->spliced = false;
+    history->diverged = false;
+    history->activity.recorded_index = SIZE_MAX;
 }
 
-// History navigation
+// Sparse storage
 
-TD_Board* td_current_board(TD_BoardHistory* history) {
-    return &history->items[history->tick];
+bool _td_is_blank(TD_Cell cell) {
+    return cell.kind == CELL_EMPTY && cell.input_kind == CELL_INPUT_NONE && cell.value == 0 && !cell.active;
 }
 
-bool _td_retrieve_operands(TD_BoardCursor cursor,
-                           TD_Cell** left, TD_Cell** right) {
-    *left = td_cursor_left(cursor).cell;
-    *right = td_cursor_up(cursor).cell;
-    return (*left)->kind == CELL_NUMBER
-           && (*right)->kind == CELL_NUMBER;
-}
+// Encodes `count` cells into `runs` and returns the size of the encoding. With
+// `runs` NULL only the size is computed.
+size_t _td_encode_runs(const TD_Cell* cells, size_t count, TD_CellRun* runs) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < count;) {
+        TD_CellRun run = {0};
+        while (i < count && _td_is_blank(cells[i])) {
+            run.empty++;
+            i++;
+        }
+        size_t start = i;
+        while (i < count && !_td_is_blank(cells[i])) {
+            i++;
+        }
+        run.count = i - start;
 
-bool _td_retrieve_timewarp_operands(TD_BoardCursor cursor,
-                                    TD_Cell** op_v, TD_Cell** op_dx, TD_Cell** op_dy, TD_Cell** op_dt) {
-    *op_v = td_cursor_up(cursor).cell;
-    *op_dx = td_cursor_left(cursor).cell;
-    *op_dy = td_cursor_right(cursor).cell;
-    *op_dt = td_cursor_down(cursor).cell;
-    return (*op_v)->kind == CELL_NUMBER
-           && (*op_dx)->kind == CELL_NUMBER
-           && (*op_dy)->kind == CELL_NUMBER
-           && (*op_dt)->kind == CELL_NUMBER;
+        if (runs != NULL) {
+            char* data = (char*) runs + bytes;
+            memcpy(data, &run, sizeof(run));
+            memcpy(data + sizeof(run), &cells[start], run.count * sizeof(TD_Cell));
+        }
+        bytes += sizeof(run) + run.count * sizeof(TD_Cell);
+    }
+    return bytes;
 }
 
-void _td_calculate(TD_BoardCursor cursor, int value) {
-    _td_set_cell(td_cursor_left(cursor), _td_make_empty_cell());
-    _td_set_cell(td_cursor_up(cursor), _td_make_empty_cell());
-    _td_set_cell(td_cursor_right(cursor), _td_make_number_cell(value));
-    _td_set_cell(td_cursor_down(cursor), _td_make_number_cell(value));
-    _td_activate_cell(cursor);
-    _td_activate_cell(td_cursor_right(cursor));
-    _td_activate_cell(td_cursor_down(cursor));
+void _td_decode_runs(const TD_CellRun* runs, TD_Cell* cells, size_t count) {
+    const char* data = (const char*) runs;
+    for (size_t i = 0; i < count;) {
+        TD_CellRun run;
+        memcpy(&run, data, sizeof(run));
+        data += sizeof(run);
+
+        memset(&cells[i], 0, run.empty * sizeof(TD_Cell));
+        i += run.empty;
+        memcpy(&cells[i], data, run.count * sizeof(TD_Cell));
+        i += run.count;
+        data += run.count * sizeof(TD_Cell);
+    }
 }
 
-void _td_move_left(TD_BoardCursor cursor, TD_Cell* operand) {
-    _td_set_cell(td_cursor_right(cursor), _td_make_empty_cell());
-    _td_set_cell(td_cursor_left(cursor), *operand);
-    _td_activate_cell(cursor);
-    _td_activate_cell(td_cursor_left(cursor));
+// Copies the cells of `board` to `cells`, decoding them if the board is stored sparsely
+void _td_read_cells(TD_BoardHistory* history, TD_Board* board, TD_Cell* cells) {
+    if (board->runs != NULL) {
+        _td_decode_runs(board->runs, cells, history->cols * history->rows);
+    } else {
+        memcpy(cells, board->cells, history->cells_bytes);
+    }
 }
 
-void _td_move_right(TD_BoardCursor cursor, TD_Cell* operand) {
-    _td_set_cell(td_cursor_left(cursor), _td_make_empty_cell());
-    _td_set_cell(td_cursor_right(cursor), *operand);
-    _td_activate_cell(cursor);
-    _td_activate_cell(td_cursor_right(cursor));
+// Gives a new board its cells, from the arena, from the spill file, or from the
+// buffers of the boards encoded since when boards are stored sparsely
+void _td_alloc_cells(TD_BoardHistory* history, TD_Board* board) {
+    board->cells_mark = arena_snapshot(&history->cells_arena);
+    if (history->spill.enabled) {
+        board->cells = (TD_Cell*) (history->spill.data + history->spill.used);
+        history->spill.used += history->cells_bytes;
+        NOB_ASSERT(history->spill.used <= TD_SPILL_RESERVE && "Buy a bigger disk lol");
+    } else if (!history->sparse.enabled) {
+        board->cells = arena_alloc(&history->cells_arena, history->cells_bytes);
+    } else if (history->sparse.buffers.count > 0) {
+        board->cells = history->sparse.buffers.items[--history->sparse.buffers.count];
+    } else {
+        board->cells = NOB_REALLOC(NULL, history->cells_bytes);
+        NOB_ASSERT(board->cells != NULL && "Buy more RAM lol");
+    }
 }
 
-void _td_move_up(TD_BoardCursor cursor, TD_Cell* operand) {
-    _td_set_cell(td_cursor_down(cursor), _td_make_empty_cell());
-    _td_set_cell(td_cursor_up(cursor), *operand);
-    _td_activate_cell(cursor);
-    _td_activate_cell(td_cursor_up(cursor));
+void _td_release_view(TD_SparseStorage* sparse) {
+    if (sparse->view_board != NULL) {
+        sparse->view_board->cells = NULL;
+        sparse->view_board = NULL;
+    }
 }
 
-void _td_move_down(TD_BoardCursor cursor, TD_Cell* operand) {
-    _td_set_cell(td_cursor_up(cursor), _td_make_empty_cell());
-    _td_set_cell(td_cursor_down(cursor), *operand);
-    _td_activate_cell(cursor);
-    _td_activate_cell(td_cursor_down(cursor));
+// Encodes the boards before the last one into the cells arena. They are only
+// read again by warps, the loop detection and the reuse of computed ticks, and
+// to display them.
+void _td_pack_boards(TD_BoardHistory* history) {
+    TD_SparseStorage* sparse = &history->sparse;
+    if (!sparse->enabled) {
+        return;
+    }
+
+    size_t cells_count = history->cols * history->rows;
+    for (; sparse->packed + 1 < history->count; ++sparse->packed) {
+        TD_Board* board = td_board_at(history, sparse->packed);
+        board->cells_mark = arena_snapshot(&history->cells_arena);
+        board->runs = arena_alloc(&history->cells_arena, _td_encode_runs(board->cells, cells_count, NULL));
+        _td_encode_runs(board->cells, cells_count, board->runs);
+
+        nob_da_append(&sparse->buffers, board->cells);
+        board->cells = NULL;
+    }
 }
 
-void _td_collect_timewarps(TD_Board* board, TD_Timewarps* timewarps) {
-    TD_Cell *op_v, *op_dx, *op_dy, *op_dt;
-    TD_FOREACH(board, cursor) {
-        switch (cursor.cell->kind) {
-        case CELL_TIMEWARP: {
-            if (_td_retrieve_timewarp_operands(cursor, &op_v, &op_dx, &op_dy, &op_dt)) {
-                TD_Timewarp tw = {
-                    .timewarp_cursor = cursor,
-                    .cell_cursor = td_cursor_move(cursor, -op_dx->value, -op_dy->value),
-                    .value = op_v->value,
-                    .dt = op_dt->value,
-                };
-                da_add(*timewarps, tw);
-            }
-            break;
-        }
-        default:
-            break;
-        }
+// Drops the boards from index `count` on. The last board left is decoded again,
+// since the next tick is computed from its cells.
+void _td_sparse_truncate(TD_BoardHistory* history, size_t count) {
+    TD_SparseStorage* sparse = &history->sparse;
+    _td_release_view(sparse);
+
+    for (size_t i = (count > sparse->packed) ? count : sparse->packed; i < history->count; ++i) {
+        nob_da_append(&sparse->buffers, td_board_at(history, i)->cells);
+    }
+    if (count < sparse->packed) {
+        arena_rewind(&history->cells_arena, td_board_at(history, count)->cells_mark);
+        sparse->packed = count;
+    }
+
+    if (count > 1 && count - 1 < sparse->packed) {
+        TD_Board* board = td_board_at(history, count - 1);
+        _td_alloc_cells(history, board);
+        _td_decode_runs(board->runs, board->cells, history->cols * history->rows);
+        arena_rewind(&history->cells_arena, board->cells_mark);
+        board->runs = NULL;
+        sparse->packed = count - 1;
     }
 }
 
-TD_Board* _td_clone_board(TD_BoardHistory *history, size_t index, int time) {
-    TD_Board* board = &history->items[index];
+// Stores the boards after the first one run-length encoded from now on, keeping
+// only the last one in full. Boards before the last one are read through
+// td_board_cells. The boards of the input prefix are changed by td_reset, so
+// only the first board is kept across resets.
+bool td_store_sparse(TD_BoardHistory* history) {
+    if (history->count != 1 || history->spill.enabled) {
+        nob_log(NOB_ERROR, "Boards can only be stored sparsely from the first tick on, and not when they are spilled.");
+        return false;
+    }
 
-    TD_Board new_board = {0};
-    new_board.history = history;
-    new_board.result = 0;
-    new_board.status = STATUS_RUNNING;
-    new_board.time = time;
-    new_board.cells = arena_alloc(&history->cells_arena, history->cells_bytes);
-    memcpy(new_board.cells, board->cells, history->cells_bytes);
+    history->sparse.enabled = true;
+    history->sparse.packed = 1;
+    history->prefix.tracking = false;
+    return true;
+}
+
+// Returns the cells of `board`. A board stored sparsely is decoded into the view
+// of the history, which drops the cells of the board viewed before.
+TD_Cell* td_board_cells(TD_Board* board) {
+    if (board->runs == NULL || board->cells != NULL) {
+        return board->cells;
+    }
 
-    TD_FOREACH(&new_board, cursor) {
-        cursor.cell->active = false;
+    TD_BoardHistory* history = board->history;
+    TD_SparseStorage* sparse = &history->sparse;
+    if (sparse->view == NULL) {
+        sparse->view = NOB_REALLOC(NULL, history->cells_bytes);
+        NOB_ASSERT(sparse->view != NULL && "Buy more RAM lol");
     }
+    _td_release_view(sparse);
+    _td_decode_runs(board->runs, sparse->view, history->cols * history->rows);
+    board->cells = sparse->view;
+    sparse->view_board = board;
+    return board->cells;
+}
 
-    nob_da_append(history, new_board);
+// Spill storage
 
-    return &history->items[history->count - 1];
+size_t _td_page_size(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t) sysconf(_SC_PAGESIZE);
+#endif
 }
 
-void _td_crash(TD_BoardHistory* history) {
-    TD_Board* current_board = td_current_board(history);
-    TD_Board* next_board = _td_clone_board(history, history->count - 1, current_board->time + 1);
-    next_board->status = STATUS_CRASH;
+bool _td_is_warp_landing(TD_BoardHistory* history, size_t index) {
+    TD_WarpLandings* landings = &history->warp_landings;
+    size_t low = 0;
+    size_t high = landings->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (landings->items[middle].index < index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < landings->count && landings->items[low].index == index;
 }
 
-void td_forward(TD_BoardHistory* history) {
-    TD_Board* current_board = td_current_board(history);
-    if (current_board->status != STATUS_RUNNING) {
+// Gives the whole pages between the offsets `begin` and `end` of the spill file
+// back to the operating system. Changed pages are written to the file first.
+void _td_release_pages(TD_SpillStorage* spill, size_t begin, size_t end) {
+    begin = (begin + spill->page_size - 1) / spill->page_size * spill->page_size;
+    end = end / spill->page_size * spill->page_size;
+    if (begin >= end) {
         return;
     }
-    history->tick++;
+#ifdef _WIN32
+    // Unlocking pages that are not locked removes them from the working set
+    VirtualUnlock(spill->data + begin, end - begin);
+#else
+    madvise(spill->data + begin, end - begin, MADV_DONTNEED);
+#endif
+}
 
-    if (history->tick == history->count) {
-        TD_Timewarps timewarps = 0;
-        _td_collect_timewarps(current_board, &timewarps);
-        if (da_size(timewarps) > 0) {
-            int result_dt = 0;
-            for (size_t i = 0; i < da_size(timewarps); ++i) {
-                TD_Timewarp tw = timewarps[i];
-                if (tw.dt < 1 || (result_dt > 0 && tw.dt != result_dt)) {
-                    _td_crash(history);
-                    da_free(timewarps);
-                    return;
-                } else if (result_dt == 0) {
-                    result_dt = tw.dt;
-                }
+// Called when the history navigates to the board at `index`. If it is spilled,
+// the operating system reads its pages in one go instead of a page at a time
+// while the board is read, and the pages of the spilled board navigated to before
+// are given back again.
+void _td_page_in(TD_BoardHistory* history, size_t index) {
+    TD_SpillStorage* spill = &history->spill;
+    if (!spill->enabled) {
+        return;
+    }
 
-                for (size_t j = i + 1; j < da_size(timewarps); ++j) {
-                    TD_Timewarp two = timewarps[j];
-                    if (td_cursor_same(tw.cell_cursor, two.cell_cursor) && tw.value != two.value) {
-                        _td_crash(history);
-                        da_free(timewarps);
-                        return;
-                    }
-                }
-            }
+    size_t begin = 0;
+    size_t end = 0;
+    if (index > 0 && index < spill->spilled) {
+        size_t offset = (char*) td_board_at(history, index)->cells - spill->data;
+        begin = offset / spill->page_size * spill->page_size;
+        end = (offset + history->cells_bytes + spill->page_size - 1) / spill->page_size * spill->page_size;
+    }
 
-            size_t tw_time = current_board->time - result_dt;
-            int tw_index;
-            for (tw_index = history->count - 1; tw_index >= 0; --tw_index) {
-                if (history->items[tw_index].time == tw_time) {
-                    break;
-                }
-            }
+    size_t paged_end = (spill->paged_end < spill->released) ? spill->paged_end : spill->released;
+    _td_release_pages(spill, spill->paged_begin, (paged_end < begin) ? paged_end : begin);
+    _td_release_pages(spill, (spill->paged_begin > end) ? spill->paged_begin : end, paged_end);
+    spill->paged_begin = begin;
+    spill->paged_end = end;
+    if (begin == end) {
+        return;
+    }
 
-            if (tw_index < 0) {
-                _td_crash(history);
-                da_free(timewarps);
-                return;
-            }
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range = {
+        .VirtualAddress = spill->data + begin,
+        .NumberOfBytes = end - begin,
+    };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise(spill->data + begin, end - begin, MADV_WILLNEED);
+#endif
+}
 
-            TD_Board* next_board = _td_clone_board(history, tw_index, tw_time);
-            for (size_t i = 0; i < da_size(timewarps); ++i) {
-                TD_Timewarp tw = timewarps[i];
-                _td_set_cell(td_cursor_board(tw.cell_cursor, next_board), _td_make_number_cell(tw.value));
-                _td_activate_cell(td_cursor_board(tw.timewarp_cursor, next_board));
-                _td_activate_cell(td_cursor_board(tw.cell_cursor, next_board));
-            }
+// Spills the boards that dropped out of the resident ones since the last call.
+// Boards that warps landed on are kept, since the next warp to their time finds
+// them again.
+void _td_spill_boards(TD_BoardHistory* history) {
+    TD_SpillStorage* spill = &history->spill;
+    if (!spill->enabled || history->count <= spill->resident) {
+        return;
+    }
 
-            da_free(timewarps);
-            return;
+    size_t last = history->count - spill->resident;
+    if (spill->spilled >= last) {
+        return;
+    }
+    for (; spill->spilled < last; ++spill->spilled) {
+        if (_td_is_warp_landing(history, spill->spilled)) {
+            size_t offset = (char*) td_board_at(history, spill->spilled)->cells - spill->data;
+            _td_release_pages(spill, spill->released, offset);
+            spill->released = offset + history->cells_bytes;
         }
+    }
 
-        TD_Board* next_board = _td_clone_board(history, history->count - 1, current_board->time + 1);
-        TD_Cell *op_left,  *op_right;
-        TD_FOREACH(current_board, current_cursor) {
-            TD_BoardCursor next_cursor = td_cursor_board(current_cursor, next_board);
-            switch (current_cursor.cell->kind) {
-            case CELL_CALC_ADD: {
-                if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
-                    _td_calculate(next_cursor, op_left->value + op_right->value);
-                }
-                break;
-            }
-            case CELL_CALC_SUBTRACT: {
-                if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
-                    _td_calculate(next_cursor, op_left->value - op_right->value);
-                }
-                break;
-            }
-            case CELL_CALC_MULTIPLY: {
-                if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
-                    _td_calculate(next_cursor, op_left->value * op_right->value);
-                }
-                break;
-            }
-            case CELL_CALC_DIVIDE: {
-                if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
-                    _td_calculate(next_cursor, op_left->value / op_right->value);
-                }
-                break;
-            }
-            case CELL_CALC_REMAINDER: {
-                if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
-                    _td_calculate(next_cursor, op_left->value % op_right->value);
-                }
-                break;
-            }
-            case CELL_MOVE_LEFT: {
-                TD_Cell* operand = td_cursor_right(current_cursor).cell;
-                if (operand->kind != CELL_EMPTY) {
-                    _td_move_left(next_cursor, operand);
-                }
-                break;
-            }
-            case CELL_MOVE_RIGHT: {
-                TD_Cell* operand = td_cursor_left(current_cursor).cell;
-                if (operand->kind != CELL_EMPTY) {
-                    _td_move_right(next_cursor, operand);
-                }
-                break;
-            }
-            case CELL_MOVE_UP: {
-                TD_Cell* operand = td_cursor_down(current_cursor).cell;
-                if (operand->kind != CELL_EMPTY) {
-                    _td_move_up(next_cursor, operand);
-                }
+    size_t offset = (char*) td_board_at(history, last)->cells - spill->data;
+    _td_release_pages(spill, spill->released, offset);
+    if (spill->released < offset) {
+        spill->released = offset;
+    }
+}
+
+void _td_spill_truncate(TD_BoardHistory* history, size_t count) {
+    TD_SpillStorage* spill = &history->spill;
+    spill->used = (char*) td_board_at(history, count)->cells - spill->data;
+    if (spill->spilled > count) {
+        spill->spilled = count;
+    }
+    if (spill->released > spill->used) {
+        spill->released = spill->used;
+    }
+    spill->paged_begin = 0;
+    spill->paged_end = 0;
+}
+
+// Allocates the cells of the boards after the first one from a file at `path`
+// from now on, which is deleted again once the history is freed. The last boards
+// that fit into `resident_bytes` are kept in memory, and the pages of the boards
+// before them are left to the operating system, which reads them back from the
+// file once the boards are read again.
+bool td_spill(TD_BoardHistory* history, const char* path, size_t resident_bytes) {
+    TD_SpillStorage* spill = &history->spill;
+    if (history->count != 1 || history->sparse.enabled || spill->enabled) {
+        nob_log(NOB_ERROR, "Boards can only be spilled from the first tick on, and not when they are stored sparsely.");
+        return false;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        nob_log(NOB_ERROR, "Could not create file %s: %lu", path, GetLastError());
+        return false;
+    }
+
+    // The mapping makes the file as large as the reserve, which only takes up
+    // disk space where it is written as long as the file is sparse
+    DWORD returned;
+    DeviceIoControl(file, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &returned, NULL);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                                        (DWORD) (TD_SPILL_RESERVE >> 32), (DWORD) TD_SPILL_RESERVE, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        nob_log(NOB_ERROR, "Could not map file %s: %lu", path, GetLastError());
+        return false;
+    }
+    spill->data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    CloseHandle(mapping);
+    if (spill->data == NULL) {
+        nob_log(NOB_ERROR, "Could not map file %s: %lu", path, GetLastError());
+        return false;
+    }
+#else
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        nob_log(NOB_ERROR, "Could not create file %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    // The file stays around until it is unmapped, and extending it leaves a hole
+    // that only takes up disk space where it is written
+    unlink(path);
+    if (ftruncate(fd, TD_SPILL_RESERVE) < 0) {
+        nob_log(NOB_ERROR, "Could not extend file %s: %s", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(NULL, TD_SPILL_RESERVE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        nob_log(NOB_ERROR, "Could not map file %s: %s", path, strerror(errno));
+        return false;
+    }
+    spill->data = mapped;
+#endif
+
+    spill->enabled = true;
+    spill->used = 0;
+    spill->resident = resident_bytes / history->cells_bytes;
+    if (spill->resident < 2) {
+        spill->resident = 2;
+    }
+    spill->spilled = 1;
+    spill->released = 0;
+    spill->paged_begin = 0;
+    spill->paged_end = 0;
+    spill->page_size = _td_page_size();
+    return true;
+}
+
+// Loading / Freeing
+
+void _td_reserve_boards(TD_BoardHistory* history, size_t capacity) {
+    size_t chunks_count = (capacity + TD_HISTORY_CHUNK_SIZE - 1) >> TD_HISTORY_CHUNK_BITS;
+    if (history->chunks_capacity < chunks_count) {
+        size_t chunks_capacity = (history->chunks_capacity == 0) ? 16 : history->chunks_capacity;
+        while (chunks_capacity < chunks_count) {
+            chunks_capacity *= 2;
+        }
+        history->chunks = NOB_REALLOC(history->chunks, chunks_capacity * sizeof(*history->chunks));
+        NOB_ASSERT(history->chunks != NULL && "Buy more RAM lol");
+        history->chunks_capacity = chunks_capacity;
+    }
+
+    while (history->chunks_count < chunks_count) {
+        TD_Board* chunk = NOB_REALLOC(NULL, TD_HISTORY_CHUNK_SIZE * sizeof(TD_Board));
+        NOB_ASSERT(chunk != NULL && "Buy more RAM lol");
+        history->chunks[history->chunks_count++] = chunk;
+    }
+}
+
+TD_Board* _td_append_board(TD_BoardHistory* history, TD_Board board) {
+    _td_reserve_boards(history, history->count + 1);
+    TD_Board* result = td_board_at(history, history->count++);
+    *result = board;
+    return result;
+}
+
+// Starts following the inputs from the first board, whose input cells the
+// loaders have already listed in prefix->cells
+void _td_start_prefix(TD_BoardHistory* history) {
+    TD_InputPrefix* prefix = &history->prefix;
+    size_t cells_count = history->cols * history->rows;
+
+    prefix->inputs = NOB_REALLOC(prefix->inputs, cells_count);
+    prefix->next_inputs = NOB_REALLOC(prefix->next_inputs, cells_count);
+    NOB_ASSERT(prefix->inputs != NULL && prefix->next_inputs != NULL && "Buy more RAM lol");
+
+    prefix->tracking = true;
+    prefix->count = 1;
+    prefix->offsets.count = 0;
+    nob_da_append(&prefix->offsets, 0);
+    memset(prefix->inputs, CELL_INPUT_NONE, cells_count);
+    for (size_t i = 0; i < prefix->cells.count; ++i) {
+        size_t entry = prefix->cells.items[i];
+        prefix->inputs[entry >> 1] = (entry & 1) ? CELL_INPUT_B : CELL_INPUT_A;
+    }
+    memcpy(prefix->next_inputs, prefix->inputs, cells_count);
+    nob_da_append(&prefix->offsets, prefix->cells.count);
+}
+
+// Starts the history with its first board
+void _td_start_history(TD_BoardHistory* history, TD_Board first_board) {
+    _td_reserve_boards(history, TD_HISTORY_INITIAL_CAPACITY);
+    _td_append_board(history, first_board);
+    history->moved_index = SIZE_MAX;
+    history->activity.recorded_index = SIZE_MAX;
+    _td_detect_loop(history, 0);
+    _td_start_prefix(history);
+
+    history->loaded = true;
+}
+
+// Parsing
+
+bool _td_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool _td_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Tokens are numbers with an optional minus sign or single symbols, and don't
+// have to be separated by whitespace
+size_t _td_token_length(const char* token, const char* end) {
+    const char* p = token;
+    if (*p == '-' && p + 1 < end && _td_is_digit(p[1])) {
+        p++;
+    }
+    if (!_td_is_digit(*p)) {
+        return 1;
+    }
+    while (p < end && _td_is_digit(*p)) {
+        p++;
+    }
+    return p - token;
+}
+
+// Returns false if the token is neither a symbol nor a number that fits into a cell
+bool _td_parse_cell(const char* token, size_t length, int input_a, int input_b, TD_Cell* cell) {
+    *cell = (TD_Cell) {
+        0
+    };
+
+    if (length > 1 || _td_is_digit(token[0])) {
+        bool negative = token[0] == '-';
+        int64_t n = 0;
+        for (size_t i = negative; i < length; ++i) {
+            n = (n * 10) + (token[i] - '0');
+            if (n > (int64_t) INT_MAX + negative) {
+                return false;
+            }
+        }
+        cell->kind = CELL_NUMBER;
+        cell->value = (int) (negative ? -n : n);
+        return true;
+    }
+
+    switch (token[0]) {
+    case '.':
+        cell->kind = CELL_EMPTY;
+        break;
+    case '<':
+        cell->kind = CELL_MOVE_LEFT;
+        break;
+    case '>':
+        cell->kind = CELL_MOVE_RIGHT;
+        break;
+    case '^':
+        cell->kind = CELL_MOVE_UP;
+        break;
+    case 'v':
+        cell->kind = CELL_MOVE_DOWN;
+        break;
+    case '+':
+        cell->kind = CELL_CALC_ADD;
+        break;
+    case '-':
+        cell->kind = CELL_CALC_SUBTRACT;
+        break;
+    case '*':
+        cell->kind = CELL_CALC_MULTIPLY;
+        break;
+    case '/':
+        cell->kind = CELL_CALC_DIVIDE;
+        break;
+    case '%':
+        cell->kind = CELL_CALC_REMAINDER;
+        break;
+    case '@':
+        cell->kind = CELL_TIMEWARP;
+        break;
+    case '=':
+        cell->kind = CELL_CMP_EQUAL;
+        break;
+    case '#':
+        cell->kind = CELL_CMP_NOTEQUAL;
+        break;
+    case 'S':
+        cell->kind = CELL_STOP;
+        break;
+    case 'A':
+        cell->kind = CELL_NUMBER;
+        cell->input_kind = CELL_INPUT_A;
+        cell->value = input_a;
+        break;
+    case 'B':
+        cell->kind = CELL_NUMBER;
+        cell->input_kind = CELL_INPUT_B;
+        cell->value = input_b;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// Counts the rows and columns of the board and checks every token. Lines are
+// found with memchr, which libc implementations scan for in vector registers.
+// Lines without tokens don't count as rows.
+bool _td_measure_board(const char* data, size_t size, const char* name, size_t* cols, size_t* rows) {
+    const char* end = data + size;
+    *cols = 0;
+    *rows = 0;
+
+    size_t line_number = 1;
+    for (const char* line = data; line < end; ++line_number) {
+        const char* line_end = memchr(line, '\n', end - line);
+        if (line_end == NULL) {
+            line_end = end;
+        }
+
+        size_t count = 0;
+        for (const char* p = line; p < line_end;) {
+            if (_td_is_space(*p)) {
+                p++;
+                continue;
+            }
+
+            size_t length = _td_token_length(p, line_end);
+            TD_Cell cell;
+            if (!_td_parse_cell(p, length, 0, 0, &cell)) {
+                if (length > 1) {
+                    nob_log(NOB_ERROR, "%s:%zu:%zu: Number `%.*s` does not fit into a cell.",
+                            name, line_number, (size_t) (p - line) + 1, (int) length, p);
+                } else {
+                    nob_log(NOB_ERROR, "%s:%zu:%zu: Unknown cell symbol `%c`.",
+                            name, line_number, (size_t) (p - line) + 1, *p);
+                }
+                return false;
+            }
+            p += length;
+            count++;
+        }
+
+        if (count > 0) {
+            *rows += 1;
+            if (count > *cols) {
+                *cols = count;
+            }
+        }
+        line = line_end + 1;
+    }
+
+    if (*rows == 0) {
+        nob_log(NOB_ERROR, "%s: The program has no cells.", name);
+        return false;
+    }
+    return true;
+}
+
+// Writes the cells of the checked board into `cells`, padding shorter rows with
+// empty cells, and lists its inputs like the input prefix does
+void _td_parse_board(const char* data, size_t size, size_t cols, int input_a, int input_b,
+                     TD_Cell* cells, TD_CellIndices* inputs) {
+    const char* end = data + size;
+    TD_Cell* row = cells;
+    for (const char* line = data; line < end;) {
+        const char* line_end = memchr(line, '\n', end - line);
+        if (line_end == NULL) {
+            line_end = end;
+        }
+
+        size_t count = 0;
+        for (const char* p = line; p < line_end;) {
+            if (_td_is_space(*p)) {
+                p++;
+                continue;
+            }
+
+            size_t length = _td_token_length(p, line_end);
+            TD_Cell* cell = &row[count++];
+            _td_parse_cell(p, length, input_a, input_b, cell);
+            if (cell->input_kind != CELL_INPUT_NONE) {
+                nob_da_append(inputs, (cell - cells) * 2 + (cell->input_kind == CELL_INPUT_B));
+            }
+            p += length;
+        }
+
+        if (count > 0) {
+            memset(row + count, 0, (cols - count) * sizeof(TD_Cell));
+            row += cols;
+        }
+        line = line_end + 1;
+    }
+}
+
+// Loads the board from `size` bytes at `data`. Errors are reported with their
+// line and column in `name`, and leave the history unloaded.
+bool _td_load(TD_BoardHistory* history, const char* data, size_t size, const char* name, int input_a, int input_b) {
+    size_t cols, rows;
+    if (!_td_measure_board(data, size, name, &cols, &rows)) {
+        return false;
+    }
+
+    history->input_a = input_a;
+    history->input_b = input_b;
+    history->cols = cols;
+    history->rows = rows;
+    history->cells_bytes = cols * rows * sizeof(TD_Cell);
+
+    TD_Board first_board = {0};
+    first_board.history = history;
+    first_board.status = STATUS_RUNNING;
+    first_board.result = 0;
+    first_board.time = 1;
+    first_board.cells_mark = arena_snapshot(&history->cells_arena);
+    first_board.cells = arena_alloc(&history->cells_arena, history->cells_bytes);
+    history->prefix.cells.count = 0;
+    _td_parse_board(data, size, cols, input_a, input_b, first_board.cells, &history->prefix.cells);
+    first_board.hash = _td_board_hash(&first_board);
+
+    _td_start_history(history, first_board);
+    return true;
+}
+
+bool td_load(TD_BoardHistory* history, const char* board_def, int input_a, int input_b) {
+    return _td_load(history, board_def, strlen(board_def), "<program>", input_a, input_b);
+}
+
+// Maps the file at `path` into memory, copying the pages that are written to.
+// Empty files are not mapped and give NULL.
+bool _td_map_file(const char* path, char** data, size_t* size) {
+    *data = NULL;
+    *size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        nob_log(NOB_ERROR, "Could not open file %s: %lu", path, GetLastError());
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        nob_log(NOB_ERROR, "Could not get size of file %s: %lu", path, GetLastError());
+        CloseHandle(file);
+        return false;
+    }
+    *size = (size_t) file_size.QuadPart;
+    if (*size == 0) {
+        CloseHandle(file);
+        return true;
+    }
+
+    // The view keeps the file mapped after the handles are closed
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) {
+        nob_log(NOB_ERROR, "Could not map file %s: %lu", path, GetLastError());
+        return false;
+    }
+    *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (*data == NULL) {
+        nob_log(NOB_ERROR, "Could not map file %s: %lu", path, GetLastError());
+        return false;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        nob_log(NOB_ERROR, "Could not open file %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+        nob_log(NOB_ERROR, "Could not get size of file %s: %s", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    *size = (size_t) file_stat.st_size;
+    if (*size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* mapped = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        nob_log(NOB_ERROR, "Could not map file %s: %s", path, strerror(errno));
+        return false;
+    }
+    *data = mapped;
+#endif
+    return true;
+}
+
+void _td_unmap_file(char* data, size_t size) {
+    if (data == NULL) {
+        return;
+    }
+#ifdef _WIN32
+    (void) size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+// Binary format
+
+bool _td_is_binary(const char* data, size_t size) {
+    return size >= sizeof(TD_BinaryHeader) && memcmp(data, TD_BINARY_MAGIC, 4) == 0;
+}
+
+// Copies a table of a binary program into `indices`. Returns false if an entry
+// is not below `limit`.
+bool _td_read_table(TD_CellIndices* indices, const char* table, uint64_t count, uint64_t limit) {
+    indices->capacity = count + 1;
+    indices->items = NOB_REALLOC(indices->items, indices->capacity * sizeof(size_t));
+    NOB_ASSERT(indices->items != NULL && "Buy more RAM lol");
+    indices->count = count;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t entry;
+        memcpy(&entry, table + i * sizeof(uint64_t), sizeof(entry));
+        if (entry >= limit) {
+            return false;
+        }
+        indices->items[i] = entry;
+    }
+    return true;
+}
+
+// Starts the history with the cells of a binary program in place. Only the
+// structure of the file is checked, the cells are trusted.
+bool _td_load_binary(TD_BoardHistory* history, char* data, size_t size, const char* name, int input_a, int input_b) {
+    TD_BinaryHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != TD_BINARY_VERSION) {
+        nob_log(NOB_ERROR, "%s: Unsupported binary format version %u.", name, header.version);
+        return false;
+    }
+    if (header.cell_size != sizeof(TD_Cell)) {
+        nob_log(NOB_ERROR, "%s: The program was written by a build with cells of %u bytes.", name, header.cell_size);
+        return false;
+    }
+
+    uint64_t max_count = (size - sizeof(header)) / sizeof(TD_Cell);
+    if (header.cols == 0 || header.rows == 0 || header.cols > max_count || header.rows > max_count / header.cols) {
+        nob_log(NOB_ERROR, "%s: The program is truncated.", name);
+        return false;
+    }
+    uint64_t cells_count = header.cols * header.rows;
+    uint64_t tables_bytes = size - sizeof(header) - cells_count * sizeof(TD_Cell);
+    if (header.inputs_count > cells_count || header.relevant_count > cells_count
+            || (header.inputs_count + header.relevant_count) * sizeof(uint64_t) != tables_bytes) {
+        nob_log(NOB_ERROR, "%s: The program is truncated.", name);
+        return false;
+    }
+
+    const char* inputs = data + sizeof(header) + cells_count * sizeof(TD_Cell);
+    const char* relevant = inputs + header.inputs_count * sizeof(uint64_t);
+    if (!_td_read_table(&history->prefix.cells, inputs, header.inputs_count, cells_count * 2)
+            || !_td_read_table(&history->pruning.cells, relevant, header.relevant_count, cells_count)) {
+        nob_log(NOB_ERROR, "%s: The program refers to a cell outside of the board.", name);
+        td_free(history);
+        *history = (TD_BoardHistory) {
+            0
+        };
+        return false;
+    }
+
+    history->input_a = input_a;
+    history->input_b = input_b;
+    history->cols = header.cols;
+    history->rows = header.rows;
+    history->cells_bytes = cells_count * sizeof(TD_Cell);
+    history->mapped_data = data;
+    history->mapped_size = size;
+
+    TD_Board first_board = {0};
+    first_board.history = history;
+    first_board.status = STATUS_RUNNING;
+    first_board.result = 0;
+    first_board.time = 1;
+    first_board.cells_mark = arena_snapshot(&history->cells_arena);
+    first_board.cells = (TD_Cell*) (data + sizeof(header));
+    first_board.hash = header.hash;
+
+    for (size_t i = 0; i < history->prefix.cells.count; ++i) {
+        size_t entry = history->prefix.cells.items[i];
+        TD_Cell* cell = &first_board.cells[entry >> 1];
+        first_board.hash ^= _td_cell_hash(entry >> 1, *cell);
+        cell->value = (entry & 1) ? input_b : input_a;
+        first_board.hash ^= _td_cell_hash(entry >> 1, *cell);
+    }
+
+    if (header.pruned) {
+        TD_Pruning* pruning = &history->pruning;
+        pruning->relevant = NOB_REALLOC(NULL, cells_count * sizeof(bool));
+        NOB_ASSERT(pruning->relevant != NULL && "Buy more RAM lol");
+        memset(pruning->relevant, 0, cells_count * sizeof(bool));
+        for (size_t i = 0; i < pruning->cells.count; ++i) {
+            pruning->relevant[pruning->cells.items[i]] = true;
+        }
+        pruning->enabled = true;
+    }
+
+    _td_start_history(history, first_board);
+    return true;
+}
+
+void _td_write_u64(FILE* file, uint64_t value) {
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+// Writes the first board with the inputs of the history and the relevant cells
+// if it is pruned, to be loaded by td_read without parsing
+bool td_write_binary(TD_BoardHistory* history, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        nob_log(NOB_ERROR, "Could not open file %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    TD_Board* board = td_board_at(history, 0);
+    size_t cells_count = history->cols * history->rows;
+    TD_BinaryHeader header = {0};
+    memcpy(header.magic, TD_BINARY_MAGIC, 4);
+    header.version = TD_BINARY_VERSION;
+    header.cell_size = sizeof(TD_Cell);
+    header.pruned = history->pruning.enabled;
+    header.cols = history->cols;
+    header.rows = history->rows;
+    header.inputs_count = 0;
+    header.relevant_count = history->pruning.enabled ? history->pruning.cells.count : 0;
+    fwrite(&header, sizeof(header), 1, file);
+
+    // Cells are written one by one, since the inputs and the activations of the
+    // board can't be written as they are
+    for (size_t i = 0; i < cells_count; ++i) {
+        TD_Cell cell = {0};
+        cell.kind = board->cells[i].kind;
+        cell.input_kind = board->cells[i].input_kind;
+        cell.value = (cell.input_kind == CELL_INPUT_NONE) ? board->cells[i].value : 0;
+        header.hash ^= _td_cell_hash(i, cell);
+        header.inputs_count += cell.input_kind != CELL_INPUT_NONE;
+        fwrite(&cell, sizeof(cell), 1, file);
+    }
+    for (size_t i = 0; i < cells_count; ++i) {
+        if (board->cells[i].input_kind != CELL_INPUT_NONE) {
+            _td_write_u64(file, i * 2 + (board->cells[i].input_kind == CELL_INPUT_B));
+        }
+    }
+    for (size_t i = 0; i < header.relevant_count; ++i) {
+        _td_write_u64(file, history->pruning.cells.items[i]);
+    }
+
+    // The header is complete once the cells are counted
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+
+    bool result = !ferror(file);
+    if (fclose(file) != 0 || !result) {
+        nob_log(NOB_ERROR, "Could not write file %s: %s", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Writes the first board in the text format, with the inputs as `A` and `B`
+bool td_write(TD_BoardHistory* history, const char* path) {
+    static const char symbols[] = {
+        [CELL_EMPTY] = '.',
+        [CELL_MOVE_LEFT] = '<',
+        [CELL_MOVE_RIGHT] = '>',
+        [CELL_MOVE_UP] = '^',
+        [CELL_MOVE_DOWN] = 'v',
+        [CELL_CALC_ADD] = '+',
+        [CELL_CALC_SUBTRACT] = '-',
+        [CELL_CALC_MULTIPLY] = '*',
+        [CELL_CALC_DIVIDE] = '/',
+        [CELL_CALC_REMAINDER] = '%',
+        [CELL_TIMEWARP] = '@',
+        [CELL_CMP_EQUAL] = '=',
+        [CELL_CMP_NOTEQUAL] = '#',
+        [CELL_STOP] = 'S',
+    };
+
+    TD_Board* board = td_board_at(history, 0);
+    Nob_String_Builder sb = {0};
+    for (size_t row = 0; row < history->rows; ++row) {
+        for (size_t col = 0; col < history->cols; ++col) {
+            TD_Cell cell = board->cells[row * history->cols + col];
+            if (col > 0) {
+                nob_da_append(&sb, ' ');
+            }
+            if (cell.input_kind != CELL_INPUT_NONE) {
+                nob_da_append(&sb, cell.input_kind == CELL_INPUT_A ? 'A' : 'B');
+            } else if (cell.kind == CELL_NUMBER) {
+                size_t mark = nob_temp_save();
+                nob_sb_append_cstr(&sb, nob_temp_sprintf("%d", cell.value));
+                nob_temp_rewind(mark);
+            } else {
+                nob_da_append(&sb, symbols[cell.kind]);
+            }
+        }
+        nob_da_append(&sb, '\n');
+    }
+
+    bool result = nob_write_entire_file(path, sb.items, sb.count);
+    nob_sb_free(sb);
+    return result;
+}
+
+bool td_read(TD_BoardHistory* history, const char* filename, int input_a, int input_b) {
+    *history = (TD_BoardHistory) {
+        0
+    };
+
+    nob_log(NOB_INFO, "Loading program `%s`.", filename);
+
+    char* data;
+    size_t size;
+    if (!_td_map_file(filename, &data, &size)) {
+        return false;
+    }
+
+    // Binary programs stay mapped as the cells of the first board
+    if (_td_is_binary(data, size)) {
+        if (!_td_load_binary(history, data, size, filename, input_a, input_b)) {
+            _td_unmap_file(data, size);
+            return false;
+        }
+        return true;
+    }
+
+    bool result = _td_load(history, data, size, filename, input_a, input_b);
+    _td_unmap_file(data, size);
+    return result;
+}
+
+void td_free(TD_BoardHistory* history) {
+    td_trace_stop(history);
+    td_finish_checkpoint(history);
+    if (history->sparse.enabled) {
+        for (size_t i = history->sparse.packed; i < history->count; ++i) {
+            NOB_FREE(td_board_at(history, i)->cells);
+        }
+    }
+    for (size_t i = 0; i < history->sparse.buffers.count; ++i) {
+        NOB_FREE(history->sparse.buffers.items[i]);
+    }
+    nob_da_free(history->sparse.buffers);
+    NOB_FREE(history->sparse.view);
+    for (size_t i = 0; i < history->chunks_count; ++i) {
+        NOB_FREE(history->chunks[i]);
+    }
+    NOB_FREE(history->chunks);
+    arena_free(&history->cells_arena);
+    _td_unmap_file(history->mapped_data, history->mapped_size);
+    if (history->spill.enabled) {
+        _td_unmap_file(history->spill.data, TD_SPILL_RESERVE);
+    }
+    if (history->timewarps) {
+        da_free(history->timewarps);
+    }
+    NOB_FREE(history->transpositions.items);
+    nob_da_free(history->warp_landings);
+    nob_da_free(history->jumps);
+    NOB_FREE(history->transitions.items);
+    nob_da_free(history->diff);
+    nob_da_free(history->diff_area);
+    NOB_FREE(history->diff_distances);
+    nob_da_free(history->quadtree.nodes);
+    NOB_FREE(history->quadtree.table);
+    NOB_FREE(history->quadtree.leaps.items);
+    NOB_FREE(history->affine.cells);
+    NOB_FREE(history->affine.times);
+    NOB_FREE(history->affine.landed);
+    nob_da_free(history->affine.warps);
+    NOB_FREE(history->pruning.relevant);
+    nob_da_free(history->pruning.cells);
+    NOB_FREE(history->prefix.inputs);
+    NOB_FREE(history->prefix.next_inputs);
+    nob_da_free(history->prefix.cells);
+    nob_da_free(history->prefix.offsets);
+    nob_da_free(history->prefix.area);
+    nob_da_free(history->prefix.written);
+    nob_da_free(history->superinstructions);
+    nob_da_free(history->superinstructions.timewarps);
+    nob_da_free(history->activity.written);
+    nob_da_free(history->activity.next_written);
+    nob_da_free(history->activity.candidates);
+    NOB_FREE(history->activity.stamps);
+}
+
+void td_reserve(TD_BoardHistory* history, size_t ticks) {
+    _td_reserve_boards(history, history->count + ticks);
+
+    // Spilled boards are allocated from the spill file instead
+    if (!history->spill.enabled) {
+        size_t board_bytes = (history->cells_bytes + sizeof(uintptr_t) - 1) / sizeof(uintptr_t) * sizeof(uintptr_t);
+        arena_reserve(&history->cells_arena, ticks * board_bytes);
+    }
+}
+
+TD_MemoryUsage td_memory_usage(TD_BoardHistory* history) {
+    TD_MemoryUsage usage = {0};
+
+    Arena_Usage cells = arena_usage(&history->cells_arena);
+    usage.cells_used_bytes = cells.used_bytes;
+    usage.cells_committed_bytes = cells.committed_bytes;
+    usage.cells_reserved_bytes = cells.reserved_bytes;
+
+    usage.spill_used_bytes = history->spill.used;
+    usage.spill_released_bytes = history->spill.released;
+
+    usage.history_used_bytes = history->count * sizeof(TD_Board);
+    usage.history_allocated_bytes = history->chunks_count * TD_HISTORY_CHUNK_SIZE * sizeof(TD_Board)
+                                    + history->chunks_capacity * sizeof(*history->chunks);
+
+    if (history->timewarps) {
+        usage.scratch_bytes += sizeof(DA_Header) + da_capacity(history->timewarps) * sizeof(TD_Timewarp);
+    }
+    usage.scratch_bytes += (history->diff.capacity + history->diff_area.capacity) * sizeof(size_t);
+    if (history->diff_distances) {
+        usage.scratch_bytes += history->cols * history->rows;
+    }
+    usage.scratch_bytes += history->affine.cells_capacity * sizeof(TD_AffineCell)
+                           + history->affine.boards_capacity * (sizeof(size_t) + sizeof(bool))
+                           + history->affine.warps.capacity * sizeof(size_t);
+    if (history->pruning.relevant) {
+        usage.scratch_bytes += history->cols * history->rows * sizeof(bool)
+                               + history->pruning.cells.capacity * sizeof(size_t);
+    }
+    if (history->prefix.inputs) {
+        usage.scratch_bytes += 2 * history->cols * history->rows;
+    }
+    usage.scratch_bytes += (history->prefix.area.capacity + history->prefix.written.capacity) * sizeof(size_t);
+    usage.scratch_bytes += history->superinstructions.capacity * sizeof(TD_Superinstruction)
+                           + history->superinstructions.timewarps.capacity * sizeof(size_t);
+    usage.scratch_bytes += (history->activity.written.capacity + history->activity.next_written.capacity
+                            + history->activity.candidates.capacity) * sizeof(size_t);
+    if (history->activity.stamps) {
+        usage.scratch_bytes += history->cols * history->rows * sizeof(size_t);
+    }
+    if (history->sparse.enabled) {
+        // Boards stored sparsely are in the cells arena, the ones kept in full are not
+        size_t buffers = history->sparse.buffers.count + (history->count - history->sparse.packed)
+                         + (history->sparse.view != NULL);
+        usage.scratch_bytes += buffers * history->cells_bytes
+                               + history->sparse.buffers.capacity * sizeof(TD_Cell*);
+    }
+
+    usage.cache_bytes = history->transpositions.capacity * sizeof(TD_Transposition)
+                        + history->warp_landings.capacity * sizeof(TD_WarpLanding)
+                        + history->jumps.capacity * sizeof(TD_TickJump)
+                        + history->transitions.capacity * sizeof(TD_Transposition)
+                        + history->quadtree.nodes.capacity * sizeof(TD_QuadNode)
+                        + history->quadtree.table_capacity * sizeof(uint32_t)
+                        + history->quadtree.leaps.capacity * sizeof(TD_Transposition)
+                        + (history->prefix.cells.capacity + history->prefix.offsets.capacity) * sizeof(size_t);
+
+    usage.total_bytes = usage.cells_committed_bytes + usage.spill_used_bytes - usage.spill_released_bytes
+                        + usage.history_allocated_bytes
+                        + usage.scratch_bytes + usage.cache_bytes;
+    usage.unused_bytes = usage.total_bytes - usage.cells_used_bytes - (usage.spill_used_bytes - usage.spill_released_bytes)
+                         - usage.history_used_bytes;
+    return usage;
+}
+
+// Allocation counting
+
+#ifdef TD_COUNT_ALLOCATIONS
+static size_t td_allocations = 0;
+
+void* td_counting_malloc(size_t size) {
+    td_allocations++;
+    return malloc(size);
+}
+
+void* td_counting_realloc(void* ptr, size_t size) {
+    td_allocations++;
+    return realloc(ptr, size);
+}
+
+size_t td_allocation_count(void) {
+    return td_allocations;
+}
+#endif
+
+// Cell operations
+
+TD_Cell _td_make_empty_cell() {
+    return (TD_Cell) {
+        0
+    };
+}
+
+TD_Cell _td_make_number_cell(int value) {
+    return (TD_Cell) {
+        .kind = CELL_NUMBER,
+        .value = value,
+    };
+}
+
+// Records the first board on which an operator is written to a cell that holds
+// something else on the first board, since compiled programs only know the
+// operators where they are at the start
+void _td_track_moved(TD_BoardHistory* history, size_t index, TD_CellKind kind) {
+    if (history->moved_index == SIZE_MAX && kind >= CELL_MOVE_LEFT && kind <= CELL_TIMEWARP
+            && td_board_at(history, 0)->cells[index].kind != kind) {
+        history->moved_index = history->count - 1;
+    }
+}
+
+bool _td_is_compiled(TD_BoardHistory* history) {
+    return history->compiled != NULL && history->moved_index == SIZE_MAX;
+}
+
+// Writes `value` to the cell at `index`, keeping the hash of the board and
+// whether the cell holds an input up to date. Writing to a stop cell stops the
+// program with the written value as its result.
+void td_write_cell(TD_Board* board, size_t index, TD_Cell value) {
+    TD_Cell* cell = &board->cells[index];
+    TD_CellInputKind old_input_kind = cell->input_kind;
+    bool stopped = cell->kind == CELL_STOP;
+
+    board->hash ^= _td_cell_hash(index, *cell) ^ _td_cell_hash(index, value);
+    _td_track_moved(board->history, index, value.kind);
+    if (board->history->activity.recording) {
+        nob_da_append(&board->history->activity.next_written, index);
+    }
+
+    *cell = value;
+    cell->input_kind = old_input_kind;
+    if (stopped && board->status != STATUS_CRASH) {
+        board->status = STATUS_STOPPED;
+        board->result = value.value;
+    }
+}
+
+// Dividing by zero or INT_MIN by -1 has no result, and crashes the program
+// instead of the process
+bool td_calculation_defined(TD_CellKind kind, int left, int right) {
+    if (kind != CELL_CALC_DIVIDE && kind != CELL_CALC_REMAINDER) {
+        return true;
+    }
+    return right != 0 && (left != INT_MIN || right != -1);
+}
+
+// Writes to cells outside of the board are dropped
+void _td_set_cell(TD_BoardCursor cursor, TD_Cell value) {
+    if (!cursor.valid) {
+        return;
+    }
+
+    td_write_cell(cursor.board, cursor.row * cursor.board->history->cols + cursor.col, value);
+}
+
+void _td_activate_cell(TD_BoardCursor cursor) {
+    if (cursor.valid) {
+        cursor.cell->active = true;
+    }
+}
+
+// History navigation
+
+TD_Board* td_board_at(TD_BoardHistory* history, size_t index) {
+    return &history->chunks[index >> TD_HISTORY_CHUNK_BITS][index & (TD_HISTORY_CHUNK_SIZE - 1)];
+}
+
+TD_Board* td_current_board(TD_BoardHistory* history) {
+    return td_board_at(history, history->tick);
+}
+
+bool _td_retrieve_operands(TD_BoardCursor cursor,
+                           TD_Cell** left, TD_Cell** right) {
+    *left = td_cursor_left(cursor).cell;
+    *right = td_cursor_up(cursor).cell;
+    return (*left)->kind == CELL_NUMBER
+           && (*right)->kind == CELL_NUMBER;
+}
+
+bool _td_retrieve_timewarp_operands(TD_BoardCursor cursor,
+                                    TD_Cell** op_v, TD_Cell** op_dx, TD_Cell** op_dy, TD_Cell** op_dt) {
+    *op_v = td_cursor_up(cursor).cell;
+    *op_dx = td_cursor_left(cursor).cell;
+    *op_dy = td_cursor_right(cursor).cell;
+    *op_dt = td_cursor_down(cursor).cell;
+    return (*op_v)->kind == CELL_NUMBER
+           && (*op_dx)->kind == CELL_NUMBER
+           && (*op_dy)->kind == CELL_NUMBER
+           && (*op_dt)->kind == CELL_NUMBER;
+}
+
+void _td_calculate(TD_BoardCursor cursor, int value) {
+    _td_set_cell(td_cursor_left(cursor), _td_make_empty_cell());
+    _td_set_cell(td_cursor_up(cursor), _td_make_empty_cell());
+    _td_set_cell(td_cursor_right(cursor), _td_make_number_cell(value));
+    _td_set_cell(td_cursor_down(cursor), _td_make_number_cell(value));
+    _td_activate_cell(cursor);
+    _td_activate_cell(td_cursor_right(cursor));
+    _td_activate_cell(td_cursor_down(cursor));
+}
+
+void _td_move_left(TD_BoardCursor cursor, TD_Cell* operand) {
+    _td_set_cell(td_cursor_right(cursor), _td_make_empty_cell());
+    _td_set_cell(td_cursor_left(cursor), *operand);
+    _td_activate_cell(cursor);
+    _td_activate_cell(td_cursor_left(cursor));
+}
+
+void _td_move_right(TD_BoardCursor cursor, TD_Cell* operand) {
+    _td_set_cell(td_cursor_left(cursor), _td_make_empty_cell());
+    _td_set_cell(td_cursor_right(cursor), *operand);
+    _td_activate_cell(cursor);
+    _td_activate_cell(td_cursor_right(cursor));
+}
+
+void _td_move_up(TD_BoardCursor cursor, TD_Cell* operand) {
+    _td_set_cell(td_cursor_down(cursor), _td_make_empty_cell());
+    _td_set_cell(td_cursor_up(cursor), *operand);
+    _td_activate_cell(cursor);
+    _td_activate_cell(td_cursor_up(cursor));
+}
+
+void _td_move_down(TD_BoardCursor cursor, TD_Cell* operand) {
+    _td_set_cell(td_cursor_up(cursor), _td_make_empty_cell());
+    _td_set_cell(td_cursor_down(cursor), *operand);
+    _td_activate_cell(cursor);
+    _td_activate_cell(td_cursor_down(cursor));
+}
+
+void _td_collect_timewarp(TD_BoardCursor cursor, TD_Timewarps* timewarps) {
+    TD_Cell *op_v, *op_dx, *op_dy, *op_dt;
+    if (cursor.cell->kind == CELL_TIMEWARP
+            && _td_retrieve_timewarp_operands(cursor, &op_v, &op_dx, &op_dy, &op_dt)) {
+        TD_Timewarp tw = {
+            .timewarp_cursor = cursor,
+            .cell_cursor = td_cursor_move(cursor, -op_dx->value, -op_dy->value),
+            .value = op_v->value,
+            .dt = op_dt->value,
+        };
+        da_add(*timewarps, tw);
+    }
+}
+
+void _td_evaluate_cell(TD_BoardCursor current_cursor, TD_Board* next_board) {
+    TD_BoardCursor next_cursor = td_cursor_board(current_cursor, next_board);
+    TD_Cell *op_left,  *op_right;
+    switch (current_cursor.cell->kind) {
+    case CELL_CALC_ADD: {
+        if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
+            _td_calculate(next_cursor, op_left->value + op_right->value);
+        }
+        break;
+    }
+    case CELL_CALC_SUBTRACT: {
+        if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
+            _td_calculate(next_cursor, op_left->value - op_right->value);
+        }
+        break;
+    }
+    case CELL_CALC_MULTIPLY: {
+        if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
+            _td_calculate(next_cursor, op_left->value * op_right->value);
+        }
+        break;
+    }
+    case CELL_CALC_DIVIDE: {
+        if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
+            if (!td_calculation_defined(CELL_CALC_DIVIDE, op_left->value, op_right->value)) {
+                next_board->status = STATUS_CRASH;
+                break;
+            }
+            _td_calculate(next_cursor, op_left->value / op_right->value);
+        }
+        break;
+    }
+    case CELL_CALC_REMAINDER: {
+        if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
+            if (!td_calculation_defined(CELL_CALC_REMAINDER, op_left->value, op_right->value)) {
+                next_board->status = STATUS_CRASH;
+                break;
+            }
+            _td_calculate(next_cursor, op_left->value % op_right->value);
+        }
+        break;
+    }
+    case CELL_MOVE_LEFT: {
+        TD_Cell* operand = td_cursor_right(current_cursor).cell;
+        if (operand->kind != CELL_EMPTY) {
+            _td_move_left(next_cursor, operand);
+        }
+        break;
+    }
+    case CELL_MOVE_RIGHT: {
+        TD_Cell* operand = td_cursor_left(current_cursor).cell;
+        if (operand->kind != CELL_EMPTY) {
+            _td_move_right(next_cursor, operand);
+        }
+        break;
+    }
+    case CELL_MOVE_UP: {
+        TD_Cell* operand = td_cursor_down(current_cursor).cell;
+        if (operand->kind != CELL_EMPTY) {
+            _td_move_up(next_cursor, operand);
+        }
+        break;
+    }
+    case CELL_MOVE_DOWN: {
+        TD_Cell* operand = td_cursor_up(current_cursor).cell;
+        if (operand->kind != CELL_EMPTY) {
+            _td_move_down(next_cursor, operand);
+        }
+        break;
+    }
+    case CELL_CMP_EQUAL: {
+        if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
+            if (op_left->value == op_right->value) {
+                _td_move_right(next_cursor, op_left);
+                _td_move_down(next_cursor, op_right);
+            }
+        }
+        break;
+    }
+    case CELL_CMP_NOTEQUAL: {
+        if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
+            if (op_left->value != op_right->value) {
+                _td_move_right(next_cursor, op_left);
+                _td_move_down(next_cursor, op_right);
+            }
+        }
+        break;
+    }
+    case CELL_TIMEWARP:
+    case CELL_EMPTY:
+    case CELL_NUMBER:
+    case CELL_STOP:
+        break;
+
+    default:
+        printf("Don't know what to do with cell of kind `%s`.\n", td_cell_kind_name(current_cursor.cell->kind));
+    }
+}
+
+TD_Board* _td_clone_board(TD_BoardHistory *history, size_t index, int time) {
+    TD_Board* board = td_board_at(history, index);
+
+    TD_Board new_board = {0};
+    new_board.history = history;
+    new_board.result = 0;
+    new_board.status = STATUS_RUNNING;
+    new_board.time = time;
+    _td_alloc_cells(history, &new_board);
+    _td_read_cells(history, board, new_board.cells);
+    new_board.hash = board->hash;
+
+    for (size_t i = 0; i < history->cols * history->rows; ++i) {
+        new_board.cells[i].active = false;
+    }
+
+    return _td_append_board(history, new_board);
+}
+
+// Appends a copy of the board at `index` including its activity and outcome
+TD_Board* _td_copy_board(TD_BoardHistory *history, size_t index, size_t time) {
+    TD_Board* board = td_board_at(history, index);
+
+    TD_Board new_board = {0};
+    new_board.history = history;
+    new_board.result = board->result;
+    new_board.status = (board->status == STATUS_LOOPING) ? STATUS_RUNNING : board->status;
+    new_board.time = time;
+    _td_alloc_cells(history, &new_board);
+    _td_read_cells(history, board, new_board.cells);
+    new_board.hash = board->hash;
+
+    return _td_append_board(history, new_board);
+}
+
+// Appends a crashed copy of the last board. The tick has already been advanced
+// past it, so it is not the current board.
+void _td_crash(TD_BoardHistory* history) {
+    TD_Board* last_board = td_board_at(history, history->count - 1);
+    TD_Board* next_board = _td_clone_board(history, history->count - 1, last_board->time + 1);
+    next_board->status = STATUS_CRASH;
+}
+
+// Dependency pruning
+
+#define TD_KIND_BIT(kind) (1u << (kind))
+
+// Returns the neighbour of a cell in the direction left, up, right or down, or
+// SIZE_MAX if it is outside of the board
+size_t _td_prune_neighbour(TD_BoardHistory* history, size_t index, int direction) {
+    static const int cols[4] = {-1, 0, 1, 0};
+    static const int rows[4] = {0, -1, 0, 1};
+    int col = (int) (index % history->cols) + cols[direction];
+    int row = (int) (index / history->cols) + rows[direction];
+    if (col < 0 || row < 0 || col >= (int) history->cols || row >= (int) history->rows) {
+        return SIZE_MAX;
+    }
+    return row * history->cols + col;
+}
+
+// The direction a move takes its operand from, the opposite of where it moves it
+int _td_move_source(TD_CellKind kind) {
+    return (kind == CELL_MOVE_LEFT) ? 2 : (kind == CELL_MOVE_UP) ? 3 : (kind == CELL_MOVE_RIGHT) ? 0 : 1;
+}
+
+// The directions an operator of `kind` reads from and writes to, as bits. Time
+// warps write to a target of their own instead.
+void _td_prune_operator(TD_CellKind kind, unsigned* reads, unsigned* writes) {
+    switch (kind) {
+    case CELL_MOVE_LEFT:
+    case CELL_MOVE_UP:
+    case CELL_MOVE_RIGHT:
+    case CELL_MOVE_DOWN: {
+        int source = _td_move_source(kind);
+        *reads = 1u << source;
+        *writes = (1u << source) | (1u << ((source + 2) % 4));
+        break;
+    }
+    case CELL_CALC_ADD:
+    case CELL_CALC_SUBTRACT:
+    case CELL_CALC_DIVIDE:
+    case CELL_CALC_MULTIPLY:
+    case CELL_CALC_REMAINDER:
+    case CELL_CMP_EQUAL:
+    case CELL_CMP_NOTEQUAL:
+        *reads = 0x3;
+        *writes = 0xf;
+        break;
+    case CELL_TIMEWARP:
+        *reads = 0xf;
+        *writes = 0;
+        break;
+    default:
+        *reads = 0;
+        *writes = 0;
+        break;
+    }
+}
+
+// Directions an operator at `index` may write to with any of the kinds it may hold
+unsigned _td_prune_writes(TD_Pruning* pruning, size_t index) {
+    unsigned result = 0;
+    for (TD_CellKind kind = CELL_MOVE_LEFT; kind < CELL_STOP; ++kind) {
+        unsigned reads, writes;
+        if (pruning->kinds[index] & TD_KIND_BIT(kind)) {
+            _td_prune_operator(kind, &reads, &writes);
+            result |= writes;
+        }
+    }
+    return result;
+}
+
+void _td_prune_enqueue(TD_Pruning* pruning, size_t index) {
+    if (index != SIZE_MAX && !pruning->queued[index]) {
+        pruning->queued[index] = true;
+        nob_da_append(&pruning->queue, index);
+    }
+}
+
+// Records that a write of one of `kinds` may reach the cell at `index`, and
+// visits the cell and the operators around it again if that is new
+void _td_prune_write(TD_BoardHistory* history, size_t index, uint16_t kinds) {
+    TD_Pruning* pruning = &history->pruning;
+    if (index == SIZE_MAX || (pruning->written[index] && (pruning->kinds[index] | kinds) == pruning->kinds[index])) {
+        return;
+    }
+
+    pruning->kinds[index] |= kinds;
+    pruning->written[index] = true;
+    _td_prune_enqueue(pruning, index);
+    for (int direction = 0; direction < 4; ++direction) {
+        _td_prune_enqueue(pruning, _td_prune_neighbour(history, index, direction));
+    }
+}
+
+bool _td_prune_may_be_number(TD_Pruning* pruning, size_t index) {
+    return index != SIZE_MAX && (pruning->kinds[index] & TD_KIND_BIT(CELL_NUMBER));
+}
+
+// A number that is neither an input nor ever written keeps its value for good
+bool _td_prune_constant(TD_BoardHistory* history, TD_Cell* cells, size_t index) {
+    TD_Pruning* pruning = &history->pruning;
+    return index != SIZE_MAX && pruning->kinds[index] == TD_KIND_BIT(CELL_NUMBER)
+           && !pruning->written[index] && cells[index].input_kind == CELL_INPUT_NONE;
+}
+
+// Applies the writes of all operators the cell at `index` may hold
+void _td_prune_visit(TD_BoardHistory* history, TD_Cell* cells, size_t index, bool* scattered) {
+    TD_Pruning* pruning = &history->pruning;
+    size_t cells_count = history->cols * history->rows;
+    size_t neighbours[4];
+    for (int direction = 0; direction < 4; ++direction) {
+        neighbours[direction] = _td_prune_neighbour(history, index, direction);
+    }
+
+    for (TD_CellKind kind = CELL_MOVE_LEFT; kind < CELL_STOP; ++kind) {
+        if (!(pruning->kinds[index] & TD_KIND_BIT(kind))) {
+            continue;
+        }
+
+        unsigned reads, writes;
+        _td_prune_operator(kind, &reads, &writes);
+        if (kind == CELL_TIMEWARP) {
+            if (*scattered || !_td_prune_may_be_number(pruning, neighbours[0]) || !_td_prune_may_be_number(pruning, neighbours[1])
+                    || !_td_prune_may_be_number(pruning, neighbours[2]) || !_td_prune_may_be_number(pruning, neighbours[3])) {
+                continue;
+            }
+
+            // A warp whose offsets may change can write anywhere
+            if (_td_prune_constant(history, cells, neighbours[0]) && _td_prune_constant(history, cells, neighbours[2])) {
+                int col = (int) (index % history->cols) - cells[neighbours[0]].value;
+                int row = (int) (index / history->cols) - cells[neighbours[2]].value;
+                if (col >= 0 && row >= 0 && col < (int) history->cols && row < (int) history->rows) {
+                    _td_prune_write(history, row * history->cols + col, TD_KIND_BIT(CELL_NUMBER));
+                }
+            } else {
+                *scattered = true;
+                for (size_t i = 0; i < cells_count; ++i) {
+                    _td_prune_write(history, i, TD_KIND_BIT(CELL_NUMBER));
+                }
+            }
+        } else if (reads == 0x3) {
+            if (_td_prune_may_be_number(pruning, neighbours[0]) && _td_prune_may_be_number(pruning, neighbours[1])) {
+                _td_prune_write(history, neighbours[0], TD_KIND_BIT(CELL_EMPTY));
+                _td_prune_write(history, neighbours[1], TD_KIND_BIT(CELL_EMPTY));
+                _td_prune_write(history, neighbours[2], TD_KIND_BIT(CELL_NUMBER));
+                _td_prune_write(history, neighbours[3], TD_KIND_BIT(CELL_NUMBER));
+            }
+        } else {
+            // Moves carry any kind of cell, including operators and stop cells
+            int source = _td_move_source(kind);
+            size_t operand = neighbours[source];
+            uint16_t moved = (operand == SIZE_MAX) ? 0 : pruning->kinds[operand] & ~TD_KIND_BIT(CELL_EMPTY);
+            if (moved != 0) {
+                _td_prune_write(history, operand, TD_KIND_BIT(CELL_EMPTY));
+                _td_prune_write(history, neighbours[(source + 2) % 4], moved);
+            }
+        }
+    }
+}
+
+void _td_prune_mark_relevant(TD_Pruning* pruning, size_t index) {
+    if (!pruning->relevant[index]) {
+        pruning->relevant[index] = true;
+        nob_da_append(&pruning->queue, index);
+    }
+}
+
+// The content of the cell at `index` matters, so every operator that may write
+// to it does as well
+void _td_prune_mark_needed(TD_BoardHistory* history, size_t index) {
+    TD_Pruning* pruning = &history->pruning;
+    if (index == SIZE_MAX || pruning->needed[index]) {
+        return;
+    }
+
+    pruning->needed[index] = true;
+    for (int direction = 0; direction < 4; ++direction) {
+        size_t writer = _td_prune_neighbour(history, index, direction);
+        if (writer != SIZE_MAX && (_td_prune_writes(pruning, writer) & (1u << ((direction + 2) % 4)))) {
+            _td_prune_mark_relevant(pruning, writer);
+        }
+    }
+}
+
+// Finds the cells whose operators can influence whether and when a stop cell is
+// written and with which value. Each cell is given the set of kinds it may ever
+// hold, which only grows from the initial board by the writes of the operators
+// it may hold. Operators that may write to a cell that may hold a stop cell are
+// relevant, as are all time warps since they replace the whole board. The cells
+// a relevant operator reads from and the operator's own cell are needed, and the
+// operators that may write to needed cells are relevant in turn.
+//
+// Cells that are not relevant are not evaluated from then on. This does not
+// change the outcome of a program that stops, but the cells they would have
+// written keep their contents, and a program stalls once the relevant cells do.
+// Meant to be called right after loading the program.
+void td_prune(TD_BoardHistory* history) {
+    TD_Pruning* pruning = &history->pruning;
+    // Binary programs may come with the result of the analysis
+    if (pruning->enabled) {
+        return;
+    }
+
+    size_t cells_count = history->cols * history->rows;
+    TD_Cell* cells = td_board_at(history, 0)->cells;
+
+    pruning->kinds = NOB_REALLOC(pruning->kinds, cells_count * sizeof(uint16_t));
+    pruning->written = NOB_REALLOC(pruning->written, cells_count * sizeof(bool));
+    pruning->needed = NOB_REALLOC(pruning->needed, cells_count * sizeof(bool));
+    pruning->queued = NOB_REALLOC(pruning->queued, cells_count * sizeof(bool));
+    pruning->relevant = NOB_REALLOC(pruning->relevant, cells_count * sizeof(bool));
+    NOB_ASSERT(pruning->kinds != NULL && pruning->written != NULL && pruning->needed != NULL
+               && pruning->queued != NULL && pruning->relevant != NULL && "Buy more RAM lol");
+    memset(pruning->written, 0, cells_count * sizeof(bool));
+    memset(pruning->needed, 0, cells_count * sizeof(bool));
+    memset(pruning->relevant, 0, cells_count * sizeof(bool));
+
+    pruning->queue.count = 0;
+    for (size_t i = 0; i < cells_count; ++i) {
+        pruning->kinds[i] = TD_KIND_BIT(cells[i].kind);
+        pruning->queued[i] = true;
+        nob_da_append(&pruning->queue, i);
+    }
+
+    bool scattered = false;
+    while (pruning->queue.count > 0) {
+        size_t index = pruning->queue.items[--pruning->queue.count];
+        pruning->queued[index] = false;
+        _td_prune_visit(history, cells, index, &scattered);
+    }
+
+    for (size_t i = 0; i < cells_count; ++i) {
+        if (pruning->kinds[i] & TD_KIND_BIT(CELL_TIMEWARP)) {
+            _td_prune_mark_relevant(pruning, i);
+        }
+        if (pruning->kinds[i] & TD_KIND_BIT(CELL_STOP)) {
+            for (int direction = 0; direction < 4; ++direction) {
+                size_t writer = _td_prune_neighbour(history, i, direction);
+                if (writer != SIZE_MAX && (_td_prune_writes(pruning, writer) & (1u << ((direction + 2) % 4)))) {
+                    _td_prune_mark_relevant(pruning, writer);
+                }
+            }
+        }
+    }
+
+    while (pruning->queue.count > 0) {
+        size_t index = pruning->queue.items[--pruning->queue.count];
+        _td_prune_mark_needed(history, index);
+
+        unsigned reads = 0;
+        for (TD_CellKind kind = CELL_MOVE_LEFT; kind < CELL_STOP; ++kind) {
+            unsigned kind_reads, kind_writes;
+            if (pruning->kinds[index] & TD_KIND_BIT(kind)) {
+                _td_prune_operator(kind, &kind_reads, &kind_writes);
+                reads |= kind_reads;
+            }
+        }
+        for (int direction = 0; direction < 4; ++direction) {
+            if (reads & (1u << direction)) {
+                _td_prune_mark_needed(history, _td_prune_neighbour(history, index, direction));
+            }
+        }
+    }
+
+    pruning->cells.count = 0;
+    for (size_t i = 0; i < cells_count; ++i) {
+        if (pruning->relevant[i]) {
+            nob_da_append(&pruning->cells, i);
+        }
+    }
+
+    NOB_FREE(pruning->kinds);
+    NOB_FREE(pruning->written);
+    NOB_FREE(pruning->needed);
+    NOB_FREE(pruning->queued);
+    nob_da_free(pruning->queue);
+    pruning->kinds = NULL;
+    pruning->written = NULL;
+    pruning->needed = NULL;
+    pruning->queued = NULL;
+    pruning->queue = (TD_CellIndices) {
+        0
+    };
+
+    // Ticks computed before were evaluated in full
+    _td_clear_caches(history);
+    pruning->enabled = true;
+    history->superinstructions.built = false;
+    nob_log(NOB_INFO, "Pruned %zu of %zu cells that can not influence a stop cell.",
+            cells_count - pruning->cells.count, cells_count);
+}
+
+bool _td_is_relevant(TD_BoardHistory* history, size_t index) {
+    return !history->pruning.enabled || history->pruning.relevant[index];
+}
+
+// Superinstructions
+
+// The chain of `instruction` continues with the operator at `index`, `stride`
+// cells after its last one, if it is a relevant move in the same direction with
+// both its source and target on the board. Consecutive moves of a chain share
+// the cell between them, which is the target of one and the source of the other.
+bool _td_chains_with(TD_BoardHistory* history, TD_Superinstruction* instruction, size_t index, bool* chained) {
+    int source = _td_move_source(instruction->kind);
+    return index != SIZE_MAX && !chained[index] && _td_is_relevant(history, index)
+           && td_board_at(history, 0)->cells[index].kind == instruction->kind
+           && _td_prune_neighbour(history, index, source) != SIZE_MAX
+           && _td_prune_neighbour(history, index, (source + 2) % 4) != SIZE_MAX;
+}
+
+// Operators only write to their neighbours, so the order they are evaluated in
+// only matters for cells more than one of them writes to. Nothing else writes
+// to the cells of a chain if its moves are the only writers of the cells they
+// read and write, and none of them is written to itself. Then the chain can be
+// evaluated as a whole at any point of the tick.
+bool _td_chain_is_closed(TD_Superinstruction* instruction, uint8_t* writers) {
+    bool vertical = instruction->kind == CELL_MOVE_UP || instruction->kind == CELL_MOVE_DOWN;
+    size_t before = instruction->neighbours[vertical ? 1 : 0];
+    size_t after = instruction->neighbours[vertical ? 3 : 2];
+    for (size_t i = 0; i < instruction->count; ++i) {
+        size_t offset = i * instruction->stride;
+        if (writers[instruction->index + offset] != 0
+                || writers[before + offset] != ((i > 0) ? 2 : 1)
+                || writers[after + offset] != ((i + 1 < instruction->count) ? 2 : 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Turns the relevant operators of the first board into superinstructions, with
+// chains of at least two moves fused into one
+void _td_build_superinstructions(TD_BoardHistory* history) {
+    TD_Superinstructions* superinstructions = &history->superinstructions;
+    TD_Cell* cells = td_board_at(history, 0)->cells;
+    size_t cells_count = history->cols * history->rows;
+
+    uint8_t* writers = NOB_REALLOC(NULL, cells_count);
+    bool* chained = NOB_REALLOC(NULL, cells_count * sizeof(bool));
+    NOB_ASSERT(writers != NULL && chained != NULL && "Buy more RAM lol");
+    memset(writers, 0, cells_count);
+    memset(chained, 0, cells_count * sizeof(bool));
+    for (size_t i = 0; i < cells_count; ++i) {
+        unsigned reads, writes;
+        _td_prune_operator(cells[i].kind, &reads, &writes);
+        for (int direction = 0; direction < 4 && _td_is_relevant(history, i); ++direction) {
+            size_t neighbour = _td_prune_neighbour(history, i, direction);
+            if ((writes & (1u << direction)) && neighbour != SIZE_MAX && writers[neighbour] < UINT8_MAX) {
+                writers[neighbour]++;
+            }
+        }
+    }
+
+    superinstructions->count = 0;
+    superinstructions->operators = 0;
+    superinstructions->timewarps.count = 0;
+    for (size_t i = 0; i < cells_count; ++i) {
+        TD_CellKind kind = cells[i].kind;
+        if (kind == CELL_TIMEWARP) {
+            nob_da_append(&superinstructions->timewarps, i);
+        }
+        if (chained[i] || kind < CELL_MOVE_LEFT || kind > CELL_CMP_NOTEQUAL || !_td_is_relevant(history, i)) {
+            continue;
+        }
+
+        TD_Superinstruction instruction = {
+            .kind = kind,
+            .index = i,
+            .count = 1,
+        };
+        for (int direction = 0; direction < 4; ++direction) {
+            instruction.neighbours[direction] = _td_prune_neighbour(history, i, direction);
+        }
+
+        // Chains are followed towards higher indices, the order the operators
+        // would be evaluated in
+        bool vertical = kind == CELL_MOVE_UP || kind == CELL_MOVE_DOWN;
+        int source = _td_move_source(kind);
+        if (kind <= CELL_MOVE_DOWN && instruction.neighbours[source] != SIZE_MAX
+                && instruction.neighbours[(source + 2) % 4] != SIZE_MAX) {
+            instruction.stride = vertical ? 2 * history->cols : 2;
+            size_t next = _td_prune_neighbour(history, _td_prune_neighbour(history, i, vertical ? 3 : 2), vertical ? 3 : 2);
+            while (_td_chains_with(history, &instruction, next, chained)) {
+                instruction.count++;
+                next = _td_prune_neighbour(history, _td_prune_neighbour(history, next, vertical ? 3 : 2), vertical ? 3 : 2);
+            }
+            if (instruction.count > 1 && !_td_chain_is_closed(&instruction, writers)) {
+                instruction.count = 1;
+            }
+            for (size_t j = 0; j < instruction.count; ++j) {
+                chained[i + j * instruction.stride] = true;
+            }
+        }
+
+        nob_da_append(superinstructions, instruction);
+        superinstructions->operators += instruction.count;
+    }
+
+    NOB_FREE(writers);
+    NOB_FREE(chained);
+    superinstructions->built = true;
+}
+
+void _td_write_neighbour(TD_Board* board, size_t index, TD_Cell value) {
+    if (index != SIZE_MAX) {
+        td_write_cell(board, index, value);
+    }
+}
+
+void _td_activate_neighbour(TD_Board* board, size_t index) {
+    if (index != SIZE_MAX) {
+        board->cells[index].active = true;
+    }
+}
+
+// Mirrors _td_evaluate_cell for the operator `offset` cells after the first one
+// of `instruction`. Cells outside of the board are empty.
+void _td_run_operator(TD_Board* current_board, TD_Board* next_board, TD_Superinstruction* instruction, size_t offset) {
+    TD_Cell* cells = current_board->cells;
+    size_t index = instruction->index + offset;
+    if (cells[index].kind != instruction->kind) {
+        return;
+    }
+
+    size_t neighbours[4];
+    for (int direction = 0; direction < 4; ++direction) {
+        neighbours[direction] = (instruction->neighbours[direction] == SIZE_MAX) ? SIZE_MAX : instruction->neighbours[direction] + offset;
+    }
+    size_t left = neighbours[0], up = neighbours[1], right = neighbours[2], down = neighbours[3];
+
+    switch (instruction->kind) {
+    case CELL_MOVE_LEFT:
+    case CELL_MOVE_RIGHT:
+    case CELL_MOVE_UP:
+    case CELL_MOVE_DOWN: {
+        int source = _td_move_source(instruction->kind);
+        size_t from = neighbours[source];
+        size_t to = neighbours[(source + 2) % 4];
+        if (from != SIZE_MAX && cells[from].kind != CELL_EMPTY) {
+            _td_write_neighbour(next_board, from, _td_make_empty_cell());
+            _td_write_neighbour(next_board, to, cells[from]);
+            next_board->cells[index].active = true;
+            _td_activate_neighbour(next_board, to);
+        }
+        break;
+    }
+    case CELL_CALC_ADD:
+    case CELL_CALC_SUBTRACT:
+    case CELL_CALC_DIVIDE:
+    case CELL_CALC_MULTIPLY:
+    case CELL_CALC_REMAINDER: {
+        if (left == SIZE_MAX || up == SIZE_MAX || cells[left].kind != CELL_NUMBER || cells[up].kind != CELL_NUMBER) {
+            break;
+        }
+
+        int a = cells[left].value, b = cells[up].value;
+        if (!td_calculation_defined(instruction->kind, a, b)) {
+            next_board->status = STATUS_CRASH;
+            break;
+        }
+        int value = (instruction->kind == CELL_CALC_ADD) ? a + b
+                    : (instruction->kind == CELL_CALC_SUBTRACT) ? a - b
+                    : (instruction->kind == CELL_CALC_MULTIPLY) ? a * b
+                    : (instruction->kind == CELL_CALC_DIVIDE) ? a / b
+                    : a % b;
+        _td_write_neighbour(next_board, left, _td_make_empty_cell());
+        _td_write_neighbour(next_board, up, _td_make_empty_cell());
+        _td_write_neighbour(next_board, right, _td_make_number_cell(value));
+        _td_write_neighbour(next_board, down, _td_make_number_cell(value));
+        next_board->cells[index].active = true;
+        _td_activate_neighbour(next_board, right);
+        _td_activate_neighbour(next_board, down);
+        break;
+    }
+    case CELL_CMP_EQUAL:
+    case CELL_CMP_NOTEQUAL: {
+        if (left == SIZE_MAX || up == SIZE_MAX || cells[left].kind != CELL_NUMBER || cells[up].kind != CELL_NUMBER
+                || (cells[left].value == cells[up].value) != (instruction->kind == CELL_CMP_EQUAL)) {
+            break;
+        }
+
+        _td_write_neighbour(next_board, left, _td_make_empty_cell());
+        _td_write_neighbour(next_board, right, cells[left]);
+        _td_activate_neighbour(next_board, right);
+        _td_write_neighbour(next_board, up, _td_make_empty_cell());
+        _td_write_neighbour(next_board, down, cells[up]);
+        _td_activate_neighbour(next_board, down);
+        next_board->cells[index].active = true;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Most moves of a chain have nothing to move in a given tick, which only takes
+// a look at their source cell to find out
+void _td_run_superinstructions(TD_BoardHistory* history, TD_Board* current_board, TD_Board* next_board) {
+    if (!history->superinstructions.built) {
+        _td_build_superinstructions(history);
+    }
+
+    TD_Cell* cells = current_board->cells;
+    for (size_t i = 0; i < history->superinstructions.count; ++i) {
+        TD_Superinstruction* instruction = &history->superinstructions.items[i];
+        if (instruction->count == 1) {
+            _td_run_operator(current_board, next_board, instruction, 0);
+            continue;
+        }
+
+        size_t source = instruction->neighbours[_td_move_source(instruction->kind)];
+        for (size_t j = 0; j < instruction->count; ++j) {
+            if (cells[source + j * instruction->stride].kind != CELL_EMPTY) {
+                _td_run_operator(current_board, next_board, instruction, j * instruction->stride);
+            }
+        }
+    }
+}
+
+// Time warps are never pruned, so only the relevant cells have to be looked at
+// once the board is pruned. Until an operator is moved, the time warps are the
+// ones of the first board.
+void _td_collect_timewarps(TD_Board* board, TD_Timewarps* timewarps) {
+    TD_BoardHistory* history = board->history;
+    if (_td_is_compiled(history)) {
+        TD_BoardCursor first_cursor = td_cursor_first(board);
+        for (size_t i = 0; i < history->compiled->timewarps_count; ++i) {
+            size_t index = history->compiled->timewarps[i];
+            _td_collect_timewarp(td_cursor_move(first_cursor, index % history->cols, index / history->cols), timewarps);
+        }
+        return;
+    }
+    if (history->moved_index == SIZE_MAX) {
+        if (!history->superinstructions.built) {
+            _td_build_superinstructions(history);
+        }
+        TD_BoardCursor first_cursor = td_cursor_first(board);
+        for (size_t i = 0; i < history->superinstructions.timewarps.count; ++i) {
+            size_t index = history->superinstructions.timewarps.items[i];
+            _td_collect_timewarp(td_cursor_move(first_cursor, index % history->cols, index / history->cols), timewarps);
+        }
+        return;
+    }
+
+    if (!history->pruning.enabled) {
+        TD_FOREACH(board, cursor) {
+            _td_collect_timewarp(cursor, timewarps);
+        }
+        return;
+    }
+
+    TD_BoardCursor first_cursor = td_cursor_first(board);
+    for (size_t i = 0; i < history->pruning.cells.count; ++i) {
+        size_t index = history->pruning.cells.items[i];
+        _td_collect_timewarp(td_cursor_move(first_cursor, index % history->cols, index / history->cols), timewarps);
+    }
+}
+
+// Evaluates the operators of `current_board` into `next_board`, skipping pruned
+// cells. As long as all operators are where they are on the first board, their
+// superinstructions are evaluated instead.
+void _td_evaluate_board(TD_BoardHistory* history, TD_Board* current_board, TD_Board* next_board) {
+    if (history->moved_index == SIZE_MAX) {
+        _td_run_superinstructions(history, current_board, next_board);
+        if (next_board->status != STATUS_STOPPED) {
+            return;
+        }
+
+        // Chains are evaluated out of the order of their cells, which decides
+        // the result if more than one write reaches a stop cell. So the tick is
+        // evaluated again cell by cell.
+        memcpy(next_board->cells, current_board->cells, history->cells_bytes);
+        for (size_t i = 0; i < history->cols * history->rows; ++i) {
+            next_board->cells[i].active = false;
+        }
+        next_board->hash = current_board->hash;
+        next_board->status = STATUS_RUNNING;
+        next_board->result = 0;
+    }
+
+    if (!history->pruning.enabled) {
+        TD_FOREACH(current_board, current_cursor) {
+            _td_evaluate_cell(current_cursor, next_board);
+        }
+        return;
+    }
+
+    TD_BoardCursor first_cursor = td_cursor_first(current_board);
+    for (size_t i = 0; i < history->pruning.cells.count; ++i) {
+        size_t index = history->pruning.cells.items[i];
+        _td_evaluate_cell(td_cursor_move(first_cursor, index % history->cols, index / history->cols), next_board);
+    }
+}
+
+// Compilation to C
+
+void _td_compile_append(Nob_String_Builder* sb, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    nob_sb_append_cstr(sb, line);
+}
+
+const char* _td_compile_kind(TD_CellKind kind) {
+    switch (kind) {
+    case CELL_MOVE_LEFT:
+        return "CELL_MOVE_LEFT";
+    case CELL_MOVE_RIGHT:
+        return "CELL_MOVE_RIGHT";
+    case CELL_MOVE_UP:
+        return "CELL_MOVE_UP";
+    case CELL_MOVE_DOWN:
+        return "CELL_MOVE_DOWN";
+    case CELL_CALC_ADD:
+        return "CELL_CALC_ADD";
+    case CELL_CALC_SUBTRACT:
+        return "CELL_CALC_SUBTRACT";
+    case CELL_CALC_DIVIDE:
+        return "CELL_CALC_DIVIDE";
+    case CELL_CALC_MULTIPLY:
+        return "CELL_CALC_MULTIPLY";
+    case CELL_CALC_REMAINDER:
+        return "CELL_CALC_REMAINDER";
+    case CELL_CMP_EQUAL:
+        return "CELL_CMP_EQUAL";
+    case CELL_CMP_NOTEQUAL:
+        return "CELL_CMP_NOTEQUAL";
+    case CELL_TIMEWARP:
+        return "CELL_TIMEWARP";
+    default:
+        return NULL;
+    }
+}
+
+const char* _td_compile_operator(TD_CellKind kind) {
+    switch (kind) {
+    case CELL_CALC_ADD:
+        return "+";
+    case CELL_CALC_SUBTRACT:
+        return "-";
+    case CELL_CALC_DIVIDE:
+        return "/";
+    case CELL_CALC_MULTIPLY:
+        return "*";
+    case CELL_CALC_REMAINDER:
+        return "%";
+    case CELL_CMP_EQUAL:
+        return "==";
+    case CELL_CMP_NOTEQUAL:
+        return "!=";
+    default:
+        return NULL;
+    }
+}
+
+// Whether the cell at `index` of the first board holds an operator the compiled
+// program evaluates
+bool _td_compile_cell(TD_BoardHistory* history, size_t index) {
+    return _td_compile_kind(td_board_at(history, 0)->cells[index].kind) != NULL && _td_is_relevant(history, index);
+}
+
+// Fingerprint of the operators on the first board, so a compiled program is only
+// attached to the program it was compiled from, pruned the same way
+uint64_t _td_compile_layout(TD_BoardHistory* history) {
+    TD_Cell* cells = td_board_at(history, 0)->cells;
+    uint64_t layout = _td_mix_hash(history->cols * 31 + history->rows);
+    for (size_t i = 0; i < history->cols * history->rows; ++i) {
+        if (_td_compile_cell(history, i)) {
+            layout = _td_mix_hash(layout ^ ((uint64_t) i << 4 | cells[i].kind));
+        }
+    }
+    return layout;
+}
+
+void _td_compile_write(Nob_String_Builder* sb, size_t index, const char* value) {
+    if (index != SIZE_MAX) {
+        _td_compile_append(sb, "        td_write_cell(next_board, %zu, %s);\n", index, value);
+    }
+}
+
+void _td_compile_activate(Nob_String_Builder* sb, size_t index) {
+    if (index != SIZE_MAX) {
+        _td_compile_append(sb, "        n[%zu].active = true;\n", index);
+    }
+}
+
+// Emits the code of the operator at `index`, mirroring _td_evaluate_cell with
+// the neighbours looked up in advance. Operators that take an operand from
+// outside of the board never fire and writes outside of it are dropped.
+void _td_compile_operator_cell(TD_BoardHistory* history, Nob_String_Builder* sb, size_t index) {
+    TD_CellKind kind = td_board_at(history, 0)->cells[index].kind;
+    size_t neighbours[4];
+    for (int direction = 0; direction < 4; ++direction) {
+        neighbours[direction] = _td_prune_neighbour(history, index, direction);
+    }
+    size_t left = neighbours[0], up = neighbours[1], right = neighbours[2], down = neighbours[3];
+
+    switch (kind) {
+    case CELL_MOVE_LEFT:
+    case CELL_MOVE_RIGHT:
+    case CELL_MOVE_UP:
+    case CELL_MOVE_DOWN: {
+        int source = _td_move_source(kind);
+        if (neighbours[source] == SIZE_MAX) {
+            return;
+        }
+        _td_compile_append(sb, "    if (c[%zu].kind == %s && c[%zu].kind != CELL_EMPTY) {\n",
+                           index, _td_compile_kind(kind), neighbours[source]);
+        _td_compile_write(sb, neighbours[source], "(TD_Cell) {0}");
+        _td_compile_write(sb, neighbours[(source + 2) % 4], nob_temp_sprintf("c[%zu]", neighbours[source]));
+        _td_compile_activate(sb, index);
+        _td_compile_activate(sb, neighbours[(source + 2) % 4]);
+        break;
+    }
+    case CELL_CALC_ADD:
+    case CELL_CALC_SUBTRACT:
+    case CELL_CALC_DIVIDE:
+    case CELL_CALC_MULTIPLY:
+    case CELL_CALC_REMAINDER:
+        if (left == SIZE_MAX || up == SIZE_MAX) {
+            return;
+        }
+        if (kind == CELL_CALC_DIVIDE || kind == CELL_CALC_REMAINDER) {
+            _td_compile_append(sb, "    if (c[%zu].kind == %s && c[%zu].kind == CELL_NUMBER && c[%zu].kind == CELL_NUMBER\n",
+                               index, _td_compile_kind(kind), left, up);
+            _td_compile_append(sb, "            && !td_calculation_defined(%s, c[%zu].value, c[%zu].value)) {\n",
+                               _td_compile_kind(kind), left, up);
+            _td_compile_append(sb, "        next_board->status = STATUS_CRASH;\n");
+            _td_compile_append(sb, "    } else ");
+        } else {
+            _td_compile_append(sb, "    ");
+        }
+        _td_compile_append(sb, "if (c[%zu].kind == %s && c[%zu].kind == CELL_NUMBER && c[%zu].kind == CELL_NUMBER) {\n",
+                           index, _td_compile_kind(kind), left, up);
+        // A result that is written nowhere is not computed
+        if (right != SIZE_MAX || down != SIZE_MAX) {
+            _td_compile_append(sb, "        TD_Cell value = {.kind = CELL_NUMBER, .value = c[%zu].value %s c[%zu].value};\n",
+                               left, _td_compile_operator(kind), up);
+        }
+        _td_compile_write(sb, left, "(TD_Cell) {0}");
+        _td_compile_write(sb, up, "(TD_Cell) {0}");
+        _td_compile_write(sb, right, "value");
+        _td_compile_write(sb, down, "value");
+        _td_compile_activate(sb, index);
+        _td_compile_activate(sb, right);
+        _td_compile_activate(sb, down);
+        break;
+    case CELL_CMP_EQUAL:
+    case CELL_CMP_NOTEQUAL:
+        if (left == SIZE_MAX || up == SIZE_MAX) {
+            return;
+        }
+        _td_compile_append(sb, "    if (c[%zu].kind == %s && c[%zu].kind == CELL_NUMBER && c[%zu].kind == CELL_NUMBER\n",
+                           index, _td_compile_kind(kind), left, up);
+        _td_compile_append(sb, "            && c[%zu].value %s c[%zu].value) {\n", left, _td_compile_operator(kind), up);
+        _td_compile_write(sb, left, "(TD_Cell) {0}");
+        _td_compile_write(sb, right, nob_temp_sprintf("c[%zu]", left));
+        _td_compile_activate(sb, index);
+        _td_compile_activate(sb, right);
+        _td_compile_write(sb, up, "(TD_Cell) {0}");
+        _td_compile_write(sb, down, nob_temp_sprintf("c[%zu]", up));
+        _td_compile_activate(sb, down);
+        break;
+    default:
+        // Time warps are collected by td_forward
+        return;
+    }
+    _td_compile_append(sb, "        fired = true;\n");
+    _td_compile_append(sb, "    }\n");
+}
+
+// Writes a C translation unit to `path` that defines `td_compiled_program` for
+// the loaded program, to be linked with the engine and passed to td_attach. Its
+// tick evaluates the operators where they are on the first board in the order
+// td_forward would, with their neighbours resolved at compile time. Cells that
+// are pruned at the time of compiling are left out.
+bool td_compile(TD_BoardHistory* history, const char* path) {
+    TD_Cell* cells = td_board_at(history, 0)->cells;
+    size_t cells_count = history->cols * history->rows;
+    Nob_String_Builder sb = {0};
+
+    _td_compile_append(&sb, "// Generated by td_compile for a program of %zu columns and %zu rows.\n",
+                       history->cols, history->rows);
+    _td_compile_append(&sb, "#include <3dl.h>\n\n");
+    // Each row gets a function of its own, since compilers take much longer to
+    // optimise one huge function
+    Nob_String_Builder row = {0};
+    Nob_String_Builder tick = {0};
+    size_t timewarps_count = 0;
+    for (size_t y = 0; y < history->rows; ++y) {
+        row.count = 0;
+        for (size_t i = y * history->cols; i < (y + 1) * history->cols; ++i) {
+            if (_td_compile_cell(history, i)) {
+                size_t mark = nob_temp_save();
+                _td_compile_operator_cell(history, &row, i);
+                nob_temp_rewind(mark);
+                timewarps_count += cells[i].kind == CELL_TIMEWARP;
+            }
+        }
+        if (row.count == 0) {
+            continue;
+        }
+
+        _td_compile_append(&sb, "static bool td_compiled_row_%zu(TD_Board* current_board, TD_Board* next_board) {\n", y);
+        _td_compile_append(&sb, "    TD_Cell* c = current_board->cells;\n");
+        _td_compile_append(&sb, "    TD_Cell* n = next_board->cells;\n");
+        _td_compile_append(&sb, "    bool fired = false;\n");
+        nob_da_append_many(&sb, row.items, row.count);
+        _td_compile_append(&sb, "    return fired;\n");
+        _td_compile_append(&sb, "}\n\n");
+        _td_compile_append(&tick, "    fired |= td_compiled_row_%zu(current_board, next_board);\n", y);
+    }
+
+    _td_compile_append(&sb, "static bool td_compiled_tick(TD_Board* current_board, TD_Board* next_board) {\n");
+    _td_compile_append(&sb, "    bool fired = false;\n");
+    nob_da_append_many(&sb, tick.items, tick.count);
+    _td_compile_append(&sb, "    return fired;\n");
+    _td_compile_append(&sb, "}\n\n");
+    nob_sb_free(row);
+    nob_sb_free(tick);
+
+    // An array can't be empty, so a program without time warps gets a dummy one
+    _td_compile_append(&sb, "static const size_t td_compiled_timewarps[] = {\n");
+    for (size_t i = 0; i < cells_count; ++i) {
+        if (_td_compile_cell(history, i) && cells[i].kind == CELL_TIMEWARP) {
+            _td_compile_append(&sb, "    %zu,\n", i);
+        }
+    }
+    if (timewarps_count == 0) {
+        _td_compile_append(&sb, "    0,\n");
+    }
+    _td_compile_append(&sb, "};\n\n");
+
+    _td_compile_append(&sb, "const TD_CompiledProgram td_compiled_program = {\n");
+    _td_compile_append(&sb, "    .cols = %zu,\n", history->cols);
+    _td_compile_append(&sb, "    .rows = %zu,\n", history->rows);
+    _td_compile_append(&sb, "    .layout = 0x%016llxULL,\n", (unsigned long long) _td_compile_layout(history));
+    _td_compile_append(&sb, "    .tick = td_compiled_tick,\n");
+    _td_compile_append(&sb, "    .timewarps = td_compiled_timewarps,\n");
+    _td_compile_append(&sb, "    .timewarps_count = %zu,\n", timewarps_count);
+    _td_compile_append(&sb, "};\n");
+
+    bool result = nob_write_entire_file(path, sb.items, sb.count);
+    nob_sb_free(sb);
+    return result;
+}
+
+// Uses a program compiled by td_compile for the plain ticks of the loaded one,
+// until an operator is moved to a cell it was not in on the first board. Fails
+// if the program was compiled from a different board or pruned differently.
+bool td_attach(TD_BoardHistory* history, const TD_CompiledProgram* program) {
+    if (program->cols != history->cols || program->rows != history->rows
+            || program->layout != _td_compile_layout(history)) {
+        nob_log(NOB_ERROR, "The compiled program was compiled from a different board.");
+        return false;
+    }
+
+    history->compiled = program;
+    return true;
+}
+
+// Differential re-execution
+
+#define TD_DIFF_FAR UINT8_MAX
+
+int _td_compare_indices(const void* first, const void* second) {
+    size_t a = *(const size_t*) first;
+    size_t b = *(const size_t*) second;
+    return (a > b) - (a < b);
+}
+
+void _td_restore_cell(TD_Board* board, size_t index, TD_Cell cell) {
+    board->hash ^= _td_cell_hash(index, board->cells[index]) ^ _td_cell_hash(index, cell);
+    board->cells[index] = cell;
+}
+
+void _td_clear_diff_area(TD_BoardHistory* history) {
+    for (size_t i = 0; i < history->diff_area.count; ++i) {
+        history->diff_distances[history->diff_area.items[i]] = TD_DIFF_FAR;
+    }
+    history->diff_area.count = 0;
+}
+
+// Collects the cells within distance 4 of the diff in row-major order and records
+// their distance to it. Returns false if they cover too much of the board for
+// the differential tick to pay off.
+bool _td_collect_diff_area(TD_BoardHistory* history) {
+    size_t cells_count = history->cols * history->rows;
+    if (history->diff_distances == NULL) {
+        history->diff_distances = NOB_REALLOC(NULL, cells_count);
+        NOB_ASSERT(history->diff_distances != NULL && "Buy more RAM lol");
+        memset(history->diff_distances, TD_DIFF_FAR, cells_count);
+    }
+
+    for (size_t i = 0; i < history->diff.count; ++i) {
+        int row = history->diff.items[i] / history->cols;
+        int col = history->diff.items[i] % history->cols;
+        for (int dy = -4; dy <= 4; ++dy) {
+            int reach = 4 - abs(dy);
+            for (int dx = -reach; dx <= reach; ++dx) {
+                if (row + dy < 0 || row + dy >= (int) history->rows || col + dx < 0 || col + dx >= (int) history->cols) {
+                    continue;
+                }
+
+                size_t index = (row + dy) * history->cols + (col + dx);
+                uint8_t distance = abs(dx) + abs(dy);
+                if (history->diff_distances[index] == TD_DIFF_FAR) {
+                    nob_da_append(&history->diff_area, index);
+                }
+                if (distance < history->diff_distances[index]) {
+                    history->diff_distances[index] = distance;
+                }
+            }
+        }
+
+        if (history->diff_area.count * 2 > cells_count) {
+            _td_clear_diff_area(history);
+            return false;
+        }
+    }
+
+    qsort(history->diff_area.items, history->diff_area.count, sizeof(size_t), _td_compare_indices);
+    return true;
+}
+
+// Starts differential re-execution from a board created by time warps, which
+// only differs from the board it was cloned from in the cells the warps wrote.
+void _td_diverge(TD_BoardHistory* history, size_t source, TD_Timewarps timewarps) {
+    TD_Board* board = td_board_at(history, history->count - 1);
+    TD_Cell* source_cells = td_board_cells(td_board_at(history, source));
+
+    history->diverged = true;
+    history->diverged_source = source;
+    history->diff.count = 0;
+    for (size_t i = 0; i < da_size(timewarps); ++i) {
+        TD_BoardCursor cursor = timewarps[i].cell_cursor;
+        if (!cursor.valid) {
+            continue;
+        }
+
+        size_t index = cursor.row * history->cols + cursor.col;
+        if (board->cells[index].kind == source_cells[index].kind
+                && board->cells[index].value == source_cells[index].value) {
+            continue;
+        }
+
+        bool listed = false;
+        for (size_t j = 0; j < history->diff.count; ++j) {
+            listed = listed || history->diff.items[j] == index;
+        }
+        if (!listed) {
+            nob_da_append(&history->diff, index);
+        }
+    }
+}
+
+// The successor of the diverged source has to be a plain tick that did not stop
+// the program, otherwise writes outside of the diff area mattered for the outcome.
+bool _td_can_forward_diverged(TD_BoardHistory* history) {
+    if (!history->diverged || !_td_has_plain_successor(history, history->diverged_source)) {
+        return false;
+    }
+
+    TD_Status status = td_board_at(history, history->diverged_source + 1)->status;
+    if (status != STATUS_RUNNING && status != STATUS_STALLED && status != STATUS_LOOPING) {
+        return false;
+    }
+    return _td_collect_diff_area(history);
+}
+
+// A tick only looks at the direct neighbours of a cell. So cells further than 2
+// away from the diff end up the same as in the successor of the diverged source,
+// and the ones up to distance 2 are computed again by the operators up to
+// distance 3. Those operators also write to cells at distance 3 and 4, which are
+// restored from the recorded successor afterwards.
+TD_Board* _td_forward_diverged(TD_BoardHistory* history) {
+    TD_Board* current_board = td_board_at(history, history->count - 1);
+    size_t source = history->diverged_source + 1;
+    TD_Board* source_board = td_board_at(history, source);
+
+    TD_Board* next_board = _td_copy_board(history, source, current_board->time + 1);
+    TD_Cell* source_cells = td_board_cells(source_board);
+    next_board->status = STATUS_RUNNING;
+    next_board->result = 0;
+
+    TD_CellIndices area = history->diff_area;
+    for (size_t i = 0; i < area.count; ++i) {
+        TD_Cell cell = current_board->cells[area.items[i]];
+        cell.active = false;
+        _td_restore_cell(next_board, area.items[i], cell);
+    }
+
+    TD_BoardCursor first_cursor = td_cursor_first(current_board);
+    for (size_t i = 0; i < area.count; ++i) {
+        if (history->diff_distances[area.items[i]] <= 3 && _td_is_relevant(history, area.items[i])) {
+            TD_BoardCursor cursor = td_cursor_move(first_cursor, area.items[i] % history->cols, area.items[i] / history->cols);
+            _td_evaluate_cell(cursor, next_board);
+        }
+    }
+
+    history->diff.count = 0;
+    for (size_t i = 0; i < area.count; ++i) {
+        size_t index = area.items[i];
+        if (history->diff_distances[index] >= 3) {
+            _td_restore_cell(next_board, index, source_cells[index]);
+        } else if (next_board->cells[index].kind != source_cells[index].kind
+                   || next_board->cells[index].value != source_cells[index].value) {
+            nob_da_append(&history->diff, index);
+        }
+    }
+    _td_clear_diff_area(history);
+
+    // Once the diff is gone the timeline has caught up with the recorded one
+    history->diverged_source = source;
+    if (history->diff.count == 0) {
+        history->diverged = false;
+        history->spliced = true;
+        history->splice_source = source;
+    }
+    return next_board;
+}
+
+// Input prefix
+
+void _td_prefix_write(TD_InputPrefix* prefix, size_t index, uint8_t input) {
+    if (index != SIZE_MAX) {
+        prefix->next_inputs[index] = input;
+        nob_da_append(&prefix->written, index);
+    }
+}
+
+// Follows the inputs through the plain tick from the last board of the prefix,
+// mirroring _td_evaluate_cell on the operators around the cells holding inputs.
+// Those that read or overwrite such a cell are next to it, and the ones that
+// write to where it is moved to are at most 3 away from it. Returns false if
+// an operator looks at the value of an input.
+bool _td_prefix_step(TD_BoardHistory* history) {
+    TD_InputPrefix* prefix = &history->prefix;
+    TD_Board* board = td_board_at(history, prefix->count - 1);
+    size_t first = prefix->offsets.items[prefix->count - 1];
+    size_t last = prefix->cells.count;
+
+    prefix->area.count = 0;
+    for (size_t i = first; i < last; ++i) {
+        int row = (prefix->cells.items[i] >> 1) / history->cols;
+        int col = (prefix->cells.items[i] >> 1) % history->cols;
+        for (int dy = -3; dy <= 3; ++dy) {
+            int reach = 3 - abs(dy);
+            for (int dx = -reach; dx <= reach; ++dx) {
+                if (row + dy >= 0 && row + dy < (int) history->rows && col + dx >= 0 && col + dx < (int) history->cols) {
+                    nob_da_append(&prefix->area, (row + dy) * history->cols + (col + dx));
+                }
+            }
+        }
+    }
+    if (prefix->area.count > 1) {
+        qsort(prefix->area.items, prefix->area.count, sizeof(size_t), _td_compare_indices);
+    }
+
+    prefix->written.count = 0;
+    for (size_t i = 0; i < prefix->area.count; ++i) {
+        size_t index = prefix->area.items[i];
+        if ((i > 0 && prefix->area.items[i - 1] == index) || !_td_is_relevant(history, index)) {
+            continue;
+        }
+
+        size_t neighbours[4];
+        for (int direction = 0; direction < 4; ++direction) {
+            neighbours[direction] = _td_prune_neighbour(history, index, direction);
+        }
+
+        TD_CellKind kind = board->cells[index].kind;
+        switch (kind) {
+        case CELL_MOVE_LEFT:
+        case CELL_MOVE_RIGHT:
+        case CELL_MOVE_UP:
+        case CELL_MOVE_DOWN: {
+            int source = _td_move_source(kind);
+            size_t operand = neighbours[source];
+            if (operand != SIZE_MAX && board->cells[operand].kind != CELL_EMPTY) {
+                _td_prefix_write(prefix, operand, CELL_INPUT_NONE);
+                _td_prefix_write(prefix, neighbours[(source + 2) % 4], prefix->inputs[operand]);
+            }
+            break;
+        }
+        case CELL_CALC_ADD:
+        case CELL_CALC_SUBTRACT:
+        case CELL_CALC_MULTIPLY:
+        case CELL_CALC_DIVIDE:
+        case CELL_CALC_REMAINDER:
+        case CELL_CMP_EQUAL:
+        case CELL_CMP_NOTEQUAL: {
+            size_t left = neighbours[0];
+            size_t up = neighbours[1];
+            if (left == SIZE_MAX || up == SIZE_MAX
+                    || board->cells[left].kind != CELL_NUMBER || board->cells[up].kind != CELL_NUMBER) {
                 break;
             }
-            case CELL_MOVE_DOWN: {
-                TD_Cell* operand = td_cursor_up(current_cursor).cell;
-                if (operand->kind != CELL_EMPTY) {
-                    _td_move_down(next_cursor, operand);
-                }
-                break;
+            if (prefix->inputs[left] != CELL_INPUT_NONE || prefix->inputs[up] != CELL_INPUT_NONE) {
+                return false;
+            }
+
+            bool fires = true;
+            if (kind == CELL_CMP_EQUAL || kind == CELL_CMP_NOTEQUAL) {
+                fires = (board->cells[left].value == board->cells[up].value) == (kind == CELL_CMP_EQUAL);
+            }
+            if (fires) {
+                for (int direction = 0; direction < 4; ++direction) {
+                    _td_prefix_write(prefix, neighbours[direction], CELL_INPUT_NONE);
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // The cells holding inputs on the next board are the ones that were written
+    // an input and the ones that held one and were not written
+    prefix->area.count = 0;
+    for (size_t i = first; i < last; ++i) {
+        nob_da_append(&prefix->area, prefix->cells.items[i] >> 1);
+    }
+    for (size_t i = 0; i < prefix->written.count; ++i) {
+        size_t index = prefix->written.items[i];
+        prefix->inputs[index] = prefix->next_inputs[index];
+        nob_da_append(&prefix->area, index);
+    }
+    if (prefix->area.count > 1) {
+        qsort(prefix->area.items, prefix->area.count, sizeof(size_t), _td_compare_indices);
+    }
+
+    for (size_t i = 0; i < prefix->area.count; ++i) {
+        size_t index = prefix->area.items[i];
+        if ((i == 0 || prefix->area.items[i - 1] != index) && prefix->inputs[index] != CELL_INPUT_NONE) {
+            nob_da_append(&prefix->cells, index * 2 + (prefix->inputs[index] == CELL_INPUT_B));
+        }
+    }
+    nob_da_append(&prefix->offsets, prefix->cells.count);
+    prefix->count++;
+    return true;
+}
+
+// Called after a plain tick from the board at `index`. The prefix ends at the
+// first tick that is not a plain one or that depends on the inputs.
+void _td_extend_prefix(TD_BoardHistory* history, size_t index) {
+    TD_InputPrefix* prefix = &history->prefix;
+    if (!prefix->tracking) {
+        return;
+    }
+
+    if (index + 1 != prefix->count || td_board_at(history, index + 1)->status != STATUS_RUNNING
+            || !_td_prefix_step(history)) {
+        prefix->tracking = false;
+    }
+}
+
+// Writes the inputs into the boards of the prefix after the first one, and finds
+// loops within the prefix again since its boards may repeat each other for some
+// inputs but not for others
+void _td_restore_prefix(TD_BoardHistory* history, int input_a, int input_b) {
+    TD_InputPrefix* prefix = &history->prefix;
+    for (size_t k = 0; k < prefix->count; ++k) {
+        TD_Board* board = td_board_at(history, k);
+        if (k > 0) {
+            for (size_t i = prefix->offsets.items[k]; i < prefix->offsets.items[k + 1]; ++i) {
+                size_t index = prefix->cells.items[i] >> 1;
+                TD_Cell cell = board->cells[index];
+                cell.value = (prefix->cells.items[i] & 1) ? input_b : input_a;
+                _td_restore_cell(board, index, cell);
+            }
+            _td_transpositions_put(&history->transitions, td_board_at(history, k - 1)->hash, k - 1);
+        }
+
+        board->status = STATUS_RUNNING;
+        _td_detect_loop(history, k);
+        if (board->status == STATUS_LOOPING) {
+            td_truncate(history, k + 1);
+            return;
+        }
+    }
+}
+
+// Execution trace
+
+// The engine fills one buffer while the thread writes the other one to the file
+struct _TD_TraceWriter {
+    FILE* file;
+    char* filling;
+    size_t filled;
+    char* spare;
+
+    // Buffer handed to the thread, guarded by the lock
+    char* pending;
+    size_t pending_count;
+    bool stopping;
+    bool failed;
+
+#ifdef _WIN32
+    HANDLE thread;
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE changed;
+#else
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+#endif
+};
+
+void _td_trace_lock(struct _TD_TraceWriter* writer) {
+#ifdef _WIN32
+    EnterCriticalSection(&writer->lock);
+#else
+    pthread_mutex_lock(&writer->lock);
+#endif
+}
+
+void _td_trace_unlock(struct _TD_TraceWriter* writer) {
+#ifdef _WIN32
+    LeaveCriticalSection(&writer->lock);
+#else
+    pthread_mutex_unlock(&writer->lock);
+#endif
+}
+
+void _td_trace_wait(struct _TD_TraceWriter* writer) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&writer->changed, &writer->lock, INFINITE);
+#else
+    pthread_cond_wait(&writer->changed, &writer->lock);
+#endif
+}
+
+void _td_trace_notify(struct _TD_TraceWriter* writer) {
+#ifdef _WIN32
+    WakeAllConditionVariable(&writer->changed);
+#else
+    pthread_cond_broadcast(&writer->changed);
+#endif
+}
+
+void _td_trace_write_pending(struct _TD_TraceWriter* writer) {
+    _td_trace_lock(writer);
+    while (true) {
+        while (writer->pending == NULL && !writer->stopping) {
+            _td_trace_wait(writer);
+        }
+        if (writer->pending == NULL) {
+            break;
+        }
+
+        char* data = writer->pending;
+        size_t count = writer->pending_count;
+        _td_trace_unlock(writer);
+        bool written = fwrite(data, 1, count, writer->file) == count;
+        _td_trace_lock(writer);
+
+        writer->failed = writer->failed || !written;
+        writer->pending = NULL;
+        _td_trace_notify(writer);
+    }
+    _td_trace_unlock(writer);
+}
+
+#ifdef _WIN32
+DWORD WINAPI _td_trace_thread(LPVOID writer) {
+    _td_trace_write_pending(writer);
+    return 0;
+}
+#else
+void* _td_trace_thread(void* writer) {
+    _td_trace_write_pending(writer);
+    return NULL;
+}
+#endif
+
+// Hands the filled buffer to the thread once it is done with the one before
+void _td_trace_submit(struct _TD_TraceWriter* writer) {
+    _td_trace_lock(writer);
+    while (writer->pending != NULL) {
+        _td_trace_wait(writer);
+    }
+    char* submitted = writer->filling;
+    writer->pending = submitted;
+    writer->pending_count = writer->filled;
+    _td_trace_notify(writer);
+    _td_trace_unlock(writer);
+
+    writer->filling = writer->spare;
+    writer->spare = submitted;
+    writer->filled = 0;
+}
+
+void _td_trace_append(struct _TD_TraceWriter* writer, const void* data, size_t size) {
+    while (size > 0) {
+        size_t count = TD_TRACE_BUFFER_SIZE - writer->filled;
+        if (count > size) {
+            count = size;
+        }
+        memcpy(writer->filling + writer->filled, data, count);
+        writer->filled += count;
+        data = (const char*) data + count;
+        size -= count;
+
+        if (writer->filled == TD_TRACE_BUFFER_SIZE) {
+            _td_trace_submit(writer);
+        }
+    }
+}
+
+void _td_trace_record(struct _TD_TraceWriter* writer, TD_TraceRecordKind kind, TD_Board* board, uint64_t value) {
+    TD_TraceRecord record = {
+        .kind = kind,
+        .status = board->status,
+        .index = board->history->trace.records,
+        .time = board->time,
+        .value = value,
+        .result = (kind == TD_TRACE_STATUS) ? board->result : 0,
+    };
+    _td_trace_append(writer, &record, sizeof(record));
+}
+
+// Marks the board as looping if it repeats the saved board, and saves it once
+// the distance to the saved board reaches the next power of two
+void _td_trace_detect_loop(TD_BoardHistory* history, TD_Board* board) {
+    TD_Trace* trace = &history->trace;
+    if (board->status != STATUS_RUNNING) {
+        return;
+    }
+
+    size_t distance = board->time - trace->loop_time;
+    if (trace->loop_cells != NULL && board->hash == trace->loop_hash) {
+        bool same = true;
+        for (size_t i = 0; same && i < history->cols * history->rows; ++i) {
+            same = board->cells[i].kind == trace->loop_cells[i].kind
+                   && board->cells[i].value == trace->loop_cells[i].value;
+        }
+        if (same) {
+            board->status = STATUS_LOOPING;
+            board->period = distance;
+            return;
+        }
+    }
+
+    if (trace->loop_cells == NULL || distance >= trace->loop_distance) {
+        if (trace->loop_cells == NULL) {
+            trace->loop_cells = NOB_REALLOC(NULL, history->cells_bytes);
+            NOB_ASSERT(trace->loop_cells != NULL && "Buy more RAM lol");
+        }
+        memcpy(trace->loop_cells, board->cells, history->cells_bytes);
+        trace->loop_hash = board->hash;
+        trace->loop_time = board->time;
+        trace->loop_distance = (trace->loop_distance == 0) ? 1 : trace->loop_distance * 2;
+    }
+}
+
+// Moves the last board into the place of the second one and drops the boards in
+// between, whose cells go back to the arena
+void _td_trace_forget(TD_BoardHistory* history) {
+    size_t last_index = history->count - 1;
+    TD_Board* second = td_board_at(history, 1);
+    TD_Board* last = td_board_at(history, last_index);
+
+    memcpy(second->cells, last->cells, history->cells_bytes);
+    second->result = last->result;
+    second->status = last->status;
+    second->time = last->time;
+    second->hash = last->hash;
+    second->period = last->period;
+    arena_rewind(&history->cells_arena, td_board_at(history, 2)->cells_mark);
+
+    history->forgotten += history->count - 2 + history->jumped;
+    history->jumps.count = 0;
+    history->jumped = 0;
+    history->count = 2;
+    history->tick = 1;
+    history->trace.traced = 2;
+    _td_transpositions_clear(&history->transpositions);
+    _td_transpositions_clear(&history->transitions);
+    history->spliced = false;
+    _td_transpositions_clear(&history->quadtree.leaps);
+    if (history->quadtree.root_index == last_index) {
+        history->quadtree.root_index = 1;
+    } else {
+        history->quadtree.root = 0;
+    }
+    history->activity.recorded_index = (history->activity.recorded_index == last_index) ? 1 : SIZE_MAX;
+    if (history->moved_index != SIZE_MAX) {
+        history->moved_index = 1;
+    }
+}
+
+// Writes the records of the boards added since the last call, and forgets them
+// if the trace allows it. Boards that were not traced yet are not encoded yet.
+void _td_trace_boards(TD_BoardHistory* history) {
+    TD_Trace* trace = &history->trace;
+    if (trace->writer == NULL) {
+        return;
+    }
+
+    size_t cells_count = history->cols * history->rows;
+    for (; trace->traced < history->count; ++trace->traced) {
+        TD_Board* board = td_board_at(history, trace->traced);
+        TD_Board* previous = (trace->traced > 0) ? td_board_at(history, trace->traced - 1) : NULL;
+        TD_Cell* previous_cells = (previous != NULL) ? td_board_cells(previous) : NULL;
+        if (trace->forget) {
+            _td_trace_detect_loop(history, board);
+        }
+
+        trace->changes.count = 0;
+        for (size_t i = 0; i < cells_count; ++i) {
+            TD_Cell old_cell = (previous_cells != NULL) ? previous_cells[i] : (TD_Cell) {
+                0
+            };
+            if (board->cells[i].kind != old_cell.kind || board->cells[i].value != old_cell.value) {
+                nob_da_append(&trace->changes, i);
+            }
+        }
+
+        _td_trace_record(trace->writer, TD_TRACE_TICK, board, trace->changes.count);
+        for (size_t i = 0; i < trace->changes.count; ++i) {
+            size_t index = trace->changes.items[i];
+            TD_Cell old_cell = (previous_cells != NULL) ? previous_cells[index] : (TD_Cell) {
+                0
+            };
+            TD_TraceChange change = {
+                .col = index % history->cols,
+                .row = index / history->cols,
+                .old_kind = old_cell.kind,
+                .old_value = old_cell.value,
+                .new_kind = board->cells[index].kind,
+                .new_value = board->cells[index].value,
+            };
+            _td_trace_append(trace->writer, &change, sizeof(change));
+        }
+
+        if (previous != NULL && board->time <= previous->time) {
+            _td_trace_record(trace->writer, TD_TRACE_WARP, board, previous->time);
+        }
+        if (board->status != ((previous != NULL) ? previous->status : STATUS_RUNNING)) {
+            _td_trace_record(trace->writer, TD_TRACE_STATUS, board, board->period);
+        }
+        trace->records++;
+    }
+
+    if (trace->forget && history->count > 2 && history->tick == history->count - 1) {
+        _td_trace_forget(history);
+    }
+}
+
+// Starts writing the trace of the history to the file at `path`, from the first
+// board on. Programs without time warps on their first board can't warp later,
+// so their boards are forgotten once they are traced unless they are stored
+// sparsely or spilled, and the memory of the history does not grow with the run.
+// Truncating the history while it is traced is not supported.
+bool td_trace_start(TD_BoardHistory* history, const char* path) {
+    TD_Trace* trace = &history->trace;
+    if (history->count != 1 || trace->writer != NULL) {
+        nob_log(NOB_ERROR, "A trace can only be started from the first tick on.");
+        return false;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        nob_log(NOB_ERROR, "Could not open file %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    struct _TD_TraceWriter* writer = NOB_REALLOC(NULL, sizeof(*writer));
+    NOB_ASSERT(writer != NULL && "Buy more RAM lol");
+    *writer = (struct _TD_TraceWriter) {
+        0
+    };
+    writer->file = file;
+    writer->filling = NOB_REALLOC(NULL, TD_TRACE_BUFFER_SIZE);
+    writer->spare = NOB_REALLOC(NULL, TD_TRACE_BUFFER_SIZE);
+    NOB_ASSERT(writer->filling != NULL && writer->spare != NULL && "Buy more RAM lol");
+#ifdef _WIN32
+    InitializeCriticalSection(&writer->lock);
+    InitializeConditionVariable(&writer->changed);
+    writer->thread = CreateThread(NULL, 0, _td_trace_thread, writer, 0, NULL);
+    NOB_ASSERT(writer->thread != NULL && "Could not start the trace thread");
+#else
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    int error = pthread_create(&writer->thread, NULL, _td_trace_thread, writer);
+    NOB_ASSERT(error == 0 && "Could not start the trace thread");
+#endif
+
+    TD_TraceHeader header = {0};
+    memcpy(header.magic, TD_TRACE_MAGIC, 4);
+    header.version = TD_TRACE_VERSION;
+    header.cols = history->cols;
+    header.rows = history->rows;
+    _td_trace_append(writer, &header, sizeof(header));
+
+    trace->writer = writer;
+    trace->traced = 0;
+    trace->records = 0;
+    trace->forget = !history->sparse.enabled && !history->spill.enabled;
+    TD_FOREACH(td_board_at(history, 0), cursor) {
+        if (cursor.cell->kind == CELL_TIMEWARP) {
+            trace->forget = false;
+        }
+    }
+
+    // The boards of the input prefix would be forgotten
+    if (trace->forget) {
+        history->prefix.tracking = false;
+    }
+    return true;
+}
+
+// Writes the records of the boards left and waits for the trace to be written
+bool td_trace_stop(TD_BoardHistory* history) {
+    TD_Trace* trace = &history->trace;
+    struct _TD_TraceWriter* writer = trace->writer;
+    if (writer == NULL) {
+        return true;
+    }
+
+    _td_trace_boards(history);
+    if (writer->filled > 0) {
+        _td_trace_submit(writer);
+    }
+
+    _td_trace_lock(writer);
+    writer->stopping = true;
+    _td_trace_notify(writer);
+    _td_trace_unlock(writer);
+#ifdef _WIN32
+    WaitForSingleObject(writer->thread, INFINITE);
+    CloseHandle(writer->thread);
+    DeleteCriticalSection(&writer->lock);
+#else
+    pthread_join(writer->thread, NULL);
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->changed);
+#endif
+
+    bool result = !writer->failed && fclose(writer->file) == 0;
+    if (!result) {
+        nob_log(NOB_ERROR, "Could not write the trace: %s", strerror(errno));
+    }
+    NOB_FREE(writer->filling);
+    NOB_FREE(writer->spare);
+    NOB_FREE(writer);
+    NOB_FREE(trace->loop_cells);
+    nob_da_free(trace->changes);
+    *trace = (TD_Trace) {
+        0
+    };
+    return result;
+}
+
+bool td_trace_open(TD_TraceReader* reader, const char* path) {
+    *reader = (TD_TraceReader) {
+        0
+    };
+    if (!_td_map_file(path, &reader->data, &reader->size)) {
+        return false;
+    }
+
+    TD_TraceHeader header;
+    if (reader->size < sizeof(header)) {
+        nob_log(NOB_ERROR, "%s: The trace is truncated.", path);
+        td_trace_close(reader);
+        return false;
+    }
+    memcpy(&header, reader->data, sizeof(header));
+    if (memcmp(header.magic, TD_TRACE_MAGIC, 4) != 0 || header.version != TD_TRACE_VERSION) {
+        nob_log(NOB_ERROR, "%s: The file is not a trace of version %d.", path, TD_TRACE_VERSION);
+        td_trace_close(reader);
+        return false;
+    }
+
+    // Changes address the cells by 32-bit columns and rows
+    if (header.cols == 0 || header.rows == 0 || header.cols > UINT32_MAX || header.rows > UINT32_MAX
+            || header.cols * header.rows > SIZE_MAX / sizeof(TD_Cell)) {
+        nob_log(NOB_ERROR, "%s: The trace has a board of %llu x %llu cells.", path,
+                (unsigned long long) header.cols, (unsigned long long) header.rows);
+        td_trace_close(reader);
+        return false;
+    }
+
+    reader->offset = sizeof(header);
+    reader->cols = header.cols;
+    reader->rows = header.rows;
+    reader->cells = NOB_REALLOC(NULL, header.cols * header.rows * sizeof(TD_Cell));
+    if (reader->cells == NULL) {
+        nob_log(NOB_ERROR, "%s: Could not allocate memory for the %llu x %llu cells of the trace.", path,
+                (unsigned long long) header.cols, (unsigned long long) header.rows);
+        td_trace_close(reader);
+        return false;
+    }
+    memset(reader->cells, 0, header.cols * header.rows * sizeof(TD_Cell));
+    return true;
+}
+
+// Reads the next record and applies the changes of a tick to the cells. Returns
+// false at the end of the trace, which may be cut short by a crash.
+bool td_trace_next(TD_TraceReader* reader) {
+    if (reader->size - reader->offset < sizeof(TD_TraceRecord)) {
+        return false;
+    }
+    TD_TraceRecord record;
+    memcpy(&record, reader->data + reader->offset, sizeof(record));
+
+    size_t changes_bytes = 0;
+    if (record.kind == TD_TRACE_TICK) {
+        if (record.value > (reader->size - reader->offset - sizeof(record)) / sizeof(TD_TraceChange)) {
+            return false;
+        }
+        changes_bytes = record.value * sizeof(TD_TraceChange);
+    }
+    reader->record = record;
+    reader->changes = (const TD_TraceChange*) (reader->data + reader->offset + sizeof(record));
+    reader->offset += sizeof(record) + changes_bytes;
+
+    for (size_t i = 0; record.kind == TD_TRACE_TICK && i < record.value; ++i) {
+        TD_TraceChange change = reader->changes[i];
+        if (change.col < reader->cols && change.row < reader->rows) {
+            TD_Cell* cell = &reader->cells[change.row * reader->cols + change.col];
+            cell->kind = change.new_kind;
+            cell->value = change.new_value;
+        }
+    }
+    return true;
+}
+
+void td_trace_close(TD_TraceReader* reader) {
+    _td_unmap_file(reader->data, reader->size);
+    NOB_FREE(reader->cells);
+    *reader = (TD_TraceReader) {
+        0
+    };
+}
+
+// Checkpoints
+
+// Snapshot of the history and the paths it is written to, by the thread
+struct _TD_CheckpointWriter {
+    Nob_String_Builder data;
+    Nob_String_Builder path;
+    Nob_String_Builder temporary_path;
+    bool written;
+
+    // Indices of the boards in the snapshot, from the last one back
+    TD_CellIndices boards;
+
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+// Writes the snapshot next to the checkpoint and moves it into its place once it
+// is complete, so a run killed while writing keeps the checkpoint before
+void _td_checkpoint_write(struct _TD_CheckpointWriter* writer) {
+    writer->written = false;
+    FILE* file = fopen(writer->temporary_path.items, "wb");
+    if (file == NULL) {
+        return;
+    }
+    bool written = fwrite(writer->data.items, 1, writer->data.count, file) == writer->data.count;
+    if (fclose(file) != 0 || !written) {
+        return;
+    }
+#ifdef _WIN32
+    writer->written = MoveFileExA(writer->temporary_path.items, writer->path.items, MOVEFILE_REPLACE_EXISTING);
+#else
+    writer->written = rename(writer->temporary_path.items, writer->path.items) == 0;
+#endif
+}
+
+#ifdef _WIN32
+DWORD WINAPI _td_checkpoint_thread(LPVOID writer) {
+    _td_checkpoint_write(writer);
+    return 0;
+}
+#else
+void* _td_checkpoint_thread(void* writer) {
+    _td_checkpoint_write(writer);
+    return NULL;
+}
+#endif
+
+// Appends the board to the snapshot. Boards before the last one may be stored
+// sparsely, so they are read through td_board_cells.
+void _td_checkpoint_board(TD_BoardHistory* history, Nob_String_Builder* data, TD_Board* board) {
+    TD_CheckpointBoard header = {
+        .time = board->time,
+        .hash = board->hash,
+        .period = board->period,
+        .result = board->result,
+        .status = board->status,
+    };
+    nob_sb_append_buf(data, &header, sizeof(header));
+    nob_sb_append_buf(data, td_board_cells(board), history->cells_bytes);
+}
+
+// Saves the state the run continues from to a checkpoint at `path`: the last
+// board, and for every time before it the last board with that time, which is
+// the one a time warp to it goes back to. Programs without time warps only need
+// their last board. The boards are copied into a snapshot that is written on a
+// background thread while the run goes on, and td_finish_checkpoint waits for
+// it. The caches of the engine refer to boards that are not saved, and are built
+// again after resuming. Returns false if the checkpoint before could not be
+// written.
+bool td_save_checkpoint(TD_BoardHistory* history, const char* path) {
+    bool result = td_finish_checkpoint(history);
+
+    struct _TD_CheckpointWriter* writer = NOB_REALLOC(NULL, sizeof(*writer));
+    NOB_ASSERT(writer != NULL && "Buy more RAM lol");
+    *writer = (struct _TD_CheckpointWriter) {
+        0
+    };
+
+    bool timewarps = false;
+    TD_FOREACH(td_board_at(history, 0), cursor) {
+        timewarps = timewarps || cursor.cell->kind == CELL_TIMEWARP;
+    }
+
+    // Times only go up by one or back, so going back from the last board, every
+    // time between the lowest one seen so far and the last one is taken by a
+    // later board. The boards below it are the last ones with their time.
+    writer->boards.count = 0;
+    size_t last_index = history->count - 1;
+    size_t lowest_time = td_board_at(history, last_index)->time;
+    for (size_t i = last_index; i > 0; --i) {
+        TD_Board* board = td_board_at(history, i);
+        if (i == last_index || (timewarps && board->time < lowest_time)) {
+            nob_da_append(&writer->boards, i);
+            lowest_time = board->time;
+        }
+    }
+
+    // The first board on which an operator was moved may not be saved, so the
+    // next board saved takes its place
+    size_t moved_index = SIZE_MAX;
+    for (size_t i = writer->boards.count; history->moved_index != SIZE_MAX && i > 0; --i) {
+        if (writer->boards.items[i - 1] >= history->moved_index) {
+            moved_index = writer->boards.count - i + 1;
+            break;
+        }
+    }
+
+    TD_CheckpointHeader header = {0};
+    memcpy(header.magic, TD_CHECKPOINT_MAGIC, 4);
+    header.version = TD_CHECKPOINT_VERSION;
+    header.cell_size = sizeof(TD_Cell);
+    header.pruned = history->pruning.enabled;
+    header.program_hash = td_program_hash(history);
+    header.cols = history->cols;
+    header.rows = history->rows;
+    header.input_a = history->input_a;
+    header.input_b = history->input_b;
+    header.boards_count = writer->boards.count;
+    header.forgotten = td_ticks(history, history->count - 1) - 1 - writer->boards.count;
+    header.moved_index = moved_index;
+    header.engine = history->activity.engine;
+    for (size_t i = 0; i < TD_ENGINE_COUNT; ++i) {
+        header.engine_ticks[i] = history->activity.ticks[i];
+    }
+
+    writer->data.count = 0;
+    nob_sb_append_buf(&writer->data, &header, sizeof(header));
+    for (size_t i = writer->boards.count; i > 0; --i) {
+        _td_checkpoint_board(history, &writer->data, td_board_at(history, writer->boards.items[i - 1]));
+    }
+
+    writer->path.count = 0;
+    nob_sb_append_cstr(&writer->path, path);
+    nob_sb_append_null(&writer->path);
+    writer->temporary_path.count = 0;
+    nob_sb_append_cstr(&writer->temporary_path, path);
+    nob_sb_append_cstr(&writer->temporary_path, ".tmp");
+    nob_sb_append_null(&writer->temporary_path);
+
+    history->checkpoint = writer;
+#ifdef _WIN32
+    writer->thread = CreateThread(NULL, 0, _td_checkpoint_thread, writer, 0, NULL);
+    NOB_ASSERT(writer->thread != NULL && "Could not start the checkpoint thread");
+#else
+    int error = pthread_create(&writer->thread, NULL, _td_checkpoint_thread, writer);
+    NOB_ASSERT(error == 0 && "Could not start the checkpoint thread");
+#endif
+    return result;
+}
+
+// Waits until the checkpoint being written is complete. Returns false if it
+// could not be written.
+bool td_finish_checkpoint(TD_BoardHistory* history) {
+    struct _TD_CheckpointWriter* writer = history->checkpoint;
+    if (writer == NULL) {
+        return true;
+    }
+
+#ifdef _WIN32
+    WaitForSingleObject(writer->thread, INFINITE);
+    CloseHandle(writer->thread);
+#else
+    pthread_join(writer->thread, NULL);
+#endif
+    bool result = writer->written;
+    if (!result) {
+        nob_log(NOB_ERROR, "Could not write the checkpoint %s.", writer->path.items);
+    }
+    nob_sb_free(writer->data);
+    nob_sb_free(writer->path);
+    nob_sb_free(writer->temporary_path);
+    nob_da_free(writer->boards);
+    NOB_FREE(writer);
+    history->checkpoint = NULL;
+    return result;
+}
+
+bool _td_check_checkpoint(TD_BoardHistory* history, const char* data, size_t size, const char* path) {
+    TD_CheckpointHeader header;
+    if (size < sizeof(header)) {
+        nob_log(NOB_ERROR, "%s: The checkpoint is truncated.", path);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, TD_CHECKPOINT_MAGIC, 4) != 0 || header.version != TD_CHECKPOINT_VERSION
+            || header.cell_size != sizeof(TD_Cell)) {
+        nob_log(NOB_ERROR, "%s: The file is not a checkpoint of version %d of this build.", path, TD_CHECKPOINT_VERSION);
+        return false;
+    }
+    if (header.program_hash != td_program_hash(history) || header.cols != history->cols || header.rows != history->rows
+            || header.input_a != history->input_a || header.input_b != history->input_b) {
+        nob_log(NOB_ERROR, "%s: The checkpoint was saved from another program or with other inputs.", path);
+        return false;
+    }
+    if ((bool) header.pruned != history->pruning.enabled) {
+        nob_log(NOB_ERROR, "%s: The checkpoint was saved from a program that was %s.", path,
+                header.pruned ? "pruned" : "not pruned");
+        return false;
+    }
+
+    size_t board_bytes = sizeof(TD_CheckpointBoard) + history->cells_bytes;
+    if (header.boards_count > (size - sizeof(header)) / board_bytes
+            || size != sizeof(header) + header.boards_count * board_bytes) {
+        nob_log(NOB_ERROR, "%s: The checkpoint is truncated.", path);
+        return false;
+    }
+
+    // The saved hashes cover the kinds and values of the cells, so most changes
+    // to a board are caught before the run continues from it
+    size_t cells_count = history->cols * history->rows;
+    for (size_t i = 0; i < header.boards_count; ++i) {
+        const char* saved = data + sizeof(header) + i * board_bytes;
+        TD_CheckpointBoard saved_board;
+        memcpy(&saved_board, saved, sizeof(saved_board));
+
+        bool valid = saved_board.status <= STATUS_LOOPING;
+        uint64_t hash = 0;
+        for (size_t j = 0; valid && j < cells_count; ++j) {
+            TD_Cell cell;
+            memcpy(&cell, saved + sizeof(saved_board) + j * sizeof(TD_Cell), sizeof(cell));
+            valid = (uint32_t) cell.kind <= CELL_STOP && (uint32_t) cell.input_kind <= CELL_INPUT_B;
+            hash ^= _td_cell_hash(j, cell);
+        }
+        if (!valid || hash != saved_board.hash) {
+            nob_log(NOB_ERROR, "%s: Board %zu of the checkpoint is corrupted.", path, i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Continues the run saved in the checkpoint at `path`. The history has to hold
+// just the first board of the same program with the same inputs, as loaded by
+// td_read, and has to be pruned if the run was. The boards of the checkpoint are
+// stored like the ones computed from here on.
+bool td_load_checkpoint(TD_BoardHistory* history, const char* path) {
+    if (history->count != 1) {
+        nob_log(NOB_ERROR, "A checkpoint can only be loaded into a history that was not run yet.");
+        return false;
+    }
+
+    char* data;
+    size_t size;
+    if (!_td_map_file(path, &data, &size)) {
+        return false;
+    }
+    if (!_td_check_checkpoint(history, data, size, path)) {
+        _td_unmap_file(data, size);
+        return false;
+    }
+
+    TD_CheckpointHeader header;
+    memcpy(&header, data, sizeof(header));
+    size_t board_bytes = sizeof(TD_CheckpointBoard) + history->cells_bytes;
+    _td_reserve_boards(history, 1 + header.boards_count);
+    for (size_t i = 0; i < header.boards_count; ++i) {
+        const char* saved = data + sizeof(header) + i * board_bytes;
+        TD_CheckpointBoard saved_board;
+        memcpy(&saved_board, saved, sizeof(saved_board));
+
+        TD_Board board = {0};
+        board.history = history;
+        board.time = saved_board.time;
+        board.hash = saved_board.hash;
+        board.period = saved_board.period;
+        board.result = (int) saved_board.result;
+        board.status = (TD_Status) saved_board.status;
+        _td_alloc_cells(history, &board);
+        memcpy(board.cells, saved + sizeof(saved_board), history->cells_bytes);
+        _td_append_board(history, board);
+    }
+    _td_unmap_file(data, size);
+
+    history->tick = history->count - 1;
+    history->forgotten = header.forgotten;
+    history->moved_index = (header.moved_index < history->count) ? header.moved_index : SIZE_MAX;
+    history->activity.engine = (header.engine < TD_ENGINE_COUNT) ? header.engine : TD_ENGINE_DENSE;
+    for (size_t i = 0; i < TD_ENGINE_COUNT; ++i) {
+        history->activity.ticks[i] = header.engine_ticks[i];
+    }
+
+    // The boards of the input prefix were not saved
+    history->prefix.tracking = false;
+    return true;
+}
+
+// Engine selection
+
+// Ticks over which the writes are sampled before the engine is chosen again
+#define TD_ACTIVITY_WINDOW 32
+
+// Cost of looking at the cells around a write and evaluating the operators
+// there, relative to evaluating an operator in a dense tick
+#define TD_WORKLIST_COST 16
+
+// An operator only fires if it did in the tick before or if one of the cells it
+// reads was written, and an operator that fired wrote to one of the cells it
+// reads. So only the operators at and next to written cells have to be
+// evaluated, in the order of their cells like in a dense tick.
+void _td_evaluate_worklist(TD_BoardHistory* history, TD_Board* current_board, TD_Board* next_board) {
+    TD_Activity* activity = &history->activity;
+    size_t cells_count = history->cols * history->rows;
+    if (activity->stamps == NULL) {
+        activity->stamps = NOB_REALLOC(NULL, cells_count * sizeof(size_t));
+        NOB_ASSERT(activity->stamps != NULL && "Buy more RAM lol");
+        memset(activity->stamps, 0, cells_count * sizeof(size_t));
+    }
+    activity->stamp++;
+
+    activity->candidates.count = 0;
+    for (size_t i = 0; i < activity->written.count; ++i) {
+        size_t written = activity->written.items[i];
+        for (int direction = -1; direction < 4; ++direction) {
+            size_t index = (direction < 0) ? written : _td_prune_neighbour(history, written, direction);
+            if (index == SIZE_MAX || activity->stamps[index] == activity->stamp) {
+                continue;
+            }
+            activity->stamps[index] = activity->stamp;
+
+            TD_CellKind kind = current_board->cells[index].kind;
+            if (kind >= CELL_MOVE_LEFT && kind <= CELL_CMP_NOTEQUAL && _td_is_relevant(history, index)) {
+                nob_da_append(&activity->candidates, index);
+            }
+        }
+    }
+    qsort(activity->candidates.items, activity->candidates.count, sizeof(size_t), _td_compare_indices);
+
+    TD_BoardCursor first_cursor = td_cursor_first(current_board);
+    for (size_t i = 0; i < activity->candidates.count; ++i) {
+        size_t index = activity->candidates.items[i];
+        _td_evaluate_cell(td_cursor_move(first_cursor, index % history->cols, index / history->cols), next_board);
+    }
+}
+
+// Chooses the engine for the next window of ticks by comparing the cost of a
+// dense tick with the cost of the writes of an average tick
+void _td_sample_activity(TD_BoardHistory* history) {
+    TD_Activity* activity = &history->activity;
+    activity->sampled_ticks++;
+    activity->sampled_writes += activity->written.count;
+    if (activity->sampled_ticks < TD_ACTIVITY_WINDOW) {
+        return;
+    }
+
+    if (!history->superinstructions.built) {
+        _td_build_superinstructions(history);
+    }
+    size_t dense_cost = activity->sampled_ticks * history->superinstructions.operators;
+    activity->engine = (activity->sampled_writes * TD_WORKLIST_COST < dense_cost) ? TD_ENGINE_WORKLIST : TD_ENGINE_DENSE;
+    activity->sampled_ticks = 0;
+    activity->sampled_writes = 0;
+}
+
+// Evaluates a plain tick from the board at `index` with the chosen engine and
+// records the cells it writes. The worklist needs the writes of the tick that
+// computed the board at `index`. Returns true if an operator is known to have
+// fired.
+bool _td_step(TD_BoardHistory* history, size_t index, TD_Board* current_board, TD_Board* next_board) {
+    TD_Activity* activity = &history->activity;
+    bool worklist = activity->engine == TD_ENGINE_WORKLIST && activity->recorded_index == index;
+
+    activity->next_written.count = 0;
+    activity->recording = true;
+    bool fired = false;
+    if (_td_is_compiled(history)) {
+        // The operator that fired last stays active, so a cell is active
+        // exactly if an operator fired
+        fired = history->compiled->tick(current_board, next_board);
+    } else if (worklist) {
+        _td_evaluate_worklist(history, current_board, next_board);
+    } else {
+        _td_evaluate_board(history, current_board, next_board);
+    }
+    activity->recording = false;
+
+    TD_CellIndices written = activity->written;
+    activity->written = activity->next_written;
+    activity->next_written = written;
+    activity->recorded_index = index + 1;
+
+    activity->ticks[worklist ? TD_ENGINE_WORKLIST : TD_ENGINE_DENSE]++;
+    _td_sample_activity(history);
+    return fired;
+}
+
+// Hash of the first board that does not depend on the inputs
+uint64_t td_program_hash(TD_BoardHistory* history) {
+    TD_Cell* cells = td_board_at(history, 0)->cells;
+    uint64_t hash = _td_mix_hash(history->cols * 31 + history->rows);
+    for (size_t i = 0; i < history->cols * history->rows; ++i) {
+        TD_Cell cell = cells[i];
+        if (cell.input_kind != CELL_INPUT_NONE) {
+            cell.value = 0;
+        }
+        hash = _td_mix_hash(hash ^ _td_cell_hash(i, cell) ^ cell.input_kind);
+    }
+    return hash;
+}
+
+// Profiles are text files with one line per program, holding its hash and the
+// engine that ran most of its plain ticks the last time. Starts the program
+// with the engine from the profile at `path` if it has one for it.
+bool td_load_profile(TD_BoardHistory* history, const char* path) {
+    if (nob_file_exists(path) != 1) {
+        return false;
+    }
+
+    Nob_String_Builder sb = {0};
+    if (!nob_read_entire_file(path, &sb)) {
+        return false;
+    }
+
+    bool found = false;
+    Nob_String_View hash = nob_sv_from_cstr(nob_temp_sprintf("%016llx", (unsigned long long) td_program_hash(history)));
+    Nob_String_View content = nob_sv_from_parts(sb.items, sb.count);
+    while (content.count > 0 && !found) {
+        Nob_String_View line = nob_sv_trim(nob_sv_chop_by_delim(&content, '\n'));
+        if (!nob_sv_eq(nob_sv_chop_by_delim(&line, ' '), hash)) {
+            continue;
+        }
+        for (TD_Engine engine = 0; engine < TD_ENGINE_COUNT; ++engine) {
+            if (nob_sv_eq(nob_sv_trim(line), nob_sv_from_cstr(td_engine_name(engine)))) {
+                history->activity.engine = engine;
+                found = true;
             }
-            case CELL_CMP_EQUAL: {
-                if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
-                    if (op_left->value == op_right->value) {
-                        _td_move_right(next_cursor, op_left);
-                        _td_move_down(next_cursor, op_right);
+        }
+    }
+
+    nob_sb_free(sb);
+    return found;
+}
+
+// Records the engine that ran most plain ticks of the program in the profile at
+// `path`, replacing an earlier entry for the same program
+bool td_save_profile(TD_BoardHistory* history, const char* path) {
+    TD_Activity* activity = &history->activity;
+    TD_Engine best = TD_ENGINE_DENSE;
+    for (TD_Engine engine = 0; engine < TD_ENGINE_COUNT; ++engine) {
+        if (activity->ticks[engine] > activity->ticks[best]) {
+            best = engine;
+        }
+    }
+    if (activity->ticks[best] == 0) {
+        return true;
+    }
+
+    Nob_String_Builder old = {0};
+    if (nob_file_exists(path) == 1 && !nob_read_entire_file(path, &old)) {
+        return false;
+    }
+
+    const char* hash = nob_temp_sprintf("%016llx", (unsigned long long) td_program_hash(history));
+    Nob_String_Builder sb = {0};
+    Nob_String_View content = nob_sv_from_parts(old.items, old.count);
+    while (content.count > 0) {
+        Nob_String_View line = nob_sv_trim(nob_sv_chop_by_delim(&content, '\n'));
+        Nob_String_View rest = line;
+        if (line.count > 0 && !nob_sv_eq(nob_sv_chop_by_delim(&rest, ' '), nob_sv_from_cstr(hash))) {
+            nob_sb_append_sv(&sb, line);
+            nob_sb_append_cstr(&sb, "\n");
+        }
+    }
+    nob_sb_append_cstr(&sb, nob_temp_sprintf("%s %s\n", hash, td_engine_name(best)));
+
+    bool result = nob_write_entire_file(path, sb.items, sb.count);
+    nob_sb_free(old);
+    nob_sb_free(sb);
+    return result;
+}
+
+void _td_forward(TD_BoardHistory* history) {
+    TD_Board* current_board = td_current_board(history);
+    if (current_board->status != STATUS_RUNNING) {
+        return;
+    }
+    history->tick++;
+    if (history->tick < history->count) {
+        _td_page_in(history, history->tick);
+    }
+
+    if (history->tick == history->count) {
+        _td_trace_boards(history);
+        _td_pack_boards(history);
+        _td_spill_boards(history);
+        size_t current_index = history->count - 1;
+        size_t source = _td_find_transition(history, current_index);
+        if (source != SIZE_MAX) {
+            _td_copy_board(history, source + 1, current_board->time + 1);
+            history->spliced = true;
+            history->splice_source = source + 1;
+            history->diverged = false;
+            _td_detect_loop(history, history->count - 1);
+            return;
+        }
+        history->spliced = false;
+
+        if (history->timewarps) {
+            da_clear(history->timewarps);
+        }
+        _td_collect_timewarps(current_board, &history->timewarps);
+
+        TD_Timewarps timewarps = history->timewarps;
+        if (da_size(timewarps) > 0) {
+            int result_dt = 0;
+            for (size_t i = 0; i < da_size(timewarps); ++i) {
+                TD_Timewarp tw = timewarps[i];
+                if (tw.dt < 1 || (result_dt > 0 && tw.dt != result_dt)) {
+                    _td_crash(history);
+                    return;
+                } else if (result_dt == 0) {
+                    result_dt = tw.dt;
+                }
+
+                for (size_t j = i + 1; j < da_size(timewarps); ++j) {
+                    TD_Timewarp two = timewarps[j];
+                    if (td_cursor_same(tw.cell_cursor, two.cell_cursor) && tw.value != two.value) {
+                        _td_crash(history);
+                        return;
                     }
                 }
-                break;
             }
-            case CELL_CMP_NOTEQUAL: {
-                if (_td_retrieve_operands(current_cursor, &op_left, &op_right)) {
-                    if (op_left->value != op_right->value) {
-                        _td_move_right(next_cursor, op_left);
-                        _td_move_down(next_cursor, op_right);
-                    }
+
+            size_t tw_time = current_board->time - result_dt;
+            int tw_index;
+            for (tw_index = history->count - 1; tw_index >= 0; --tw_index) {
+                if (td_board_at(history, tw_index)->time == tw_time) {
+                    break;
                 }
-                break;
             }
-            case CELL_TIMEWARP:
-            case CELL_EMPTY:
-            case CELL_NUMBER:
-            case CELL_STOP:
-                break;
 
-            default:
-                printf("Don't know what to do with cell of kind `%s`.\n", td_cell_kind_name(current_cursor.cell->kind));
-            }
+            if (tw_index < 0) {
+                _td_crash(history);
+                return;
+            }
+
+            TD_Board* next_board = _td_clone_board(history, tw_index, tw_time);
+            for (size_t i = 0; i < da_size(timewarps); ++i) {
+                TD_Timewarp tw = timewarps[i];
+                _td_set_cell(td_cursor_board(tw.cell_cursor, next_board), _td_make_number_cell(tw.value));
+                _td_activate_cell(td_cursor_board(tw.timewarp_cursor, next_board));
+                _td_activate_cell(td_cursor_board(tw.cell_cursor, next_board));
+            }
+
+            _td_diverge(history, tw_index, timewarps);
+            _td_add_warp_landing(history, history->count - 1, tw_time);
+            _td_detect_loop(history, history->count - 1);
+            return;
+        }
+
+        TD_Board* next_board;
+        bool changed = false;
+        if (_td_can_forward_diverged(history)) {
+            next_board = _td_forward_diverged(history);
+        } else {
+            history->diverged = false;
+            next_board = _td_clone_board(history, history->count - 1, current_board->time + 1);
+            changed = _td_step(history, current_index, current_board, next_board);
+        }
+
+        for (size_t i = 0; !changed && i < history->cols * history->rows; ++i) {
+            changed = next_board->cells[i].active;
+        }
+
+        if (!changed && next_board->status == STATUS_RUNNING) {
+            next_board->status = STATUS_STALLED;
+        }
+
+        _td_transpositions_put(&history->transitions, current_board->hash, current_index);
+        _td_detect_loop(history, history->count - 1);
+        _td_extend_prefix(history, current_index);
+    }
+}
+
+void td_forward(TD_BoardHistory* history) {
+    _td_forward(history);
+    _td_trace_boards(history);
+}
+
+// Affine loops
+
+TD_AffineCell* _td_affine_board(TD_BoardHistory* history, size_t step) {
+    return &history->affine.cells[step * history->cols * history->rows];
+}
+
+TD_AffineCell* _td_affine_cell(TD_BoardHistory* history, TD_AffineCell* cells, int col, int row) {
+    static TD_AffineCell empty_cell = {0};
+    if (col < 0 || row < 0 || col >= (int) history->cols || row >= (int) history->rows) {
+        return &empty_cell;
+    }
+    return &cells[row * history->cols + col];
+}
+
+void _td_affine_limit(TD_AffineLoops* affine, int64_t repetitions) {
+    if (repetitions < affine->limit) {
+        affine->limit = repetitions;
+    }
+}
+
+// Values must stay within the range of an int in every repetition, otherwise the
+// engine would see them wrap around
+void _td_affine_track(TD_AffineLoops* affine, TD_AffineCell cell) {
+    if (cell.value < INT_MIN || cell.value > INT_MAX || cell.delta < -INT_MAX || cell.delta > INT_MAX) {
+        affine->limit = 0;
+    } else if (cell.delta > 0) {
+        _td_affine_limit(affine, (INT_MAX - cell.value) / cell.delta + 1);
+    } else if (cell.delta < 0) {
+        _td_affine_limit(affine, (cell.value - INT_MIN) / -cell.delta + 1);
+    }
+}
+
+// Compares two values as they are in the first repetition, and limits the loop
+// to the repetitions before the outcome changes
+bool _td_affine_equal(TD_AffineLoops* affine, TD_AffineCell first, TD_AffineCell second) {
+    bool equal = first.value == second.value;
+    if (first.delta != second.delta) {
+        if (equal) {
+            _td_affine_limit(affine, 1);
+        } else {
+            int64_t distance = second.value - first.value;
+            int64_t speed = first.delta - second.delta;
+            if (distance % speed == 0 && distance / speed > 0) {
+                _td_affine_limit(affine, distance / speed);
+            }
+        }
+    }
+    return equal;
+}
+
+TD_AffineCell _td_affine_calculate_value(TD_AffineLoops* affine, TD_CellKind kind, TD_AffineCell left, TD_AffineCell right) {
+    TD_AffineCell result = {
+        .kind = CELL_NUMBER,
+    };
+
+    switch (kind) {
+    case CELL_CALC_ADD:
+        result.value = left.value + right.value;
+        result.delta = left.delta + right.delta;
+        break;
+    case CELL_CALC_SUBTRACT:
+        result.value = left.value - right.value;
+        result.delta = left.delta - right.delta;
+        break;
+    case CELL_CALC_MULTIPLY:
+        // Only products with a constant stay affine
+        if (left.delta != 0 && right.delta != 0) {
+            affine->limit = 0;
+        }
+        result.value = left.value * right.value;
+        result.delta = left.delta * right.value + right.delta * left.value;
+        break;
+    case CELL_CALC_DIVIDE:
+    case CELL_CALC_REMAINDER:
+        if (left.delta != 0 || right.delta != 0 || right.value == 0 || (left.value == INT_MIN && right.value == -1)) {
+            affine->limit = 0;
+            break;
+        }
+        result.value = (kind == CELL_CALC_DIVIDE) ? (int) left.value / (int) right.value : (int) left.value % (int) right.value;
+        break;
+    default:
+        DW_UNIMPLEMENTED_MSG("Cannot calculate with cell of kind `%s`.", td_cell_kind_name(kind));
+    }
+
+    _td_affine_track(affine, result);
+    return result;
+}
+
+void _td_affine_set_cell(TD_BoardHistory* history, TD_AffineCell* cells, int col, int row, TD_AffineCell value) {
+    if (col < 0 || row < 0 || col >= (int) history->cols || row >= (int) history->rows) {
+        return;
+    }
+
+    TD_AffineCell* cell = &cells[row * history->cols + col];
+    if (cell->kind == CELL_STOP) {
+        history->affine.limit = 0;
+    }
+    *cell = value;
+}
+
+void _td_affine_activate_cell(TD_BoardHistory* history, TD_AffineCell* cells, int col, int row) {
+    if (col >= 0 && row >= 0 && col < (int) history->cols && row < (int) history->rows) {
+        cells[row * history->cols + col].active = true;
+    }
+}
+
+void _td_affine_move(TD_BoardHistory* history, TD_AffineCell* next, int col, int row, int dx, int dy, TD_AffineCell operand) {
+    _td_affine_set_cell(history, next, col - dx, row - dy, (TD_AffineCell) {
+        0
+    });
+    _td_affine_set_cell(history, next, col + dx, row + dy, operand);
+    _td_affine_activate_cell(history, next, col, row);
+    _td_affine_activate_cell(history, next, col + dx, row + dy);
+}
+
+// Mirrors _td_evaluate_cell on affine cells
+void _td_affine_evaluate_cell(TD_BoardHistory* history, TD_AffineCell* current, TD_AffineCell* next, int col, int row) {
+    TD_AffineCell* cell = _td_affine_cell(history, current, col, row);
+    TD_AffineCell left = *_td_affine_cell(history, current, col - 1, row);
+    TD_AffineCell right = *_td_affine_cell(history, current, col + 1, row);
+    TD_AffineCell up = *_td_affine_cell(history, current, col, row - 1);
+    TD_AffineCell down = *_td_affine_cell(history, current, col, row + 1);
+
+    switch (cell->kind) {
+    case CELL_CALC_ADD:
+    case CELL_CALC_SUBTRACT:
+    case CELL_CALC_MULTIPLY:
+    case CELL_CALC_DIVIDE:
+    case CELL_CALC_REMAINDER: {
+        if (left.kind == CELL_NUMBER && up.kind == CELL_NUMBER) {
+            TD_AffineCell value = _td_affine_calculate_value(&history->affine, cell->kind, left, up);
+            _td_affine_set_cell(history, next, col - 1, row, (TD_AffineCell) {
+                0
+            });
+            _td_affine_set_cell(history, next, col, row - 1, (TD_AffineCell) {
+                0
+            });
+            _td_affine_set_cell(history, next, col + 1, row, value);
+            _td_affine_set_cell(history, next, col, row + 1, value);
+            _td_affine_activate_cell(history, next, col, row);
+            _td_affine_activate_cell(history, next, col + 1, row);
+            _td_affine_activate_cell(history, next, col, row + 1);
+        }
+        break;
+    }
+    case CELL_MOVE_LEFT: {
+        if (right.kind != CELL_EMPTY) {
+            _td_affine_move(history, next, col, row, -1, 0, right);
+        }
+        break;
+    }
+    case CELL_MOVE_RIGHT: {
+        if (left.kind != CELL_EMPTY) {
+            _td_affine_move(history, next, col, row, 1, 0, left);
+        }
+        break;
+    }
+    case CELL_MOVE_UP: {
+        if (down.kind != CELL_EMPTY) {
+            _td_affine_move(history, next, col, row, 0, -1, down);
+        }
+        break;
+    }
+    case CELL_MOVE_DOWN: {
+        if (up.kind != CELL_EMPTY) {
+            _td_affine_move(history, next, col, row, 0, 1, up);
+        }
+        break;
+    }
+    case CELL_CMP_EQUAL:
+    case CELL_CMP_NOTEQUAL: {
+        if (left.kind == CELL_NUMBER && up.kind == CELL_NUMBER) {
+            bool equal = _td_affine_equal(&history->affine, left, up);
+            if (equal == (cell->kind == CELL_CMP_EQUAL)) {
+                _td_affine_move(history, next, col, row, 1, 0, left);
+                _td_affine_move(history, next, col, row, 0, 1, up);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Mirrors a new tick of td_forward on the scratch boards of the loop. Returns
+// false if the tick ends the loop or does not repeat the same way in every
+// repetition: warps with changing offsets, warps to boards before the period,
+// crashes, stops and stalls.
+bool _td_affine_step(TD_BoardHistory* history, size_t step) {
+    TD_AffineLoops* affine = &history->affine;
+    size_t cells_count = history->cols * history->rows;
+    TD_AffineCell* current = _td_affine_board(history, step - 1);
+    TD_AffineCell* next = _td_affine_board(history, step);
+
+    affine->warps.count = 0;
+    int result_dt = 0;
+    for (size_t i = 0; i < cells_count; ++i) {
+        int col = i % history->cols;
+        int row = i / history->cols;
+        if (current[i].kind != CELL_TIMEWARP) {
+            continue;
+        }
+
+        TD_AffineCell* op_dx = _td_affine_cell(history, current, col - 1, row);
+        TD_AffineCell* op_dy = _td_affine_cell(history, current, col + 1, row);
+        TD_AffineCell* op_v = _td_affine_cell(history, current, col, row - 1);
+        TD_AffineCell* op_dt = _td_affine_cell(history, current, col, row + 1);
+        if (op_v->kind != CELL_NUMBER || op_dx->kind != CELL_NUMBER
+                || op_dy->kind != CELL_NUMBER || op_dt->kind != CELL_NUMBER) {
+            continue;
+        }
+
+        if (op_dx->delta != 0 || op_dy->delta != 0 || op_dt->delta != 0
+                || op_dt->value < 1 || (result_dt > 0 && op_dt->value != result_dt)) {
+            return false;
+        }
+        result_dt = op_dt->value;
+        nob_da_append(&affine->warps, i);
+    }
+
+    if (affine->warps.count > 0) {
+        size_t time = affine->times[step - 1];
+        if ((size_t) result_dt >= time) {
+            return false;
+        }
+
+        size_t source = step;
+        while (source > 0 && affine->times[source - 1] != time - result_dt) {
+            source--;
+        }
+        if (source == 0) {
+            return false;
+        }
+
+        memcpy(next, _td_affine_board(history, source - 1), cells_count * sizeof(TD_AffineCell));
+        for (size_t i = 0; i < cells_count; ++i) {
+            next[i].active = false;
+        }
+
+        for (size_t i = 0; i < affine->warps.count; ++i) {
+            int col = affine->warps.items[i] % history->cols;
+            int row = affine->warps.items[i] / history->cols;
+            int target_col = col - (int) _td_affine_cell(history, current, col - 1, row)->value;
+            int target_row = row - (int) _td_affine_cell(history, current, col + 1, row)->value;
+            TD_AffineCell value = *_td_affine_cell(history, current, col, row - 1);
+
+            for (size_t j = i + 1; j < affine->warps.count; ++j) {
+                int other_col = affine->warps.items[j] % history->cols;
+                int other_row = affine->warps.items[j] / history->cols;
+                if (other_col - _td_affine_cell(history, current, other_col - 1, other_row)->value == target_col
+                        && other_row - _td_affine_cell(history, current, other_col + 1, other_row)->value == target_row
+                        && !_td_affine_equal(affine, value, *_td_affine_cell(history, current, other_col, other_row - 1))) {
+                    return false;
+                }
+            }
+
+            value.active = false;
+            _td_affine_set_cell(history, next, target_col, target_row, value);
+            _td_affine_activate_cell(history, next, col, row);
+            _td_affine_activate_cell(history, next, target_col, target_row);
+        }
+
+        affine->times[step] = time - result_dt;
+        affine->landed[step] = true;
+        return affine->limit > 0;
+    }
+
+    memcpy(next, current, cells_count * sizeof(TD_AffineCell));
+    for (size_t i = 0; i < cells_count; ++i) {
+        next[i].active = false;
+    }
+    for (size_t i = 0; i < cells_count; ++i) {
+        if (_td_is_relevant(history, i)) {
+            _td_affine_evaluate_cell(history, current, next, i % history->cols, i / history->cols);
+        }
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < cells_count && !changed; ++i) {
+        changed = next[i].active;
+    }
+
+    affine->times[step] = affine->times[step - 1] + 1;
+    affine->landed[step] = false;
+    return changed && affine->limit > 0;
+}
+
+// Runs one period of `period` ticks from the last board on the scratch boards,
+// with the values of every repetition changing by their difference to the board
+// one period earlier. Returns the number of repetitions that behave the same,
+// or 0 if the period does not repeat.
+int64_t _td_affine_run_period(TD_BoardHistory* history, size_t period) {
+    TD_AffineLoops* affine = &history->affine;
+    size_t cells_count = history->cols * history->rows;
+    TD_Board* board = td_board_at(history, history->count - 1);
+    TD_Cell* earlier_cells = td_board_cells(td_board_at(history, history->count - 1 - period));
+
+    if ((period + 1) * cells_count > affine->cells_capacity) {
+        affine->cells_capacity = (period + 1) * cells_count;
+        affine->cells = NOB_REALLOC(affine->cells, affine->cells_capacity * sizeof(TD_AffineCell));
+        NOB_ASSERT(affine->cells != NULL && "Buy more RAM lol");
+    }
+    if (period + 1 > affine->boards_capacity) {
+        affine->boards_capacity = period + 1;
+        affine->times = NOB_REALLOC(affine->times, affine->boards_capacity * sizeof(size_t));
+        affine->landed = NOB_REALLOC(affine->landed, affine->boards_capacity * sizeof(bool));
+        NOB_ASSERT(affine->times != NULL && affine->landed != NULL && "Buy more RAM lol");
+    }
+
+    TD_AffineCell* first = _td_affine_board(history, 0);
+    bool counting = false;
+    for (size_t i = 0; i < cells_count; ++i) {
+        if (board->cells[i].kind != earlier_cells[i].kind) {
+            return 0;
+        }
+        first[i] = (TD_AffineCell) {
+            .kind = board->cells[i].kind,
+            .active = board->cells[i].active,
+            .value = board->cells[i].value,
+            .delta = (int64_t) board->cells[i].value - earlier_cells[i].value,
+        };
+        counting = counting || first[i].delta != 0;
+    }
+    if (!counting) {
+        return 0;
+    }
+
+    affine->limit = INT64_MAX;
+    affine->times[0] = board->time;
+    affine->landed[0] = true;
+    for (size_t i = 0; i < cells_count; ++i) {
+        _td_affine_track(affine, first[i]);
+    }
+
+    for (size_t step = 1; step <= period; ++step) {
+        if (!_td_affine_step(history, step)) {
+            return 0;
+        }
+
+        // A board that is the same in every repetition is a plain loop
+        TD_AffineCell* cells = _td_affine_board(history, step);
+        counting = false;
+        for (size_t i = 0; i < cells_count && !counting; ++i) {
+            counting = cells[i].delta != 0;
+        }
+        if (!counting) {
+            return 0;
+        }
+    }
+
+    // The period has to end in the first board of the next repetition
+    TD_AffineCell* last = _td_affine_board(history, period);
+    if (affine->times[period] != affine->times[0]) {
+        return 0;
+    }
+    for (size_t i = 0; i < cells_count; ++i) {
+        if (last[i].kind != first[i].kind || last[i].delta != first[i].delta
+                || last[i].value != first[i].value + first[i].delta) {
+            return 0;
+        }
+    }
+    return affine->limit;
+}
+
+// Appends the boards of the last repetition that behaves the same as the period
+// on the scratch boards, and records the ticks of the ones before it
+void _td_affine_skip(TD_BoardHistory* history, size_t period, int64_t repetitions) {
+    size_t cells_count = history->cols * history->rows;
+    int64_t k = repetitions - 1;
+
+    TD_TickJump jump = {
+        .index = history->count,
+        .ticks = (size_t) k * period,
+    };
+    nob_da_append(&history->jumps, jump);
+    history->jumped += jump.ticks;
+
+    for (size_t step = 1; step <= period; ++step) {
+        TD_AffineCell* cells = _td_affine_board(history, step);
+        TD_Board* board = _td_clone_board(history, history->count - 1, history->affine.times[step]);
+        for (size_t i = 0; i < cells_count; ++i) {
+            board->cells[i].kind = cells[i].kind;
+            board->cells[i].value = (int) (cells[i].value + k * cells[i].delta);
+            board->cells[i].active = cells[i].active;
+        }
+        board->hash = _td_board_hash(board);
+
+        if (history->affine.landed[step]) {
+            _td_add_warp_landing(history, history->count - 1, board->time);
         }
+    }
 
-        bool changed = false;
-        TD_FOREACH(next_board, cursor) {
-            if (cursor.cell->active) {
-                changed = true;
-                break;
+    // The skipped repetitions are not in the history, so the loop detection must
+    // not compare against boards from before them
+    _td_clear_caches(history);
+    _td_detect_loop(history, history->count - 1);
+    history->tick = history->count - 1;
+    history->affine.recent_count = 0;
+}
+
+// Called after a warp landed on the last board. A loop that is driven by warps
+// lands at the same time in every repetition, so the distance to an earlier
+// landing at the same time is a candidate for its period. The skip ends within
+// the next `ticks` ticks.
+void _td_affine_accelerate(TD_BoardHistory* history, size_t ticks) {
+    TD_AffineLoops* affine = &history->affine;
+    size_t index = history->count - 1;
+    TD_Board* board = td_board_at(history, index);
+
+    if (affine->skip > 0) {
+        affine->skip--;
+    } else {
+        for (size_t i = affine->recent_count; i > 0; --i) {
+            TD_WarpLanding landing = affine->recent[i - 1];
+            if (landing.time != board->time || landing.index >= index || index - landing.index > TD_AFFINE_MAX_PERIOD) {
+                continue;
+            }
+
+            size_t period = index - landing.index;
+            int64_t repetitions = _td_affine_run_period(history, period);
+            if ((uint64_t) repetitions > ticks / period) {
+                repetitions = (int64_t) (ticks / period);
+            }
+            if (repetitions >= 2) {
+                _td_affine_skip(history, period, repetitions);
+                affine->backoff = 0;
+                return;
             }
         }
 
-        if (!changed) {
-            next_board->status = STATUS_STALLED;
+        // Back off exponentially from loops that can't be skipped
+        affine->backoff = (affine->backoff == 0) ? 1 : affine->backoff * 2;
+        if (affine->backoff > 1024) {
+            affine->backoff = 1024;
         }
+        affine->skip = affine->backoff;
+    }
+
+    if (affine->recent_count == TD_AFFINE_RECENT_LANDINGS) {
+        memmove(affine->recent, affine->recent + 1, (TD_AFFINE_RECENT_LANDINGS - 1) * sizeof(TD_WarpLanding));
+        affine->recent_count--;
     }
+    affine->recent[affine->recent_count++] = (TD_WarpLanding) {
+        .index = index,
+        .time = board->time,
+    };
 }
 
 void td_back(TD_BoardHistory* history) {
     if (history->tick > 0) {
         history->tick--;
+        _td_page_in(history, history->tick);
     }
 }
 
 void td_fast_forward(TD_BoardHistory* history) {
-    while (td_current_board(history)->status == STATUS_RUNNING) {
+    td_fast_forward_ticks(history, SIZE_MAX);
+}
+
+// Runs the program like td_fast_forward, but returns after at most `ticks` ticks
+void td_fast_forward_ticks(TD_BoardHistory* history, size_t ticks) {
+    size_t start = td_ticks(history, history->tick);
+    td_fast_forward_until(history, (ticks > SIZE_MAX - start) ? SIZE_MAX : start + ticks, SIZE_MAX);
+}
+
+// Runs the program like td_fast_forward up to the tick `end` at most, as counted
+// by td_ticks, and returns early after `steps` calls of td_forward. Loops are only
+// skipped up to `end`, but a step can skip any number of ticks before it.
+void td_fast_forward_until(TD_BoardHistory* history, size_t end, size_t steps) {
+    for (size_t i = 0; i < steps && td_current_board(history)->status == STATUS_RUNNING
+            && td_ticks(history, history->tick) < end; ++i) {
         td_forward(history);
+
+        TD_WarpLandings* landings = &history->warp_landings;
+        if (history->tick == history->count - 1 && td_current_board(history)->status == STATUS_RUNNING
+                && landings->count > 0 && landings->items[landings->count - 1].index == history->tick) {
+            _td_affine_accelerate(history, end - td_ticks(history, history->tick));
+        }
+    }
+}
+
+// Returns the number of the tick of the board at `index`, counting from 1 for the
+// first board, including the ticks of boards that are not in the history:
+// forgotten ones and the repetitions of loops that were skipped
+size_t td_ticks(TD_BoardHistory* history, size_t index) {
+    TD_TickJumps* jumps = &history->jumps;
+    size_t jumped = history->jumped;
+    for (size_t i = jumps->count; i > 0 && jumps->items[i - 1].index > index; --i) {
+        jumped -= jumps->items[i - 1].ticks;
     }
+    return index + 1 + history->forgotten + jumped;
 }
 
 void td_rewind(TD_BoardHistory* history) {
     history->tick = 0;
+    _td_page_in(history, history->tick);
+}
+
+// Returns the bytes the arena holds behind its end, which it does not use
+size_t _td_arena_unused_bytes(Arena* arena) {
+    if (arena->end == NULL) {
+        return 0;
+    }
+    size_t bytes = sizeof(uintptr_t) * (arena->end->committed - arena->end->count);
+    for (Region* r = arena->end->next; r != NULL; r = r->next) {
+        bytes += sizeof(Region) + sizeof(uintptr_t) * r->committed;
+    }
+    return bytes;
+}
+
+// Drops all boards from index `count` on and gives their cells back to the arena
+void td_truncate(TD_BoardHistory* history, size_t count) {
+    if (count == 0 || count >= history->count) {
+        return;
+    }
+
+    if (history->sparse.enabled) {
+        _td_sparse_truncate(history, count);
+    } else if (history->spill.enabled) {
+        _td_spill_truncate(history, count);
+    } else {
+        arena_rewind(&history->cells_arena, td_board_at(history, count)->cells_mark);
+    }
+    if (_td_arena_unused_bytes(&history->cells_arena) > TD_TRIM_BYTES) {
+        arena_trim(&history->cells_arena);
+    }
+    history->count = count;
+
+    _td_clear_caches(history);
+    while (history->warp_landings.count > 0
+            && history->warp_landings.items[history->warp_landings.count - 1].index >= count) {
+        history->warp_landings.count--;
+    }
+    TD_TickJumps* jumps = &history->jumps;
+    while (jumps->count > 0 && jumps->items[jumps->count - 1].index >= count) {
+        history->jumped -= jumps->items[--jumps->count].ticks;
+    }
+    history->quadtree.root = 0;
+    _td_transpositions_clear(&history->quadtree.leaps);
+    history->affine.recent_count = 0;
+    if (history->prefix.count > count) {
+        history->prefix.count = count;
+        history->prefix.cells.count = history->prefix.offsets.items[count];
+        history->prefix.offsets.count = count + 1;
+        history->prefix.tracking = false;
+    }
+    if (history->moved_index >= count) {
+        history->moved_index = SIZE_MAX;
+    }
+    if (history->tick >= count) {
+        history->tick = count - 1;
+    }
 }
 
+// Keeps the boards of the input prefix, so the program continues from the end
+// of it with the new inputs
 void td_reset(TD_BoardHistory* history, int input_a, int input_b) {
-    history->count = 1;
+    td_truncate(history, history->prefix.count);
     history->tick = 0;
+    history->forgotten = 0;
+    history->input_a = input_a;
+    history->input_b = input_b;
 
     TD_Board* board = td_current_board(history);
     TD_FOREACH(board, cursor) {
@@ -536,6 +4494,757 @@ void td_reset(TD_BoardHistory* history, int input_a, int input_b) {
             cursor.cell->value = input_b;
         }
     }
+    board->hash = _td_board_hash(board);
+
+    _td_clear_caches(history);
+    history->quadtree.root = 0;
+    _td_transpositions_clear(&history->quadtree.leaps);
+    history->affine.recent_count = 0;
+    _td_restore_prefix(history, input_a, input_b);
+}
+
+// Quadtree engine
+
+void _td_quad_table_insert(TD_Quadtree* quadtree, uint32_t node) {
+    size_t slot = quadtree->nodes.items[node].hash & (quadtree->table_capacity - 1);
+    while (quadtree->table[slot] != 0) {
+        slot = (slot + 1) & (quadtree->table_capacity - 1);
+    }
+    quadtree->table[slot] = node;
+}
+
+// Returns the existing node equal to `node` or adds it
+uint32_t _td_quad_intern(TD_Quadtree* quadtree, TD_QuadNode node) {
+    if ((quadtree->nodes.count + 1) * 2 > quadtree->table_capacity) {
+        NOB_FREE(quadtree->table);
+        quadtree->table_capacity = (quadtree->table_capacity == 0) ? 1024 : quadtree->table_capacity * 2;
+        quadtree->table = NOB_REALLOC(NULL, quadtree->table_capacity * sizeof(uint32_t));
+        NOB_ASSERT(quadtree->table != NULL && "Buy more RAM lol");
+        memset(quadtree->table, 0, quadtree->table_capacity * sizeof(uint32_t));
+        for (uint32_t i = 1; i < quadtree->nodes.count; ++i) {
+            _td_quad_table_insert(quadtree, i);
+        }
+    }
+
+    size_t slot = node.hash & (quadtree->table_capacity - 1);
+    while (quadtree->table[slot] != 0) {
+        TD_QuadNode* other = &quadtree->nodes.items[quadtree->table[slot]];
+        if (other->hash == node.hash && other->level == node.level
+                && memcmp(other->children, node.children, sizeof(node.children)) == 0
+                && other->kind == node.kind && other->value == node.value && other->outside == node.outside) {
+            return quadtree->table[slot];
+        }
+        slot = (slot + 1) & (quadtree->table_capacity - 1);
+    }
+
+    uint32_t index = quadtree->nodes.count;
+    nob_da_append(&quadtree->nodes, node);
+    quadtree->table[slot] = index;
+    return index;
+}
+
+uint32_t _td_quad_leaf(TD_Quadtree* quadtree, TD_CellKind kind, int value, bool outside) {
+    TD_QuadNode node = {0};
+    node.kind = kind;
+    node.value = value;
+    node.outside = outside;
+    node.hash = _td_mix_hash((((uint64_t) kind << 32) | (uint32_t) value) ^ ((uint64_t) outside << 63));
+    return _td_quad_intern(quadtree, node);
+}
+
+uint32_t _td_quad_node(TD_Quadtree* quadtree, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    TD_QuadNode node = {0};
+    node.level = quadtree->nodes.items[nw].level + 1;
+    node.children[0] = nw;
+    node.children[1] = ne;
+    node.children[2] = sw;
+    node.children[3] = se;
+    node.hash = node.level;
+    for (size_t i = 0; i < 4; ++i) {
+        node.hash = _td_mix_hash(node.hash * 0x9e3779b97f4a7c15ULL + node.children[i]);
+    }
+    return _td_quad_intern(quadtree, node);
+}
+
+// Drops all nodes and memoised results
+void _td_quad_clear(TD_Quadtree* quadtree) {
+    quadtree->nodes.count = 0;
+    if (quadtree->table) {
+        memset(quadtree->table, 0, quadtree->table_capacity * sizeof(uint32_t));
+    }
+
+    // Index 0 stands for a missing node
+    TD_QuadNode null_node = {0};
+    nob_da_append(&quadtree->nodes, null_node);
+
+    quadtree->outside[0] = _td_quad_leaf(quadtree, CELL_EMPTY, 0, true);
+    for (size_t level = 1; level < NOB_ARRAY_LEN(quadtree->outside); ++level) {
+        uint32_t child = quadtree->outside[level - 1];
+        quadtree->outside[level] = _td_quad_node(quadtree, child, child, child, child);
+    }
+    quadtree->root = 0;
+}
+
+uint32_t _td_quad_child(TD_Quadtree* quadtree, uint32_t node, size_t child) {
+    return quadtree->nodes.items[node].children[child];
+}
+
+uint32_t _td_quad_build(TD_Quadtree* quadtree, TD_Board* board, uint32_t level, int x, int y) {
+    TD_BoardHistory* history = board->history;
+    if (x >= (int) history->cols || y >= (int) history->rows || x + (1 << level) <= 0 || y + (1 << level) <= 0) {
+        return quadtree->outside[level];
+    }
+
+    if (level == 0) {
+        TD_Cell cell = board->cells[y * history->cols + x];
+        return _td_quad_leaf(quadtree, cell.kind, cell.value, false);
+    }
+
+    int half = 1 << (level - 1);
+    uint32_t nw = _td_quad_build(quadtree, board, level - 1, x, y);
+    uint32_t ne = _td_quad_build(quadtree, board, level - 1, x + half, y);
+    uint32_t sw = _td_quad_build(quadtree, board, level - 1, x, y + half);
+    uint32_t se = _td_quad_build(quadtree, board, level - 1, x + half, y + half);
+    return _td_quad_node(quadtree, nw, ne, sw, se);
+}
+
+// Writes the cells of `node` that lie within the board, with the node's top left
+// corner at (x, y). Other fields of the cells are left as they are.
+void _td_quad_write(TD_Quadtree* quadtree, uint32_t node, TD_Board* board, int x, int y) {
+    TD_BoardHistory* history = board->history;
+    TD_QuadNode* n = &quadtree->nodes.items[node];
+    if (x >= (int) history->cols || y >= (int) history->rows || x + (1 << n->level) <= 0 || y + (1 << n->level) <= 0) {
+        return;
+    }
+
+    if (n->level == 0) {
+        TD_Cell* cell = &board->cells[y * history->cols + x];
+        _td_track_moved(history, y * history->cols + x, n->kind);
+        cell->kind = n->kind;
+        cell->value = n->value;
+        return;
+    }
+
+    int half = 1 << (n->level - 1);
+    uint32_t children[4];
+    memcpy(children, n->children, sizeof(children));
+    _td_quad_write(quadtree, children[0], board, x, y);
+    _td_quad_write(quadtree, children[1], board, x + half, y);
+    _td_quad_write(quadtree, children[2], board, x, y + half);
+    _td_quad_write(quadtree, children[3], board, x + half, y + half);
+}
+
+void _td_quad_read_block(TD_Quadtree* quadtree, uint32_t node, TD_Cell* cells, bool* outside, int x, int y) {
+    TD_QuadNode* n = &quadtree->nodes.items[node];
+    if (n->level == 0) {
+        cells[y * 8 + x] = (TD_Cell) {
+            .kind = n->kind, .value = n->value
+        };
+        outside[y * 8 + x] = n->outside;
+        return;
+    }
+
+    int half = 1 << (n->level - 1);
+    uint32_t children[4];
+    memcpy(children, n->children, sizeof(children));
+    _td_quad_read_block(quadtree, children[0], cells, outside, x, y);
+    _td_quad_read_block(quadtree, children[1], cells, outside, x + half, y);
+    _td_quad_read_block(quadtree, children[2], cells, outside, x, y + half);
+    _td_quad_read_block(quadtree, children[3], cells, outside, x + half, y + half);
+}
+
+uint32_t _td_quad_block_leaf(TD_Quadtree* quadtree, TD_Cell* cells, bool* outside, int x, int y) {
+    if (outside[y * 8 + x]) {
+        return quadtree->outside[0];
+    }
+    return _td_quad_leaf(quadtree, cells[y * 8 + x].kind, cells[y * 8 + x].value, false);
+}
+
+// Advances the center 4x4 cells of an 8x8 node by one tick. These only depend on
+// the cells within distance 2, so the operators of the inner 6x6 cells are run
+// on a board of their own.
+void _td_quad_step_base(TD_Quadtree* quadtree, uint32_t node) {
+    TD_BoardHistory block = {0};
+    block.cols = 8;
+    block.rows = 8;
+
+    TD_Cell current_cells[64];
+    TD_Cell next_cells[64];
+    bool outside[64];
+    _td_quad_read_block(quadtree, node, current_cells, outside, 0, 0);
+    memcpy(next_cells, current_cells, sizeof(next_cells));
+
+    TD_Board current_board = {
+        .cells = current_cells, .history = &block, .status = STATUS_RUNNING
+    };
+    TD_Board next_board = {
+        .cells = next_cells, .history = &block, .status = STATUS_RUNNING
+    };
+
+    TD_BoardCursor first_cursor = td_cursor_first(&current_board);
+    for (int y = 1; y < 7; ++y) {
+        for (int x = 1; x < 7; ++x) {
+            _td_evaluate_cell(td_cursor_move(first_cursor, x, y), &next_board);
+        }
+    }
+
+    // Writes to the padding are dropped like writes outside of the board
+    for (size_t i = 0; i < 64; ++i) {
+        if (outside[i]) {
+            next_cells[i] = (TD_Cell) {
+                0
+            };
+        }
+    }
+
+    bool fired = false;
+    for (int y = 2; y < 6; ++y) {
+        for (int x = 2; x < 6; ++x) {
+            fired = fired || next_cells[y * 8 + x].active;
+        }
+    }
+
+    uint32_t quarters[4];
+    for (size_t i = 0; i < 4; ++i) {
+        int x = 2 + (i % 2) * 2;
+        int y = 2 + (i / 2) * 2;
+        quarters[i] = _td_quad_node(quadtree,
+                                    _td_quad_block_leaf(quadtree, next_cells, outside, x, y),
+                                    _td_quad_block_leaf(quadtree, next_cells, outside, x + 1, y),
+                                    _td_quad_block_leaf(quadtree, next_cells, outside, x, y + 1),
+                                    _td_quad_block_leaf(quadtree, next_cells, outside, x + 1, y + 1));
+    }
+
+    uint32_t result = _td_quad_node(quadtree, quarters[0], quarters[1], quarters[2], quarters[3]);
+    TD_QuadNode* n = &quadtree->nodes.items[node];
+    n->result = result;
+    n->fired = fired ? 1 : 0;
+    n->stopped = (next_board.status != STATUS_RUNNING) ? 1 : 0;
+}
+
+// The center of a node, made of the inner quarters of its children
+uint32_t _td_quad_center(TD_Quadtree* quadtree, uint32_t node) {
+    uint32_t nw = _td_quad_child(quadtree, node, 0);
+    uint32_t ne = _td_quad_child(quadtree, node, 1);
+    uint32_t sw = _td_quad_child(quadtree, node, 2);
+    uint32_t se = _td_quad_child(quadtree, node, 3);
+    return _td_quad_node(quadtree,
+                         _td_quad_child(quadtree, nw, 3), _td_quad_child(quadtree, ne, 2),
+                         _td_quad_child(quadtree, sw, 1), _td_quad_child(quadtree, se, 0));
+}
+
+// Computes the result of a node of level 3 or higher. Cells only influence cells
+// within distance 2 per tick, so the center of a node of level k can be advanced
+// by 2^(k - 3) ticks. Larger nodes do this in two halves from nine overlapping
+// nodes one level down, like Hashlife. Nodes above the leap size only take the
+// centers of those nodes in the first half.
+uint32_t _td_quad_step(TD_Quadtree* quadtree, uint32_t node) {
+    TD_QuadNode* n = &quadtree->nodes.items[node];
+    if (n->result != 0) {
+        return n->result;
+    }
+    uint32_t level = n->level;
+    if (level == 3) {
+        _td_quad_step_base(quadtree, node);
+        return quadtree->nodes.items[node].result;
+    }
+
+    uint32_t children[4];
+    uint32_t grandchildren[4][4];
+    memcpy(children, n->children, sizeof(children));
+    for (size_t i = 0; i < 4; ++i) {
+        memcpy(grandchildren[i], quadtree->nodes.items[children[i]].children, sizeof(grandchildren[i]));
+    }
+
+    uint32_t parts[9] = {
+        children[0],
+        _td_quad_node(quadtree, grandchildren[0][1], grandchildren[1][0], grandchildren[0][3], grandchildren[1][2]),
+        children[1],
+        _td_quad_node(quadtree, grandchildren[0][2], grandchildren[0][3], grandchildren[2][0], grandchildren[2][1]),
+        _td_quad_node(quadtree, grandchildren[0][3], grandchildren[1][2], grandchildren[2][1], grandchildren[3][0]),
+        _td_quad_node(quadtree, grandchildren[1][2], grandchildren[1][3], grandchildren[3][0], grandchildren[3][1]),
+        children[2],
+        _td_quad_node(quadtree, grandchildren[2][1], grandchildren[3][0], grandchildren[2][3], grandchildren[3][2]),
+        children[3],
+    };
+
+    bool full_step = level - 3 <= TD_QUADTREE_LEAP_BITS;
+    uint64_t fired = 0;
+    uint64_t stopped = 0;
+    for (size_t i = 0; i < 9; ++i) {
+        if (full_step) {
+            uint32_t part = parts[i];
+            parts[i] = _td_quad_step(quadtree, part);
+            fired |= quadtree->nodes.items[part].fired;
+            stopped |= quadtree->nodes.items[part].stopped;
+        } else {
+            parts[i] = _td_quad_center(quadtree, parts[i]);
+        }
+    }
+
+    uint32_t halves[4] = {
+        _td_quad_node(quadtree, parts[0], parts[1], parts[3], parts[4]),
+        _td_quad_node(quadtree, parts[1], parts[2], parts[4], parts[5]),
+        _td_quad_node(quadtree, parts[3], parts[4], parts[6], parts[7]),
+        _td_quad_node(quadtree, parts[4], parts[5], parts[7], parts[8]),
+    };
+
+    size_t shift = full_step ? ((size_t) 1 << (level - 4)) : 0;
+    for (size_t i = 0; i < 4; ++i) {
+        uint32_t half = halves[i];
+        halves[i] = _td_quad_step(quadtree, half);
+        fired |= quadtree->nodes.items[half].fired << shift;
+        stopped |= quadtree->nodes.items[half].stopped << shift;
+    }
+
+    uint32_t result = _td_quad_node(quadtree, halves[0], halves[1], halves[2], halves[3]);
+    n = &quadtree->nodes.items[node];
+    n->result = result;
+    n->fired = fired;
+    n->stopped = stopped;
+    return result;
+}
+
+// Puts a node in the center of a node one level up, surrounded by padding
+uint32_t _td_quad_expand(TD_Quadtree* quadtree, uint32_t node) {
+    uint32_t outside = quadtree->outside[quadtree->nodes.items[node].level - 1];
+    return _td_quad_node(quadtree,
+                         _td_quad_node(quadtree, outside, outside, outside, _td_quad_child(quadtree, node, 0)),
+                         _td_quad_node(quadtree, outside, outside, _td_quad_child(quadtree, node, 1), outside),
+                         _td_quad_node(quadtree, outside, _td_quad_child(quadtree, node, 2), outside, outside),
+                         _td_quad_node(quadtree, _td_quad_child(quadtree, node, 3), outside, outside, outside));
+}
+
+// Advances the last board by TD_QUADTREE_LEAP ticks at once. Returns false if an
+// operator may write to a stop cell or if the board may stall during the leap.
+bool _td_quad_leap(TD_BoardHistory* history) {
+    TD_Quadtree* quadtree = &history->quadtree;
+    TD_Board* board = td_board_at(history, history->count - 1);
+
+    if (quadtree->nodes.count == 0 || quadtree->nodes.count > TD_QUADTREE_MAX_NODES) {
+        _td_quad_clear(quadtree);
+    }
+
+    // The root has the board in its top left center quarter and is at least large
+    // enough for a full leap
+    if (quadtree->root == 0 || quadtree->root_index != history->count - 1) {
+        uint32_t level = TD_QUADTREE_LEAP_BITS + 3;
+        while ((1u << (level - 1)) < history->cols || (1u << (level - 1)) < history->rows) {
+            level++;
+        }
+        int offset = 1 << (level - 2);
+        quadtree->root = _td_quad_build(quadtree, board, level, -offset, -offset);
+        quadtree->root_index = history->count - 1;
+    }
+
+    uint32_t root = quadtree->root;
+    uint32_t result = _td_quad_step(quadtree, root);
+    uint64_t all_ticks = (TD_QUADTREE_LEAP == 64) ? UINT64_MAX : (((uint64_t) 1 << TD_QUADTREE_LEAP) - 1);
+    if (quadtree->nodes.items[root].stopped != 0 || quadtree->nodes.items[root].fired != all_ticks) {
+        return false;
+    }
+
+    TD_Board* next_board = _td_clone_board(history, history->count - 1, board->time + TD_QUADTREE_LEAP);
+    _td_quad_write(quadtree, result, next_board, 0, 0);
+    next_board->hash = _td_board_hash(next_board);
+
+    // The boards within the leap are not kept, but their ticks count
+    TD_TickJump jump = {
+        .index = history->count - 1,
+        .ticks = TD_QUADTREE_LEAP - 1,
+    };
+    nob_da_append(&history->jumps, jump);
+    history->jumped += jump.ticks;
+
+    quadtree->root = _td_quad_expand(quadtree, result);
+    quadtree->root_index = history->count - 1;
+    return true;
+}
+
+// Runs the program like td_fast_forward. Programs without time warps are advanced
+// in leaps of TD_QUADTREE_LEAP ticks, and only the boards at the end of each leap
+// are kept in the history. Ticks that may stop or stall the program are run one
+// by one.
+void td_leap_forward(TD_BoardHistory* history) {
+    history->tick = history->count - 1;
+
+    TD_Board* board = td_current_board(history);
+    TD_FOREACH(board, cursor) {
+        if (cursor.cell->kind == CELL_TIMEWARP) {
+            td_fast_forward(history);
+            return;
+        }
+    }
+
+    TD_Quadtree* quadtree = &history->quadtree;
+    while (td_current_board(history)->status == STATUS_RUNNING) {
+        if (!_td_quad_leap(history)) {
+            for (size_t i = 0; i < TD_QUADTREE_LEAP && td_current_board(history)->status == STATUS_RUNNING; ++i) {
+                td_forward(history);
+            }
+            continue;
+        }
+        history->tick = history->count - 1;
+
+        // Boards created by single ticks must not find leaped boards as earlier
+        // boards of a loop, since the tick count between them would be off
+        _td_clear_caches(history);
+
+        // A leaped board that repeats an earlier one shows that the program loops.
+        // The loop and its exact period are found by single ticks from here.
+        TD_Board* next_board = td_current_board(history);
+        TD_Transposition* entry = _td_transpositions_slot(&quadtree->leaps, next_board->hash);
+        if (entry->generation == quadtree->leaps.generation
+                && _td_same_cells(next_board, td_board_at(history, entry->index))) {
+            _td_detect_loop(history, history->count - 1);
+            td_fast_forward(history);
+            return;
+        }
+        _td_transpositions_put(&quadtree->leaps, next_board->hash, history->count - 1);
+        _td_trace_boards(history);
+        _td_pack_boards(history);
+        _td_spill_boards(history);
+    }
+}
+
+// Batch evaluation
+
+// Items are handed out to the threads in blocks of this many, so they rarely
+// compete for the next block while short batches still spread over all of them
+#define TD_EVALUATION_BLOCK 64
+
+typedef struct {
+    TD_BoardHistory* history;
+    TD_Evaluation* items;
+    size_t count;
+
+    // Index of the next block, shared by all threads of a batch
+    volatile size_t* next;
+
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} _TD_Evaluator;
+
+void _td_evaluate_item(TD_BoardHistory* history, TD_Evaluation* item) {
+    td_reset(history, item->input_a, item->input_b);
+    td_fast_forward_until(history, (item->tick_limit == 0) ? SIZE_MAX : item->tick_limit, SIZE_MAX);
+
+    TD_Board* board = td_current_board(history);
+    item->status = board->status;
+    item->result = board->result;
+    item->ticks = td_ticks(history, history->tick);
+    if (item->measure_volume) {
+        item->volume = td_spacetime_volume(history);
+    }
+}
+
+void _td_evaluate_blocks(_TD_Evaluator* evaluator) {
+    while (true) {
+#ifdef _WIN32
+        size_t begin = InterlockedExchangeAdd64((volatile LONG64*) evaluator->next, TD_EVALUATION_BLOCK);
+#else
+        size_t begin = __atomic_fetch_add(evaluator->next, TD_EVALUATION_BLOCK, __ATOMIC_RELAXED);
+#endif
+        if (begin >= evaluator->count) {
+            return;
+        }
+        size_t end = (evaluator->count - begin < TD_EVALUATION_BLOCK) ? evaluator->count : begin + TD_EVALUATION_BLOCK;
+        for (size_t i = begin; i < end; ++i) {
+            _td_evaluate_item(evaluator->history, &evaluator->items[i]);
+        }
+    }
+}
+
+#ifdef _WIN32
+DWORD WINAPI _td_evaluate_thread(LPVOID evaluator) {
+    _td_evaluate_blocks(evaluator);
+    return 0;
+}
+#else
+void* _td_evaluate_thread(void* evaluator) {
+    _td_evaluate_blocks(evaluator);
+    return NULL;
+}
+#endif
+
+// Runs the program once for every item, with the inputs of the item, and writes
+// the outcome into the item. The histories all have to be loaded from the same
+// program, and each of them runs on its own thread, the first one on the calling
+// thread. A history is reset for every item, so it keeps its buffers and input
+// prefix from one item to the next.
+void td_evaluate(TD_BoardHistory* histories, size_t histories_count, TD_Evaluation* items, size_t count) {
+    size_t blocks = (count + TD_EVALUATION_BLOCK - 1) / TD_EVALUATION_BLOCK;
+    size_t threads = (histories_count < blocks) ? histories_count : blocks;
+    if (threads == 0) {
+        return;
+    }
+
+    volatile size_t next = 0;
+    _TD_Evaluator* evaluators = NOB_REALLOC(NULL, threads * sizeof(*evaluators));
+    NOB_ASSERT(evaluators != NULL && "Buy more RAM lol");
+    for (size_t i = 0; i < threads; ++i) {
+        evaluators[i] = (_TD_Evaluator) {
+            .history = &histories[i],
+            .items = items,
+            .count = count,
+            .next = &next,
+        };
+    }
+
+    for (size_t i = 1; i < threads; ++i) {
+#ifdef _WIN32
+        evaluators[i].thread = CreateThread(NULL, 0, _td_evaluate_thread, &evaluators[i], 0, NULL);
+        NOB_ASSERT(evaluators[i].thread != NULL && "Could not start an evaluation thread");
+#else
+        int error = pthread_create(&evaluators[i].thread, NULL, _td_evaluate_thread, &evaluators[i]);
+        NOB_ASSERT(error == 0 && "Could not start an evaluation thread");
+#endif
+    }
+    _td_evaluate_blocks(&evaluators[0]);
+    for (size_t i = 1; i < threads; ++i) {
+#ifdef _WIN32
+        WaitForSingleObject(evaluators[i].thread, INFINITE);
+        CloseHandle(evaluators[i].thread);
+#else
+        pthread_join(evaluators[i].thread, NULL);
+#endif
+    }
+    NOB_FREE(evaluators);
+}
+
+// Result cache
+
+// Volume of the smallest box in columns, rows and time around every cell that is
+// not empty on the boards of the history up to the current one, as the contest
+// scored programs. Boards that were forgotten are not counted.
+uint64_t td_spacetime_volume(TD_BoardHistory* history) {
+    size_t min_col = SIZE_MAX;
+    size_t max_col = 0;
+    size_t min_row = SIZE_MAX;
+    size_t max_row = 0;
+    size_t min_time = SIZE_MAX;
+    size_t max_time = 0;
+    for (size_t i = 0; i <= history->tick; ++i) {
+        TD_Board* board = td_board_at(history, i);
+        min_time = (board->time < min_time) ? board->time : min_time;
+        max_time = (board->time > max_time) ? board->time : max_time;
+
+        TD_Cell* cells = td_board_cells(board);
+        for (size_t row = 0; row < history->rows; ++row) {
+            TD_Cell* line = &cells[row * history->cols];
+            bool inside = min_row <= row && row <= max_row;
+            for (size_t col = 0; col < history->cols; ++col) {
+                // Cells within the box found so far can't make it any larger
+                if (inside && col == min_col) {
+                    col = max_col;
+                    continue;
+                }
+                if (line[col].kind == CELL_EMPTY) {
+                    continue;
+                }
+                min_col = (col < min_col) ? col : min_col;
+                max_col = (col > max_col) ? col : max_col;
+                min_row = (row < min_row) ? row : min_row;
+                max_row = (row > max_row) ? row : max_row;
+                inside = true;
+            }
+        }
+    }
+
+    if (min_col == SIZE_MAX) {
+        return 0;
+    }
+    return (uint64_t) (max_col - min_col + 1) * (max_row - min_row + 1) * (max_time - min_time + 1);
+}
+
+uint64_t _td_result_key_hash(TD_ResultRecord* record) {
+    uint64_t hash = _td_mix_hash(record->program_hash ^ record->pruned);
+    hash = _td_mix_hash(hash ^ (uint32_t) record->input_a ^ ((uint64_t) (uint32_t) record->input_b << 32));
+    return _td_mix_hash(hash ^ record->tick_limit);
+}
+
+bool _td_result_key_equal(TD_ResultRecord* first, TD_ResultRecord* second) {
+    return first->program_hash == second->program_hash && first->input_a == second->input_a
+           && first->input_b == second->input_b && first->tick_limit == second->tick_limit
+           && first->pruned == second->pruned;
+}
+
+uint64_t _td_result_checksum(TD_ResultRecord* record) {
+    uint64_t hash = _td_result_key_hash(record);
+    hash = _td_mix_hash(hash ^ record->status ^ ((uint64_t) record->version << 32));
+    hash = _td_mix_hash(hash ^ (uint64_t) record->result);
+    hash = _td_mix_hash(hash ^ record->ticks);
+    return _td_mix_hash(hash ^ record->volume);
+}
+
+// Key of the run of the history with its current inputs
+TD_ResultRecord td_result_key(TD_BoardHistory* history, size_t tick_limit) {
+    return (TD_ResultRecord) {
+        .program_hash = td_program_hash(history),
+        .input_a = history->input_a,
+        .input_b = history->input_b,
+        .tick_limit = tick_limit,
+        .pruned = history->pruning.enabled,
+    };
+}
+
+// Fills in the outcome of the run of the history up to the current board
+void td_result_set(TD_ResultRecord* record, TD_BoardHistory* history) {
+    TD_Board* board = td_current_board(history);
+    record->status = board->status;
+    record->result = board->result;
+    record->ticks = td_ticks(history, history->tick);
+    record->volume = td_spacetime_volume(history);
+}
+
+// Adds the record to the table, replacing a record with the same key
+void _td_result_cache_index(TD_ResultCache* cache, size_t index) {
+    if ((cache->records.count + 1) * 2 > cache->table_capacity) {
+        NOB_FREE(cache->table);
+        cache->table_capacity = (cache->table_capacity == 0) ? 1024 : cache->table_capacity * 2;
+        cache->table = NOB_REALLOC(NULL, cache->table_capacity * sizeof(size_t));
+        NOB_ASSERT(cache->table != NULL && "Buy more RAM lol");
+        memset(cache->table, 0, cache->table_capacity * sizeof(size_t));
+        for (size_t i = 0; i < index; ++i) {
+            _td_result_cache_index(cache, i);
+        }
+    }
+
+    TD_ResultRecord* record = &cache->records.items[index];
+    size_t slot = _td_result_key_hash(record) & (cache->table_capacity - 1);
+    while (cache->table[slot] != 0 && !_td_result_key_equal(&cache->records.items[cache->table[slot] - 1], record)) {
+        slot = (slot + 1) & (cache->table_capacity - 1);
+    }
+    cache->table[slot] = index + 1;
+}
+
+TD_ResultRecord* _td_result_cache_lookup(TD_ResultCache* cache, TD_ResultRecord* key) {
+    if (cache->table_capacity == 0) {
+        return NULL;
+    }
+    size_t slot = _td_result_key_hash(key) & (cache->table_capacity - 1);
+    while (cache->table[slot] != 0) {
+        TD_ResultRecord* record = &cache->records.items[cache->table[slot] - 1];
+        if (_td_result_key_equal(record, key)) {
+            return record;
+        }
+        slot = (slot + 1) & (cache->table_capacity - 1);
+    }
+    return NULL;
+}
+
+// Reads the records other processes appended to the log since it was read last,
+// skipping keys it knows already, like the ones this process added itself. A
+// record that is still being written at the end of the log is read the next time.
+bool td_result_cache_read(TD_ResultCache* cache) {
+    FILE* file = fopen(cache->path, "rb");
+    if (file == NULL) {
+        return nob_file_exists(cache->path) == 0;
+    }
+    if (fseek(file, (long) cache->read_bytes, SEEK_SET) != 0) {
+        fclose(file);
+        return false;
+    }
+
+    TD_ResultRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        cache->read_bytes += sizeof(record);
+        if (memcmp(record.magic, TD_RESULT_MAGIC, 4) != 0 || record.version != TD_RESULT_VERSION
+                || record.checksum != _td_result_checksum(&record) || _td_result_cache_lookup(cache, &record) != NULL) {
+            continue;
+        }
+        nob_da_append(&cache->records, record);
+        _td_result_cache_index(cache, cache->records.count - 1);
+    }
+    fclose(file);
+    return true;
+}
+
+// Opens the result cache at `path`, which is created by the first record added
+bool td_result_cache_open(TD_ResultCache* cache, const char* path) {
+    *cache = (TD_ResultCache) {
+        0
+    };
+    size_t size = strlen(path) + 1;
+    cache->path = NOB_REALLOC(NULL, size);
+    NOB_ASSERT(cache->path != NULL && "Buy more RAM lol");
+    memcpy(cache->path, path, size);
+
+    if (!td_result_cache_read(cache)) {
+        nob_log(NOB_ERROR, "Could not read the result cache %s.", path);
+        td_result_cache_close(cache);
+        return false;
+    }
+    return true;
+}
+
+// Looks up the record with the key of `record` among the records read so far,
+// or the record of a run without a limit that ended before the limit of `record`,
+// and fills in its outcome
+bool td_result_cache_find(TD_ResultCache* cache, TD_ResultRecord* record) {
+    TD_ResultRecord* found = _td_result_cache_lookup(cache, record);
+    if (found == NULL && record->tick_limit != 0) {
+        TD_ResultRecord unlimited = *record;
+        unlimited.tick_limit = 0;
+        found = _td_result_cache_lookup(cache, &unlimited);
+        if (found != NULL && found->ticks > record->tick_limit) {
+            found = NULL;
+        }
+    }
+    if (found == NULL) {
+        return false;
+    }
+    *record = *found;
+    return true;
+}
+
+// Appends the record to the log in a single write, which the operating system
+// does not interleave with the writes of other processes. Runs that ended before
+// their tick limit are added without it.
+bool td_result_cache_add(TD_ResultCache* cache, TD_ResultRecord* record) {
+    if (record->status != STATUS_RUNNING) {
+        record->tick_limit = 0;
+    }
+    memcpy(record->magic, TD_RESULT_MAGIC, 4);
+    record->version = TD_RESULT_VERSION;
+    record->checksum = _td_result_checksum(record);
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(cache->path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    DWORD written = 0;
+    bool result = file != INVALID_HANDLE_VALUE && WriteFile(file, record, sizeof(*record), &written, NULL)
+                  && written == sizeof(*record);
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+#else
+    int file = open(cache->path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    bool result = file >= 0 && write(file, record, sizeof(*record)) == sizeof(*record);
+    if (file >= 0) {
+        close(file);
+    }
+#endif
+    if (!result) {
+        nob_log(NOB_ERROR, "Could not add to the result cache %s.", cache->path);
+        return false;
+    }
+
+    nob_da_append(&cache->records, *record);
+    _td_result_cache_index(cache, cache->records.count - 1);
+    return true;
+}
+
+void td_result_cache_close(TD_ResultCache* cache) {
+    NOB_FREE(cache->path);
+    NOB_FREE(cache->table);
+    nob_da_free(cache->records);
+    *cache = (TD_ResultCache) {
+        0
+    };
 }
 
 // Cursor operations
@@ -555,6 +5264,7 @@ TD_BoardCursor _td_cursor_validate(TD_BoardCursor cursor) {
 }
 
 TD_BoardCursor td_cursor_first(TD_Board* board) {
+    td_board_cells(board);
     TD_BoardCursor cursor = {
         .board = board,
         .col = 0,
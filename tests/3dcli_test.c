@@ -0,0 +1,300 @@
+// Regression tests for the command line interface, run with `./nob.exe test`.
+// The interface is included with its main renamed, so its commands can be run
+// in the same process.
+
+#include <fcntl.h>
+
+#define main cli_main
+#include "../src/3dcli.c"
+#undef main
+
+#define EXPECT(condition)                                                  \
+    do {                                                                   \
+        if (!(condition)) {                                                \
+            nob_log(NOB_ERROR, "%s:%d: %s", __FILE__, __LINE__, #condition); \
+            return false;                                                  \
+        }                                                                  \
+    } while (0)
+
+#define TEST_SOCKET_PATH "3dcli_test.sock"
+#define TEST_DIVIDE_PATH "3dcli_test_divide.3dl"
+#define TEST_RELOAD_SOCKET_PATH "3dcli_test_reload.sock"
+#define TEST_PROGRAM_PATH "3dcli_test_program.3dl"
+#define TEST_INPUT_PATH "3dcli_test_input.txt"
+#define TEST_OUTPUT_PATH "3dcli_test_output.txt"
+#define TEST_SHARD_PATH "3dcli_test_shard.txt"
+#define TEST_MERGED_PATH "3dcli_test_merged.txt"
+
+// Divides A by B into an S cell
+static const char* divide_program =
+    ". B .\n"
+    "A / .\n"
+    ". S .\n";
+
+void sleep_milliseconds(int milliseconds) {
+#ifdef _WIN32
+    Sleep(milliseconds);
+#else
+    usleep(milliseconds * 1000);
+#endif
+}
+
+#ifdef _WIN32
+DWORD WINAPI serve_thread(LPVOID path) {
+    serve_command(path, 2, false, NULL);
+    return 0;
+}
+#else
+void* serve_thread(void* path) {
+    serve_command(path, 2, false, NULL);
+    return NULL;
+}
+#endif
+
+// Connects to the daemon, waiting for it to listen
+bool connect_daemon(const char* path, Socket* result) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    strcpy(address.sun_path, path);
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        Socket client = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(client, (struct sockaddr*) &address, sizeof(address)) == 0) {
+            *result = client;
+            return true;
+        }
+        socket_close(client);
+        sleep_milliseconds(20);
+    }
+    return false;
+}
+
+// Sends the requests and reads the replies up to the `lines`-th line break
+bool request_daemon(Socket client, const char* requests, size_t lines, Nob_String_Builder* replies) {
+    if (send(client, requests, strlen(requests), 0) != (int) strlen(requests)) {
+        return false;
+    }
+    replies->count = 0;
+    char buffer[256];
+    size_t received = 0;
+    while (received < lines) {
+        int bytes = recv(client, buffer, sizeof(buffer), 0);
+        if (bytes <= 0) {
+            return false;
+        }
+        for (int i = 0; i < bytes; ++i) {
+            received += buffer[i] == '\n';
+        }
+        nob_da_append_many(replies, buffer, bytes);
+    }
+    nob_sb_append_null(replies);
+    return true;
+}
+
+// A request that divides by zero is answered with a crash, and the daemon keeps
+// answering the requests after it
+bool test_serve_divide_by_zero(void) {
+    EXPECT(nob_write_entire_file(TEST_DIVIDE_PATH, divide_program, strlen(divide_program)));
+    start_thread(serve_thread, TEST_SOCKET_PATH);
+
+    Socket client;
+    EXPECT(connect_daemon(TEST_SOCKET_PATH, &client));
+    Nob_String_Builder replies = {0};
+    bool passed = request_daemon(client, "run a " TEST_DIVIDE_PATH " 6 0\n", 1, &replies)
+                  && strncmp(replies.items, "a 0 Crashed 2 ", 14) == 0;
+    passed = passed && request_daemon(client, "run b " TEST_DIVIDE_PATH " -2147483648 -1\n", 1, &replies)
+             && strncmp(replies.items, "b 0 Crashed 2 ", 14) == 0;
+    passed = passed && request_daemon(client, "run c " TEST_DIVIDE_PATH " 6 3\n", 1, &replies)
+             && strncmp(replies.items, "c 2 Stopped 2 ", 14) == 0;
+    socket_close(client);
+
+    // Other clients are still served
+    passed = passed && connect_daemon(TEST_SOCKET_PATH, &client);
+    passed = passed && request_daemon(client, "run d " TEST_DIVIDE_PATH " 7 2\n", 1, &replies)
+             && strncmp(replies.items, "d 3 Stopped 2 ", 14) == 0;
+    socket_close(client);
+
+    nob_sb_free(replies);
+    remove(TEST_DIVIDE_PATH);
+    remove(TEST_SOCKET_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+// A program file that is written again is loaded again, while one that was not
+// changed is answered from the loaded copy
+bool test_serve_reloads_changed_program(void) {
+    static const char* multiply_program =
+        ". . B .\n"
+        ". A * .\n"
+        ". . S .\n";
+    EXPECT(nob_write_entire_file(TEST_PROGRAM_PATH, divide_program, strlen(divide_program)));
+    start_thread(serve_thread, TEST_RELOAD_SOCKET_PATH);
+
+    Socket client;
+    EXPECT(connect_daemon(TEST_RELOAD_SOCKET_PATH, &client));
+    Nob_String_Builder replies = {0};
+    bool passed = request_daemon(client, "run a " TEST_PROGRAM_PATH " 6 3\n", 1, &replies)
+                  && strncmp(replies.items, "a 2 Stopped 2 ", 14) == 0;
+    passed = passed && request_daemon(client, "run b " TEST_PROGRAM_PATH " 6 3\n", 1, &replies)
+             && strncmp(replies.items, "b 2 Stopped 2 ", 14) == 0;
+    passed = passed && nob_write_entire_file(TEST_PROGRAM_PATH, multiply_program, strlen(multiply_program));
+    passed = passed && request_daemon(client, "run c " TEST_PROGRAM_PATH " 6 3\n", 1, &replies)
+             && strncmp(replies.items, "c 18 Stopped 2 ", 15) == 0;
+    socket_close(client);
+
+    nob_sb_free(replies);
+    remove(TEST_PROGRAM_PATH);
+    remove(TEST_RELOAD_SOCKET_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+// Runs `stream` on the program with `input` as its standard input, and reads
+// what it writes to its standard output without the carriage returns
+bool run_stream(const char* program_path, const char* input, size_t jobs, Nob_String_Builder* output) {
+    if (!nob_write_entire_file(TEST_INPUT_PATH, input, strlen(input))) {
+        return false;
+    }
+    fflush(stdout);
+    int saved_input = dup(0);
+    int saved_output = dup(1);
+    int input_file = open(TEST_INPUT_PATH, O_RDONLY);
+    int output_file = open(TEST_OUTPUT_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool redirected = input_file >= 0 && output_file >= 0 && dup2(input_file, 0) >= 0 && dup2(output_file, 1) >= 0;
+    int exit_code = redirected ? stream_command(program_path, jobs, 0, false, NULL) : 1;
+    fflush(stdout);
+    dup2(saved_input, 0);
+    dup2(saved_output, 1);
+    close(saved_input);
+    close(saved_output);
+    close(input_file);
+    close(output_file);
+
+    output->count = 0;
+    bool read = exit_code == 0 && nob_read_entire_file(TEST_OUTPUT_PATH, output);
+    remove(TEST_INPUT_PATH);
+    remove(TEST_OUTPUT_PATH);
+    if (!read) {
+        return false;
+    }
+    size_t length = 0;
+    for (size_t i = 0; i < output->count; ++i) {
+        if (output->items[i] != '\r') {
+            output->items[length++] = output->items[i];
+        }
+    }
+    output->count = length;
+    nob_sb_append_null(output);
+    return true;
+}
+
+// A line whose run divides by zero is answered as a crash, and the lines after
+// it are still run
+bool test_stream_divide_by_zero(void) {
+    EXPECT(nob_write_entire_file(TEST_DIVIDE_PATH, divide_program, strlen(divide_program)));
+    Nob_String_Builder output = {0};
+    bool passed = true;
+    for (size_t jobs = 1; jobs <= 2; ++jobs) {
+        passed = passed && run_stream(TEST_DIVIDE_PATH, "6 0\n6 3\n-2147483648 -1\n7 2\n", jobs, &output)
+                 && strcmp(output.items, "0 Crashed 2\n2 Stopped 2\n0 Crashed 2\n3 Stopped 2\n") == 0;
+    }
+    nob_sb_free(output);
+    remove(TEST_DIVIDE_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+// Sweeps over too many runs are refused instead of overflowing their count, both
+// when they are run and when a shard claims to be one, while a small sweep
+// still merges
+bool test_sweep_run_count(void) {
+    static const char* headers[] = {
+        "# 3dl sweep 1\n# program 0 unpruned\n# inputs -2147483648 2147483647 -2147483648 2147483647\n# limit 0\n# shard 0 1\n",
+        "# 3dl sweep 1\n# program 0 unpruned\n# inputs 0 65536 0 65535\n# limit 0\n# shard 0 1\n",
+        "# 3dl sweep 1\n# program 0 unpruned\n# inputs 0 1 0 1\n# limit 0\n# shard 0 5\n",
+        "# 3dl sweep 1\n# program 0 unpruned\n# inputs 0 1 0 1\n# limit 0\n# shard 0 0\n",
+    };
+    for (size_t i = 0; i < NOB_ARRAY_LEN(headers); ++i) {
+        EXPECT(nob_write_entire_file(TEST_SHARD_PATH, headers[i], strlen(headers[i])));
+        char* paths[] = {TEST_SHARD_PATH};
+        EXPECT(merge_command(TEST_MERGED_PATH, paths, 1) == 1);
+    }
+
+    EXPECT(nob_write_entire_file(TEST_DIVIDE_PATH, divide_program, strlen(divide_program)));
+    SweepHeader header = {.a_min = INT_MIN, .a_max = INT_MAX, .b_min = INT_MIN, .b_max = INT_MAX, .shards = 1};
+    EXPECT(!sweep_header_valid(&header));
+
+    header = (SweepHeader) {.a_min = 0, .a_max = 3, .b_min = -1, .b_max = 1, .shards = 1};
+    bool passed = sweep_command(TEST_DIVIDE_PATH, TEST_SHARD_PATH, header, 2, NULL) == 0;
+    char* paths[] = {TEST_SHARD_PATH};
+    passed = passed && merge_command(TEST_MERGED_PATH, paths, 1) == 0;
+    remove(TEST_DIVIDE_PATH);
+    remove(TEST_SHARD_PATH);
+    remove(TEST_MERGED_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+// Runs the command line interface with the arguments, up to a NULL
+int run_cli(const char** args) {
+    int argc = 0;
+    while (args[argc] != NULL) {
+        argc++;
+    }
+    return cli_main(argc, (char**) args);
+}
+
+// Misspelled options, options without their value and inputs that are not
+// numbers are refused instead of being read as inputs of 0
+bool test_invalid_arguments(void) {
+    EXPECT(nob_write_entire_file(TEST_DIVIDE_PATH, divide_program, strlen(divide_program)));
+    const char* invalid[][12] = {
+        {"3dcli", "run", TEST_DIVIDE_PATH, "6", "3", "--prnue", NULL},
+        {"3dcli", "run", TEST_DIVIDE_PATH, "6", "3", "--checkpoint", NULL},
+        {"3dcli", "run", TEST_DIVIDE_PATH, "6", "--cache", NULL},
+        {"3dcli", "run", TEST_DIVIDE_PATH, "6", "x", NULL},
+        {"3dcli", "run", TEST_DIVIDE_PATH, "6", "3", "1", NULL},
+        {"3dcli", "stream", TEST_DIVIDE_PATH, "--jbos", "2", NULL},
+        {"3dcli", "stream", TEST_DIVIDE_PATH, "--limit", NULL},
+        {"3dcli", "serve", TEST_SOCKET_PATH, "--jobs", "two", NULL},
+        {"3dcli", "sweep", TEST_DIVIDE_PATH, TEST_SHARD_PATH, "0", "1", "0", "y", NULL},
+        {"3dcli", "sweep", TEST_DIVIDE_PATH, TEST_SHARD_PATH, "0", "1", "0", "1", "--shard", NULL},
+    };
+    bool passed = true;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(invalid); ++i) {
+        if (run_cli(invalid[i]) != 1) {
+            nob_log(NOB_ERROR, "Arguments %zu were accepted.", i);
+            passed = false;
+        }
+    }
+    const char* valid[] = {"3dcli", "run", TEST_DIVIDE_PATH, "-6", "3", "--prune", NULL};
+    passed = passed && run_cli(valid) == 0;
+    remove(TEST_DIVIDE_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+typedef struct {
+    const char* name;
+    bool (*run)(void);
+} Test;
+
+static const Test tests[] = {
+    {"serve divide by zero", test_serve_divide_by_zero},
+    {"serve reloads changed programs", test_serve_reloads_changed_program},
+    {"stream divide by zero", test_stream_divide_by_zero},
+    {"sweep run count", test_sweep_run_count},
+    {"invalid arguments", test_invalid_arguments},
+};
+
+int main(void) {
+    size_t failed = 0;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(tests); ++i) {
+        if (tests[i].run()) {
+            nob_log(NOB_INFO, "PASS %s", tests[i].name);
+        } else {
+            nob_log(NOB_ERROR, "FAIL %s", tests[i].name);
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
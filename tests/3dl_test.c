@@ -0,0 +1,948 @@
+// Regression tests for the engine, run with `./nob.exe test`.
+
+#include <ctype.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <3dl.h>
+
+#define ARENA_IMPLEMENTATION
+#include <arena.h>
+
+#define NOB_IMPLEMENTATION
+#include <nob.h>
+
+#define DW_ARRAY_IMPLEMENTATION
+#include <dw_array.h>
+
+#define EXPECT(condition)                                                  \
+    do {                                                                   \
+        if (!(condition)) {                                                \
+            nob_log(NOB_ERROR, "%s:%d: %s", __FILE__, __LINE__, #condition); \
+            return false;                                                  \
+        }                                                                  \
+    } while (0)
+
+// Builds a program in which a 1 is carried along a conveyor of `moves` moves
+// into the dx of a time warp with the given dt, with a stop cell elsewhere
+char* conveyor_program(size_t moves, const char* dt) {
+    size_t cols = 2 * moves + 3;
+    Nob_String_Builder sb = {0};
+    for (size_t row = 0; row < 3; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            const char* cell = ".";
+            if (row == 0 && col == cols - 2) {
+                cell = "1";
+            } else if (row == 1 && col == 0) {
+                cell = "1";
+            } else if (row == 1 && col < cols - 3 && col % 2 == 1) {
+                cell = ">";
+            } else if (row == 1 && col == cols - 2) {
+                cell = "@";
+            } else if (row == 1 && col == cols - 1) {
+                cell = "0";
+            } else if (row == 2 && col == 0) {
+                cell = "S";
+            } else if (row == 2 && col == cols - 2) {
+                cell = dt;
+            }
+            nob_sb_append_cstr(&sb, cell);
+            nob_sb_append_cstr(&sb, (col + 1 == cols) ? "\n" : " ");
+        }
+    }
+    nob_sb_append_null(&sb);
+    return sb.items;
+}
+
+// A warp that crashes right after the history filled a whole chunk of boards
+// clones the last board of that chunk, not the one after it
+bool test_crash_at_chunk_boundary(void) {
+    for (size_t moves = 1020; moves <= 1026; ++moves) {
+        char* program = conveyor_program(moves, "0");
+        TD_BoardHistory history = {0};
+        bool loaded = td_load(&history, program, 0, 0);
+        NOB_FREE(program);
+        EXPECT(loaded);
+
+        td_fast_forward(&history);
+        TD_Board* board = td_current_board(&history);
+        EXPECT(board->status == STATUS_CRASH);
+        EXPECT(history.count == moves + 2);
+        EXPECT(board->time == td_board_at(&history, history.count - 2)->time + 1);
+        td_free(&history);
+    }
+    return true;
+}
+
+// Counts A down to 0 in a loop of four ticks driven by a time warp, which the
+// engine skips ahead arithmetically
+static const char* counting_program =
+    ". 1 . 0 . . . .\n"
+    "A - . # . > . .\n"
+    ". . . . . 6 @ 1\n"
+    "0 = S . . . 3 .\n"
+    ". . . . . . . .\n";
+
+#define TEST_CACHE_PATH "3dl_test.3dlr"
+
+// Runs the program one td_forward at a time, which never skips a loop, up to the
+// tick `limit` or its end if that is 0
+TD_Evaluation run_stepwise(int input_a, size_t limit) {
+    TD_BoardHistory history = {0};
+    TD_Evaluation evaluation = {.input_a = input_a, .tick_limit = limit};
+    if (!td_load(&history, counting_program, input_a, 0)) {
+        return evaluation;
+    }
+    while (td_current_board(&history)->status == STATUS_RUNNING && (limit == 0 || history.count < limit)) {
+        td_forward(&history);
+    }
+    evaluation.status = td_current_board(&history)->status;
+    evaluation.result = td_current_board(&history)->result;
+    evaluation.ticks = history.count;
+    td_free(&history);
+    return evaluation;
+}
+
+// Runs with and without a tick limit report the ticks of a skipped loop as if
+// every repetition ran, stop at the limit and share their records in the cache
+bool test_limited_against_unlimited(void) {
+    TD_BoardHistory history = {0};
+    EXPECT(td_load(&history, counting_program, 0, 0));
+
+    TD_Evaluation unlimited = {.input_a = 1000};
+    td_evaluate(&history, 1, &unlimited, 1);
+    TD_Evaluation expected = run_stepwise(1000, 0);
+    EXPECT(unlimited.status == STATUS_STOPPED && expected.status == STATUS_STOPPED);
+    EXPECT(unlimited.result == expected.result);
+    EXPECT(unlimited.ticks == expected.ticks);
+
+    size_t limits[] = {1, 2, 50, 101, unlimited.ticks - 1, unlimited.ticks, unlimited.ticks + 1};
+    for (size_t i = 0; i < NOB_ARRAY_LEN(limits); ++i) {
+        TD_Evaluation limited = {.input_a = 1000, .tick_limit = limits[i]};
+        td_evaluate(&history, 1, &limited, 1);
+        expected = run_stepwise(1000, limits[i]);
+        EXPECT(limited.status == expected.status);
+        EXPECT(limited.ticks == expected.ticks);
+        EXPECT(limited.ticks <= limits[i]);
+        if (limits[i] >= unlimited.ticks) {
+            EXPECT(limited.status == unlimited.status && limited.result == unlimited.result);
+            EXPECT(limited.ticks == unlimited.ticks);
+        } else {
+            EXPECT(limited.status == STATUS_RUNNING && limited.ticks == limits[i]);
+        }
+    }
+
+    remove(TEST_CACHE_PATH);
+    TD_ResultCache cache;
+    EXPECT(td_result_cache_open(&cache, TEST_CACHE_PATH));
+    bool passed = true;
+
+    // The record of the limited run only answers its own limit
+    td_reset(&history, 1000, 0);
+    td_fast_forward_ticks(&history, 49);
+    TD_ResultRecord record = td_result_key(&history, 50);
+    td_result_set(&record, &history);
+    passed = passed && record.status == STATUS_RUNNING && record.ticks == 50;
+    passed = passed && td_result_cache_add(&cache, &record);
+
+    TD_ResultRecord key = td_result_key(&history, 0);
+    passed = passed && !td_result_cache_find(&cache, &key);
+
+    // The record of the unlimited run answers every limit it ends before
+    td_reset(&history, 1000, 0);
+    td_fast_forward(&history);
+    record = td_result_key(&history, 0);
+    td_result_set(&record, &history);
+    passed = passed && td_result_cache_add(&cache, &record);
+
+    key = td_result_key(&history, 0);
+    passed = passed && td_result_cache_find(&cache, &key) && key.ticks == unlimited.ticks;
+    key = td_result_key(&history, unlimited.ticks);
+    passed = passed && td_result_cache_find(&cache, &key) && key.status == STATUS_STOPPED;
+    key = td_result_key(&history, 50);
+    passed = passed && td_result_cache_find(&cache, &key) && key.status == STATUS_RUNNING && key.ticks == 50;
+    key = td_result_key(&history, 51);
+    passed = passed && !td_result_cache_find(&cache, &key);
+
+    td_result_cache_close(&cache);
+    remove(TEST_CACHE_PATH);
+    td_free(&history);
+    EXPECT(passed);
+    return true;
+}
+
+// Builds a program without time warps that carries a 1 along `moves` moves into
+// an S cell, one move per tick
+char* belt_program(size_t moves) {
+    Nob_String_Builder sb = {0};
+    nob_sb_append_cstr(&sb, "1");
+    for (size_t i = 0; i < moves; ++i) {
+        nob_sb_append_cstr(&sb, (i + 1 == moves) ? " > S\n" : " > .");
+    }
+    for (size_t col = 0; col < 2 * moves + 1; ++col) {
+        nob_sb_append_cstr(&sb, (col == 2 * moves) ? ".\n" : ". ");
+    }
+    nob_sb_append_null(&sb);
+    return sb.items;
+}
+
+// The ticks within the leaps of td_leap_forward count like the ones run by
+// td_fast_forward
+bool test_leap_ticks(void) {
+    char* program = belt_program(3000);
+    TD_BoardHistory leaped = {0};
+    TD_BoardHistory stepped = {0};
+    bool loaded = td_load(&leaped, program, 0, 0) && td_load(&stepped, program, 0, 0);
+    NOB_FREE(program);
+    EXPECT(loaded);
+
+    td_leap_forward(&leaped);
+    td_fast_forward(&stepped);
+    TD_Board* leaped_board = td_current_board(&leaped);
+    TD_Board* stepped_board = td_current_board(&stepped);
+    EXPECT(stepped_board->status == STATUS_STOPPED && stepped_board->result == 1);
+    EXPECT(leaped_board->status == STATUS_STOPPED && leaped_board->result == 1);
+    EXPECT(leaped.count < stepped.count);
+    EXPECT(td_ticks(&leaped, leaped.tick) == td_ticks(&stepped, stepped.tick));
+    EXPECT(td_ticks(&leaped, leaped.tick) == 3001);
+    td_free(&leaped);
+    td_free(&stepped);
+    return true;
+}
+
+// Dividing by zero or INT_MIN by -1 crashes the run instead of the process, with
+// every engine, and other inputs of the same batch are not affected
+bool test_divide_by_zero(void) {
+    static const char* program =
+        ". B .\n"
+        "A / .\n"
+        ". S .\n";
+    TD_BoardHistory history = {0};
+    EXPECT(td_load(&history, program, 0, 0));
+
+    TD_Evaluation evaluations[] = {
+        {.input_a = 6, .input_b = 0},
+        {.input_a = 6, .input_b = 3},
+        {.input_a = INT_MIN, .input_b = -1},
+        {.input_a = INT_MIN + 1, .input_b = -1},
+    };
+    td_evaluate(&history, 1, evaluations, NOB_ARRAY_LEN(evaluations));
+    EXPECT(evaluations[0].status == STATUS_CRASH && evaluations[0].ticks == 2);
+    EXPECT(evaluations[1].status == STATUS_STOPPED && evaluations[1].result == 2);
+    EXPECT(evaluations[2].status == STATUS_CRASH && evaluations[2].ticks == 2);
+    EXPECT(evaluations[3].status == STATUS_STOPPED && evaluations[3].result == INT_MAX);
+
+    td_reset(&history, 6, 0);
+    td_leap_forward(&history);
+    EXPECT(td_current_board(&history)->status == STATUS_CRASH);
+    td_free(&history);
+    return true;
+}
+
+#define TEST_PROGRAM_PATH "3dl_test.3dl"
+
+static const char* example_paths[] = {
+    "examples/3d3.3dl",
+    "examples/3d4.3dl",
+    "examples/3d5.3dl",
+    "examples/3d7.3dl",
+};
+
+// Parses a program line by line and token by token the way td_load did before
+// it measured the board first, padding shorter rows with empty cells
+bool reference_parse(const char* text, int input_a, int input_b, TD_Cell** cells, size_t* cols, size_t* rows) {
+    static const char symbols[] = ".<>^v+-*/%@=#SAB";
+    static const TD_CellKind kinds[] = {
+        CELL_EMPTY, CELL_MOVE_LEFT, CELL_MOVE_RIGHT, CELL_MOVE_UP, CELL_MOVE_DOWN,
+        CELL_CALC_ADD, CELL_CALC_SUBTRACT, CELL_CALC_MULTIPLY, CELL_CALC_DIVIDE,
+        CELL_CALC_REMAINDER, CELL_TIMEWARP, CELL_CMP_EQUAL, CELL_CMP_NOTEQUAL,
+        CELL_STOP, CELL_NUMBER, CELL_NUMBER,
+    };
+
+    struct {
+        TD_Cell* items;
+        size_t count;
+        size_t capacity;
+    } parsed = {0};
+    struct {
+        size_t* items;
+        size_t count;
+        size_t capacity;
+    } row_ends = {0};
+
+    *cols = 0;
+    Nob_String_View content = nob_sv_from_cstr(text);
+    while (content.count > 0) {
+        Nob_String_View line = nob_sv_trim(nob_sv_chop_by_delim(&content, '\n'));
+        if (line.count == 0) {
+            continue;
+        }
+
+        size_t row_start = parsed.count;
+        while (line.count > 0) {
+            TD_Cell cell = {0};
+            size_t length = 1;
+            if (isdigit((unsigned char) line.data[0]) ||
+                (line.data[0] == '-' && line.count > 1 && isdigit((unsigned char) line.data[1]))) {
+                bool negative = line.data[0] == '-';
+                length = negative;
+                int64_t n = 0;
+                while (length < line.count && isdigit((unsigned char) line.data[length]) && n <= INT_MAX) {
+                    n = n * 10 + (line.data[length++] - '0');
+                }
+                if (n > (int64_t) INT_MAX + negative) {
+                    nob_da_free(parsed);
+                    nob_da_free(row_ends);
+                    return false;
+                }
+                cell.kind = CELL_NUMBER;
+                cell.value = (int) (negative ? -n : n);
+            } else {
+                const char* symbol = strchr(symbols, line.data[0]);
+                if (line.data[0] == '\0' || symbol == NULL) {
+                    nob_da_free(parsed);
+                    nob_da_free(row_ends);
+                    return false;
+                }
+                cell.kind = kinds[symbol - symbols];
+                if (*symbol == 'A') {
+                    cell.input_kind = CELL_INPUT_A;
+                    cell.value = input_a;
+                } else if (*symbol == 'B') {
+                    cell.input_kind = CELL_INPUT_B;
+                    cell.value = input_b;
+                }
+            }
+            nob_da_append(&parsed, cell);
+            line = nob_sv_trim_left(nob_sv_from_parts(line.data + length, line.count - length));
+        }
+        if (parsed.count - row_start > *cols) {
+            *cols = parsed.count - row_start;
+        }
+        nob_da_append(&row_ends, parsed.count);
+    }
+
+    *rows = row_ends.count;
+    *cells = calloc(*cols * *rows, sizeof(TD_Cell));
+    size_t row_start = 0;
+    for (size_t row = 0; row < *rows; ++row) {
+        memcpy(*cells + row * *cols, parsed.items + row_start, (row_ends.items[row] - row_start) * sizeof(TD_Cell));
+        row_start = row_ends.items[row];
+    }
+    nob_da_free(parsed);
+    nob_da_free(row_ends);
+    return *rows > 0;
+}
+
+// Loads the program with td_load and from a file with td_read, and compares both
+// first boards with the one of the reference parser
+bool parses_like_reference(const char* text) {
+    TD_Cell* expected;
+    size_t cols, rows;
+    if (!reference_parse(text, 3, -4, &expected, &cols, &rows)) {
+        return false;
+    }
+
+    bool passed = nob_write_entire_file(TEST_PROGRAM_PATH, text, strlen(text));
+    for (size_t from_file = 0; from_file < 2 && passed; ++from_file) {
+        TD_BoardHistory history = {0};
+        passed = from_file ? td_read(&history, TEST_PROGRAM_PATH, 3, -4) : td_load(&history, text, 3, -4);
+        if (!passed) {
+            break;
+        }
+        passed = history.cols == cols && history.rows == rows;
+        TD_Cell* cells = td_current_board(&history)->cells;
+        for (size_t i = 0; i < cols * rows && passed; ++i) {
+            passed = cells[i].kind == expected[i].kind &&
+                     cells[i].input_kind == expected[i].input_kind &&
+                     cells[i].value == expected[i].value;
+        }
+        td_free(&history);
+    }
+    remove(TEST_PROGRAM_PATH);
+    NOB_FREE(expected);
+    return passed;
+}
+
+// Programs that td_load and td_read reject, with neither of them reading past
+// the end of the text
+bool rejected_by_parser(const char* text) {
+    TD_BoardHistory history = {0};
+    if (td_load(&history, text, 0, 0)) {
+        td_free(&history);
+        return false;
+    }
+    if (!nob_write_entire_file(TEST_PROGRAM_PATH, text, strlen(text))) {
+        return false;
+    }
+    bool loaded = td_read(&history, TEST_PROGRAM_PATH, 0, 0);
+    remove(TEST_PROGRAM_PATH);
+    if (loaded) {
+        td_free(&history);
+    }
+    return !loaded;
+}
+
+// Replaces every "\n" of the text with `newline`
+char* with_newlines(const char* text, const char* newline) {
+    Nob_String_Builder sb = {0};
+    for (const char* p = text; *p != '\0'; ++p) {
+        if (*p == '\n') {
+            nob_sb_append_cstr(&sb, newline);
+        } else {
+            nob_da_append(&sb, *p);
+        }
+    }
+    nob_sb_append_null(&sb);
+    return sb.items;
+}
+
+// The parser that measures the board before it fills it in reads the same boards
+// as the one it replaced, whatever the line endings and spacing, and rejects the
+// same malformed programs
+bool test_parser_against_reference(void) {
+    for (size_t i = 0; i < NOB_ARRAY_LEN(example_paths); ++i) {
+        Nob_String_Builder sb = {0};
+        EXPECT(nob_read_entire_file(example_paths[i], &sb));
+        nob_sb_append_null(&sb);
+        bool passed = parses_like_reference(sb.items);
+
+        const char* newlines[] = {"\r\n", "\n\n", " \t\n\t "};
+        for (size_t j = 0; j < NOB_ARRAY_LEN(newlines); ++j) {
+            char* text = with_newlines(sb.items, newlines[j]);
+            passed = passed && parses_like_reference(text);
+            NOB_FREE(text);
+        }
+
+        // Without the trailing newline
+        while (sb.count > 1 && strchr("\r\n", sb.items[sb.count - 2]) != NULL) {
+            sb.items[--sb.count - 1] = '\0';
+        }
+        passed = passed && parses_like_reference(sb.items);
+        nob_sb_free(sb);
+        EXPECT(passed);
+    }
+
+    EXPECT(parses_like_reference("1 > S\n.\n\n< 2 . . v\n"));
+    EXPECT(parses_like_reference("\n\n   A\n B + 12>-3\n-2147483648 2147483647 - -\n"));
+    EXPECT(parses_like_reference("1 >\r\n\r\n. . S\r\n. B"));
+
+    // Ends right at the end of a page of the mapped file
+    char page[4097];
+    memset(page, ' ', 4096);
+    memcpy(page, "1 > S\n", 6);
+    page[4095] = '.';
+    page[4096] = '\0';
+    EXPECT(parses_like_reference(page));
+
+    EXPECT(rejected_by_parser(""));
+    EXPECT(rejected_by_parser(" \n\t\r\n\n"));
+    EXPECT(rejected_by_parser("1 > S\n. x .\n"));
+    EXPECT(rejected_by_parser("1 > S\n. 2147483648 .\n"));
+    EXPECT(rejected_by_parser("-2147483649 S"));
+    EXPECT(rejected_by_parser("1 > S\n. 99999999999999999999999 ."));
+    return true;
+}
+
+#define TEST_BINARY_PATH "3dl_test.3dlc"
+
+// Runs the program one plain td_forward at a time up to its end
+void run_forward(TD_BoardHistory* history) {
+    while (td_current_board(history)->status == STATUS_RUNNING) {
+        td_forward(history);
+    }
+}
+
+// Compares the cell kinds and values of two boards, which may be stored sparsely
+bool same_cells(TD_BoardHistory* history, TD_Board* board, TD_Board* expected) {
+    TD_Cell* cells = td_board_cells(board);
+    TD_Cell* expected_cells = td_board_cells(expected);
+    for (size_t i = 0; i < history->cols * history->rows; ++i) {
+        if (cells[i].kind != expected_cells[i].kind || cells[i].value != expected_cells[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Compares the boards of two histories of the same program from `from` on, and
+// the outcomes of their runs
+bool same_runs(TD_BoardHistory* history, TD_BoardHistory* expected, size_t from) {
+    if (history->cols != expected->cols || history->rows != expected->rows || history->count != expected->count) {
+        return false;
+    }
+    for (size_t i = from; i < history->count; ++i) {
+        TD_Board* board = td_board_at(history, i);
+        TD_Board* expected_board = td_board_at(expected, i);
+        if (board->status != expected_board->status || board->time != expected_board->time ||
+            !same_cells(history, board, expected_board)) {
+            return false;
+        }
+    }
+    TD_Board* board = td_current_board(history);
+    TD_Board* expected_board = td_current_board(expected);
+    return board->result == expected_board->result &&
+           td_ticks(history, history->tick) == td_ticks(expected, expected->tick);
+}
+
+// Writes every byte of `data` but the ones from `skip` on to `path`, with the
+// bytes at `offset` replaced by `patch`
+bool write_corrupted(const char* path, const char* data, size_t size, size_t skip, size_t offset,
+                     const void* patch, size_t patch_size) {
+    char* copy = malloc(size);
+    memcpy(copy, data, size);
+    memcpy(copy + offset, patch, patch_size);
+    bool result = nob_write_entire_file(path, copy, skip < size ? skip : size);
+    free(copy);
+    return result;
+}
+
+// Binary programs, pruned or not, run like the text they were written from for
+// other inputs as well, and truncated or corrupted ones are rejected
+bool test_binary_round_trip(void) {
+    int inputs[][2] = {{3, 4}, {0, 0}, {-5, 7}, {12, 1}};
+    for (size_t i = 0; i < NOB_ARRAY_LEN(example_paths); ++i) {
+        for (size_t pruned = 0; pruned < 2; ++pruned) {
+            TD_BoardHistory text = {0};
+            EXPECT(td_read(&text, example_paths[i], 3, 4));
+            if (pruned) {
+                td_prune(&text);
+            }
+            bool written = td_write_binary(&text, TEST_BINARY_PATH);
+            td_free(&text);
+            EXPECT(written);
+
+            bool passed = true;
+            for (size_t j = 0; j < NOB_ARRAY_LEN(inputs) && passed; ++j) {
+                TD_BoardHistory binary = {0};
+                passed = td_read(&text, example_paths[i], inputs[j][0], inputs[j][1]);
+                passed = passed && td_read(&binary, TEST_BINARY_PATH, inputs[j][0], inputs[j][1]);
+                if (passed) {
+                    if (pruned) {
+                        td_prune(&text);
+                    }
+                    passed = binary.pruning.enabled == pruned && same_cells(&text, td_board_at(&binary, 0), td_board_at(&text, 0));
+                    run_forward(&text);
+                    run_forward(&binary);
+                    passed = passed && same_runs(&binary, &text, 0);
+                    td_free(&binary);
+                }
+                td_free(&text);
+            }
+            EXPECT(passed);
+        }
+    }
+
+    Nob_String_Builder sb = {0};
+    EXPECT(nob_read_entire_file(TEST_BINARY_PATH, &sb));
+    TD_BinaryHeader header;
+    memcpy(&header, sb.items, sizeof(header));
+    size_t tables_offset = sizeof(header) + header.cols * header.rows * sizeof(TD_Cell);
+    uint32_t version = TD_BINARY_VERSION + 1;
+    uint32_t cell_size = sizeof(TD_Cell) + 4;
+    uint64_t huge = UINT64_MAX / 2;
+    uint64_t entry = header.cols * header.rows * 2;
+
+    struct {
+        size_t skip;
+        size_t offset;
+        const void* patch;
+        size_t patch_size;
+    } corruptions[] = {
+        {sizeof(header) - 1, 0, TD_BINARY_MAGIC, 4},
+        {sizeof(header), 0, TD_BINARY_MAGIC, 4},
+        {tables_offset - 1, 0, TD_BINARY_MAGIC, 4},
+        {sb.count - 1, 0, TD_BINARY_MAGIC, 4},
+        {sb.count, offsetof(TD_BinaryHeader, version), &version, sizeof(version)},
+        {sb.count, offsetof(TD_BinaryHeader, cell_size), &cell_size, sizeof(cell_size)},
+        {sb.count, offsetof(TD_BinaryHeader, cols), &huge, sizeof(huge)},
+        {sb.count, offsetof(TD_BinaryHeader, rows), &huge, sizeof(huge)},
+        {sb.count, offsetof(TD_BinaryHeader, inputs_count), &huge, sizeof(huge)},
+        {sb.count, tables_offset, &entry, sizeof(entry)},
+    };
+    bool passed = header.inputs_count > 0;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(corruptions) && passed; ++i) {
+        passed = write_corrupted(TEST_BINARY_PATH, sb.items, sb.count, corruptions[i].skip,
+                                 corruptions[i].offset, corruptions[i].patch, corruptions[i].patch_size);
+        TD_BoardHistory history = {0};
+        if (passed && td_read(&history, TEST_BINARY_PATH, 3, 4)) {
+            nob_log(NOB_ERROR, "Corruption %zu was not rejected.", i);
+            td_free(&history);
+            passed = false;
+        }
+    }
+    nob_sb_free(sb);
+    remove(TEST_BINARY_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+// Loads the program from text or from a file
+bool load_test_program(TD_BoardHistory* history, const char* program, bool from_file, int input_a, int input_b) {
+    return from_file ? td_read(history, program, input_a, input_b) : td_load(history, program, input_a, input_b);
+}
+
+// Boards stored run-length encoded decode to the ones of a plain run, across
+// resets to other inputs as well, and sparse storage only starts on the first tick
+bool test_sparse_round_trip(void) {
+    char* belt = belt_program(200);
+    const char* programs[] = {
+        example_paths[0], example_paths[1], example_paths[2], example_paths[3], counting_program, belt,
+    };
+    int inputs[][2] = {{3, 4}, {1, 0}, {7, -5}, {12, 0}};
+    bool passed = true;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(programs) && passed; ++i) {
+        bool from_file = i < NOB_ARRAY_LEN(example_paths);
+        TD_BoardHistory sparse = {0};
+        passed = load_test_program(&sparse, programs[i], from_file, inputs[0][0], inputs[0][1]);
+        passed = passed && td_store_sparse(&sparse);
+        for (size_t j = 0; j < NOB_ARRAY_LEN(inputs) && passed; ++j) {
+            TD_BoardHistory plain = {0};
+            passed = load_test_program(&plain, programs[i], from_file, inputs[j][0], inputs[j][1]);
+            if (!passed) {
+                break;
+            }
+            td_reset(&sparse, inputs[j][0], inputs[j][1]);
+            run_forward(&plain);
+            run_forward(&sparse);
+            passed = sparse.count > 1 && same_runs(&sparse, &plain, 0);
+            td_free(&plain);
+        }
+        if (sparse.loaded) {
+            td_free(&sparse);
+        }
+    }
+    NOB_FREE(belt);
+    EXPECT(passed);
+
+    TD_BoardHistory history = {0};
+    EXPECT(td_load(&history, counting_program, 3, 0));
+    td_forward(&history);
+    passed = !td_store_sparse(&history);
+    td_free(&history);
+    EXPECT(passed);
+    return true;
+}
+
+#define TEST_TRACE_PATH "3dl_test.3dlt"
+
+// Replays the trace at `path` and compares every board and status it records
+// with the boards of the plain run `expected`. Returns the number of boards read,
+// or SIZE_MAX if the trace differs from the run.
+size_t replay_against(const char* path, TD_BoardHistory* expected) {
+    TD_TraceReader reader;
+    if (!td_trace_open(&reader, path)) {
+        return SIZE_MAX;
+    }
+
+    size_t boards = 0;
+    bool same = reader.cols == expected->cols && reader.rows == expected->rows;
+    TD_Board* board = NULL;
+    while (same && td_trace_next(&reader)) {
+        if (reader.record.kind == TD_TRACE_TICK) {
+            same = boards < expected->count;
+            if (same) {
+                board = td_board_at(expected, boards++);
+                same = reader.record.time == board->time;
+            }
+            for (size_t i = 0; i < reader.cols * reader.rows && same; ++i) {
+                same = reader.cells[i].kind == board->cells[i].kind && reader.cells[i].value == board->cells[i].value;
+            }
+        } else if (reader.record.kind == TD_TRACE_STATUS) {
+            same = board != NULL && reader.record.status == board->status;
+            same = same && (board->status != STATUS_STOPPED || reader.record.result == board->result);
+        }
+    }
+    td_trace_close(&reader);
+    return same ? boards : SIZE_MAX;
+}
+
+// Traces replay to the boards of a plain run, whether the traced run keeps its
+// boards or forgets them, and traces cut short replay up to their last complete
+// record while other files are rejected
+bool test_trace_round_trip(void) {
+    char* belt = belt_program(200);
+    const char* programs[] = {
+        example_paths[0], example_paths[1], example_paths[2], example_paths[3], counting_program, belt,
+    };
+    int inputs[][2] = {{3, 4}, {1, 0}, {7, -5}, {12, 0}};
+    bool passed = true;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(programs) && passed; ++i) {
+        bool from_file = i < NOB_ARRAY_LEN(example_paths);
+        for (size_t j = 0; j < NOB_ARRAY_LEN(inputs) && passed; ++j) {
+            TD_BoardHistory traced = {0};
+            TD_BoardHistory plain = {0};
+            passed = load_test_program(&traced, programs[i], from_file, inputs[j][0], inputs[j][1]);
+            passed = passed && load_test_program(&plain, programs[i], from_file, inputs[j][0], inputs[j][1]);
+            passed = passed && td_trace_start(&traced, TEST_TRACE_PATH);
+            if (passed) {
+                run_forward(&traced);
+                run_forward(&plain);
+                passed = td_trace_stop(&traced);
+                passed = passed && td_current_board(&traced)->status == td_current_board(&plain)->status;
+                passed = passed && td_current_board(&traced)->result == td_current_board(&plain)->result;
+                passed = passed && td_ticks(&traced, traced.tick) == td_ticks(&plain, plain.tick);
+                passed = passed && replay_against(TEST_TRACE_PATH, &plain) == plain.count;
+                if (i == NOB_ARRAY_LEN(programs) - 1) {
+                    passed = passed && traced.forgotten > 0;
+                }
+            }
+            if (traced.loaded) {
+                td_free(&traced);
+            }
+            if (plain.loaded) {
+                td_free(&plain);
+            }
+        }
+    }
+    NOB_FREE(belt);
+    EXPECT(passed);
+
+    // The last trace written is the one of the belt
+    TD_BoardHistory plain = {0};
+    belt = belt_program(200);
+    passed = td_load(&plain, belt, 0, 0);
+    NOB_FREE(belt);
+    EXPECT(passed);
+    run_forward(&plain);
+
+    Nob_String_Builder sb = {0};
+    passed = nob_read_entire_file(TEST_TRACE_PATH, &sb);
+    // Cuts the last change of the last board, which is followed by its status
+    size_t cut = sb.count - sizeof(TD_TraceRecord) - sizeof(TD_TraceChange) / 2;
+    passed = passed && nob_write_entire_file(TEST_TRACE_PATH, sb.items, cut);
+    passed = passed && replay_against(TEST_TRACE_PATH, &plain) == plain.count - 1;
+
+    uint32_t version = TD_TRACE_VERSION + 1;
+    uint64_t huge = (uint64_t) UINT32_MAX + 1;
+    uint64_t zero = 0;
+    struct {
+        size_t skip;
+        size_t offset;
+        const void* patch;
+        size_t patch_size;
+    } corruptions[] = {
+        {sizeof(TD_TraceHeader) - 1, 0, TD_TRACE_MAGIC, 4},
+        {sb.count, 0, TD_BINARY_MAGIC, 4},
+        {sb.count, offsetof(TD_TraceHeader, version), &version, sizeof(version)},
+        {sb.count, offsetof(TD_TraceHeader, cols), &zero, sizeof(zero)},
+        {sb.count, offsetof(TD_TraceHeader, rows), &huge, sizeof(huge)},
+    };
+    for (size_t i = 0; i < NOB_ARRAY_LEN(corruptions) && passed; ++i) {
+        passed = write_corrupted(TEST_TRACE_PATH, sb.items, sb.count, corruptions[i].skip,
+                                 corruptions[i].offset, corruptions[i].patch, corruptions[i].patch_size);
+        TD_TraceReader reader;
+        if (passed && td_trace_open(&reader, TEST_TRACE_PATH)) {
+            nob_log(NOB_ERROR, "Corruption %zu was not rejected.", i);
+            td_trace_close(&reader);
+            passed = false;
+        }
+    }
+    nob_sb_free(sb);
+    td_free(&plain);
+    remove(TEST_TRACE_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+#define TEST_CHECKPOINT_PATH "3dl_test.3dls"
+
+// Runs the program halfway with td_forward and saves a checkpoint there
+bool save_halfway(const char* program, bool from_file, int input_a, int input_b, size_t ticks) {
+    TD_BoardHistory history = {0};
+    if (!load_test_program(&history, program, from_file, input_a, input_b)) {
+        return false;
+    }
+    for (size_t i = 0; i < ticks / 2; ++i) {
+        td_forward(&history);
+    }
+    bool saved = td_save_checkpoint(&history, TEST_CHECKPOINT_PATH) && td_finish_checkpoint(&history);
+    td_free(&history);
+    return saved;
+}
+
+// Runs resumed from a checkpoint end like plain runs, and checkpoints that are
+// truncated, corrupted or saved from another run are rejected
+bool test_checkpoint_round_trip(void) {
+    char* belt = belt_program(200);
+    const char* programs[] = {
+        example_paths[0], example_paths[1], example_paths[2], example_paths[3], counting_program, belt,
+    };
+    int inputs[][2] = {{3, 4}, {1, 0}, {7, -5}, {12, 0}};
+    bool passed = true;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(programs) && passed; ++i) {
+        bool from_file = i < NOB_ARRAY_LEN(example_paths);
+        for (size_t j = 0; j < NOB_ARRAY_LEN(inputs) && passed; ++j) {
+            TD_BoardHistory plain = {0};
+            TD_BoardHistory resumed = {0};
+            passed = load_test_program(&plain, programs[i], from_file, inputs[j][0], inputs[j][1]);
+            if (passed) {
+                run_forward(&plain);
+                passed = save_halfway(programs[i], from_file, inputs[j][0], inputs[j][1], plain.count);
+            }
+            passed = passed && load_test_program(&resumed, programs[i], from_file, inputs[j][0], inputs[j][1]);
+            passed = passed && td_load_checkpoint(&resumed, TEST_CHECKPOINT_PATH);
+            if (passed) {
+                run_forward(&resumed);
+                TD_Board* board = td_current_board(&resumed);
+                TD_Board* expected = td_current_board(&plain);
+                passed = board->status == expected->status && board->result == expected->result;
+                passed = passed && board->time == expected->time && same_cells(&plain, board, expected);
+                passed = passed && td_ticks(&resumed, resumed.tick) == td_ticks(&plain, plain.tick);
+            }
+            if (plain.loaded) {
+                td_free(&plain);
+            }
+            if (resumed.loaded) {
+                td_free(&resumed);
+            }
+        }
+    }
+    EXPECT(passed);
+
+    // The last checkpoint saved is the one of the counting loop
+    NOB_FREE(belt);
+    Nob_String_Builder sb = {0};
+    EXPECT(save_halfway(counting_program, false, 12, 0, 46));
+    EXPECT(nob_read_entire_file(TEST_CHECKPOINT_PATH, &sb));
+    TD_CheckpointHeader header;
+    memcpy(&header, sb.items, sizeof(header));
+    size_t board_bytes = sizeof(TD_CheckpointBoard) + header.cols * header.rows * sizeof(TD_Cell);
+    size_t last_cells = sizeof(header) + (header.boards_count - 1) * board_bytes + sizeof(TD_CheckpointBoard);
+    uint32_t version = TD_CHECKPOINT_VERSION + 1;
+    uint64_t huge = UINT64_MAX / 2;
+    uint64_t status = STATUS_LOOPING + 1;
+    int32_t value = 12345;
+    TD_CellKind kind = CELL_STOP + 1;
+
+    struct {
+        size_t skip;
+        size_t offset;
+        const void* patch;
+        size_t patch_size;
+    } corruptions[] = {
+        {sizeof(header) - 1, 0, TD_CHECKPOINT_MAGIC, 4},
+        {sb.count - 1, 0, TD_CHECKPOINT_MAGIC, 4},
+        {sb.count, 0, TD_TRACE_MAGIC, 4},
+        {sb.count, offsetof(TD_CheckpointHeader, version), &version, sizeof(version)},
+        {sb.count, offsetof(TD_CheckpointHeader, boards_count), &huge, sizeof(huge)},
+        {sb.count, sizeof(header) + offsetof(TD_CheckpointBoard, status), &status, sizeof(status)},
+        {sb.count, last_cells + 9 * sizeof(TD_Cell) + offsetof(TD_Cell, value), &value, sizeof(value)},
+        {sb.count, last_cells + offsetof(TD_Cell, kind), &kind, sizeof(kind)},
+    };
+    passed = header.boards_count > 1;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(corruptions) && passed; ++i) {
+        passed = write_corrupted(TEST_CHECKPOINT_PATH, sb.items, sb.count, corruptions[i].skip,
+                                 corruptions[i].offset, corruptions[i].patch, corruptions[i].patch_size);
+        TD_BoardHistory history = {0};
+        passed = passed && td_load(&history, counting_program, 12, 0);
+        if (passed && td_load_checkpoint(&history, TEST_CHECKPOINT_PATH)) {
+            nob_log(NOB_ERROR, "Corruption %zu was not rejected.", i);
+            passed = false;
+        }
+        if (history.loaded) {
+            td_free(&history);
+        }
+    }
+    EXPECT(passed);
+
+    // The intact checkpoint only continues the same run from its start
+    passed = nob_write_entire_file(TEST_CHECKPOINT_PATH, sb.items, sb.count);
+    nob_sb_free(sb);
+    TD_BoardHistory history = {0};
+    EXPECT(td_load(&history, counting_program, 13, 0));
+    passed = passed && !td_load_checkpoint(&history, TEST_CHECKPOINT_PATH);
+    td_reset(&history, 12, 0);
+    td_prune(&history);
+    passed = passed && !td_load_checkpoint(&history, TEST_CHECKPOINT_PATH);
+    td_free(&history);
+
+    TD_BoardHistory started = {0};
+    EXPECT(td_load(&started, counting_program, 12, 0));
+    td_forward(&started);
+    passed = passed && !td_load_checkpoint(&started, TEST_CHECKPOINT_PATH);
+    td_free(&started);
+    remove(TEST_CHECKPOINT_PATH);
+    EXPECT(passed);
+    return true;
+}
+
+// Pruned runs of the examples end like unpruned ones, stepped one board at a
+// time as well as evaluated in a batch. The examples stop, crash or stall on
+// relevant cells, so their status and ticks don't change either.
+bool test_pruned_against_unpruned(void) {
+    int inputs[][2] = {{3, 4}, {0, 0}, {-5, 7}, {12, 1}};
+    TD_Evaluation evaluations[2][NOB_ARRAY_LEN(inputs)];
+    for (size_t i = 0; i < NOB_ARRAY_LEN(example_paths); ++i) {
+        bool passed = true;
+        for (size_t pruned = 0; pruned < 2 && passed; ++pruned) {
+            TD_BoardHistory history = {0};
+            passed = td_read(&history, example_paths[i], 0, 0);
+            if (!passed) {
+                break;
+            }
+            if (pruned) {
+                td_prune(&history);
+            }
+            for (size_t j = 0; j < NOB_ARRAY_LEN(inputs); ++j) {
+                evaluations[pruned][j] = (TD_Evaluation) {
+                    .input_a = inputs[j][0], .input_b = inputs[j][1]
+                };
+            }
+            td_evaluate(&history, 1, evaluations[pruned], NOB_ARRAY_LEN(inputs));
+
+            for (size_t j = 0; j < NOB_ARRAY_LEN(inputs) && passed; ++j) {
+                td_reset(&history, inputs[j][0], inputs[j][1]);
+                run_forward(&history);
+                TD_Board* board = td_current_board(&history);
+                passed = board->status == evaluations[pruned][j].status &&
+                         td_ticks(&history, history.tick) == evaluations[pruned][j].ticks &&
+                         (board->status != STATUS_STOPPED || board->result == evaluations[pruned][j].result);
+            }
+            td_free(&history);
+        }
+
+        for (size_t j = 0; j < NOB_ARRAY_LEN(inputs) && passed; ++j) {
+            TD_Evaluation* unpruned = &evaluations[0][j];
+            TD_Evaluation* pruned = &evaluations[1][j];
+            passed = pruned->status == unpruned->status && pruned->ticks == unpruned->ticks;
+            passed = passed && (unpruned->status != STATUS_STOPPED || pruned->result == unpruned->result);
+        }
+        EXPECT(passed);
+    }
+    return true;
+}
+
+typedef struct {
+    const char* name;
+    bool (*run)(void);
+} Test;
+
+static const Test tests[] = {
+    {"crash at chunk boundary", test_crash_at_chunk_boundary},
+    {"limited against unlimited runs", test_limited_against_unlimited},
+    {"ticks of leaps", test_leap_ticks},
+    {"divide by zero", test_divide_by_zero},
+    {"parser against reference", test_parser_against_reference},
+    {"binary round trip", test_binary_round_trip},
+    {"sparse round trip", test_sparse_round_trip},
+    {"trace round trip", test_trace_round_trip},
+    {"checkpoint round trip", test_checkpoint_round_trip},
+    {"pruned against unpruned runs", test_pruned_against_unpruned},
+};
+
+int main(void) {
+    size_t failed = 0;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(tests); ++i) {
+        if (tests[i].run()) {
+            nob_log(NOB_INFO, "PASS %s", tests[i].name);
+        } else {
+            nob_log(NOB_ERROR, "FAIL %s", tests[i].name);
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}